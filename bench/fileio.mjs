@@ -0,0 +1,84 @@
+/**
+ * Transmux (mkv -> mp4) throughput of JS reader/writer objects vs direct host file I/O
+ * (Demuxer.buildFromFile, Muxer.toFile: pread/pwrite through NODERAWFS), with the Node build.
+ *
+ *  NODE=1 ./build_wasm.sh
+ *  node bench/fileio.mjs [file] [--json]
+ */
+import fs from 'fs'
+import os from 'os'
+import path from 'path'
+import { fileURLToPath } from 'url'
+import createModule from '../src/wasm/ffmpeg_built.node.mjs'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2).filter(a => !a.startsWith('--'))
+const json = process.argv.includes('--json')
+const file = args[0] ?? path.join(root, 'examples/assets/Bunny.mkv')
+const output = path.join(os.tmpdir(), `fileio-${process.pid}.mp4`)
+const MB = 1024 * 1024
+
+/* reader/writer objects over fs file descriptors, as a server would do without direct I/O */
+function fdReader(fd) {
+    return {
+        size: fs.fstatSync(fd).size,
+        offset: 0,
+        async read(buffer) {
+            const n = fs.readSync(fd, buffer, 0, buffer.byteLength, this.offset)
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+function fdWriter(fd) {
+    return {
+        offset: 0,
+        write(data) {
+            fs.writeSync(fd, data, 0, data.byteLength, this.offset)
+            this.offset += data.byteLength
+        },
+        seek(pos) { this.offset = pos },
+    }
+}
+
+function vec2Array(vec) {
+    const arr = []
+    for (let i = 0; i < vec.size(); i++) arr.push(vec.get(i))
+    vec.delete()
+    return arr
+}
+
+async function transmux(ff, direct) {
+    const inFd = direct ? undefined : fs.openSync(file, 'r')
+    const outFd = direct ? undefined : fs.openSync(output, 'w')
+    const demuxer = new ff.Demuxer()
+    if (direct) await demuxer.buildFromFile(file)
+    else await demuxer.build(fdReader(inFd))
+    const muxer = direct ? ff.Muxer.toFile('mp4', output) : new ff.Muxer('mp4', fdWriter(outFd))
+    const streams = vec2Array(demuxer.getMetadata().streamInfos)
+    streams.forEach(s => muxer.newStreamWithDemuxer(demuxer, s.index))
+    muxer.writeHeader()
+    const start = performance.now()
+    while (true) {
+        const pkt = await demuxer.read()
+        if (pkt.size <= 0) { pkt.delete(); break }
+        muxer.writeFrame(pkt, streams.findIndex(s => s.index == pkt.streamIndex))
+        pkt.delete()
+    }
+    muxer.writeTrailer()
+    const seconds = (performance.now() - start) / 1000
+    muxer.delete()
+    demuxer.delete()
+    if (inFd !== undefined) fs.closeSync(inFd)
+    if (outFd !== undefined) fs.closeSync(outFd)
+    return { seconds, mbps: fs.statSync(file).size / MB / seconds, outputBytes: fs.statSync(output).size }
+}
+
+const ff = await createModule()
+const report = { js: await transmux(ff, false), direct: await transmux(ff, true) }
+fs.rmSync(output, { force: true })
+
+if (json) console.log(JSON.stringify({ file, ...report }, null, 2))
+else for (const [io, r] of Object.entries(report))
+    console.log(`${io.padEnd(8)}${(r.mbps.toFixed(1) + ' MB/s').padStart(12)}  (${r.outputBytes} bytes written)`)
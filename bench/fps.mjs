@@ -0,0 +1,120 @@
+/**
+ * Decode (and convert) fps of the default and SIMD wasm builds on bundled assets, under Node.
+ * 
+ *  ./build_wasm.sh && SIMD=1 ./build_wasm.sh
+ *  node bench/fps.mjs [assets_dir] [--json]
+ * 
+ * Each asset is fully demuxed and decoded, video frames converted to rgba (swscale),
+ * audio frames to s16 (swresample).
+ */
+import fs from 'fs'
+import path from 'path'
+import { fileURLToPath } from 'url'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2)
+const json = args.includes('--json')
+const assets = args.find(a => !a.startsWith('--')) ?? path.join(root, 'examples/assets')
+// each build is instantiated by its own JS glue (import names are minified per link)
+const variants = {
+    scalar: path.join(root, 'src/wasm/ffmpeg_built'),
+    simd: path.join(root, 'src/wasm/ffmpeg_built.simd'),
+}
+
+/* ReaderForDemuxer over a whole file in memory */
+function fileReader(data) {
+    return {
+        size: data.byteLength,
+        offset: 0,
+        async read(buffer) {
+            const n = Math.min(buffer.byteLength, data.byteLength - this.offset)
+            buffer.set(data.subarray(this.offset, this.offset + n))
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+
+function vec2Array(vec) {
+    const arr = []
+    for (let i = 0; i < vec.size(); i++) arr.push(vec.get(i))
+    vec.delete()
+    return arr
+}
+
+function converter(ff, id, info, dataFormat) {
+    const isVideo = info.mediaType == 'video'
+    const inArgs = isVideo ?
+        `video_size=${info.width}x${info.height}:pix_fmt=${dataFormat.format}:time_base=1/1000000` :
+        `sample_rate=${dataFormat.sampleRate}:sample_fmt=${dataFormat.format}:channel_layout=${dataFormat.channelLayout}:time_base=1/1000000`
+    const spec = isVideo ? `[${id}]format=rgba[out]` : `[${id}]aformat=sample_fmts=s16[out]`
+    const inParams = ff.createStringStringMap()
+    const outParams = ff.createStringStringMap()
+    const mediaTypes = ff.createStringStringMap()
+    inParams.set(id, inArgs)
+    outParams.set('out', '')
+    mediaTypes.set(id, info.mediaType)
+    mediaTypes.set('out', info.mediaType)
+    return new ff.Filterer(inParams, outParams, mediaTypes, spec)
+}
+
+async function run(ff, file) {
+    const demuxer = new ff.Demuxer()
+    await demuxer.build(fileReader(fs.readFileSync(file)))
+    const streams = {}
+    for (const info of vec2Array(demuxer.getMetadata().streamInfos)) {
+        if (info.mediaType != 'video' && info.mediaType != 'audio') continue
+        const id = `0:${info.index}`
+        const decoder = new ff.Decoder(demuxer, info.index, id)
+        streams[info.index] = { decoder, filterer: converter(ff, id, info, decoder.dataFormat), frames: 0 }
+    }
+    const convert = (s, frames) => {
+        const inVec = ff.createFrameVector()
+        frames.forEach(f => inVec.push_back(f))
+        const outs = vec2Array(s.filterer.filter(inVec))
+        inVec.delete()
+        s.frames += frames.length
+        frames.forEach(f => f.delete())
+        outs.forEach(f => f.delete())
+    }
+    const start = performance.now()
+    while (true) {
+        const pkt = await demuxer.read()
+        if (pkt.size <= 0) { pkt.delete(); break }
+        const s = streams[pkt.streamIndex]
+        if (s) convert(s, vec2Array(s.decoder.decode(pkt)))
+        pkt.delete()
+    }
+    for (const s of Object.values(streams)) convert(s, vec2Array(s.decoder.flush()))
+    const seconds = (performance.now() - start) / 1000
+    const frames = Object.values(streams).reduce((n, s) => n + s.frames, 0)
+    Object.values(streams).forEach(s => { s.decoder.delete(); s.filterer.delete() })
+    demuxer.delete()
+    return { frames, seconds, fps: frames / seconds }
+}
+
+const files = fs.readdirSync(assets).filter(f => /\.(mp4|mkv|avi|webm|mp3|wav)$/.test(f))
+const report = {}
+for (const [variant, build] of Object.entries(variants)) {
+    if (!fs.existsSync(`${build}.wasm`) || !fs.existsSync(`${build}.js`)) {
+        console.error(`skip ${variant}: ${build}.wasm/.js not built`)
+        continue
+    }
+    const { default: createModule } = await import(`${build}.js`)
+    const ff = await createModule({ wasmBinary: fs.readFileSync(`${build}.wasm`) })
+    for (const file of files) {
+        report[file] = report[file] ?? {}
+        report[file][variant] = await run(ff, path.join(assets, file))
+    }
+}
+
+if (json) console.log(JSON.stringify(report, null, 2))
+else {
+    console.log(`${'asset'.padEnd(24)}${'scalar fps'.padStart(12)}${'simd fps'.padStart(12)}${'speedup'.padStart(10)}`)
+    for (const [file, r] of Object.entries(report)) {
+        const speedup = r.scalar && r.simd ? (r.simd.fps / r.scalar.fps).toFixed(2) + 'x' : '-'
+        console.log(`${file.padEnd(24)}${(r.scalar?.fps.toFixed(1) ?? '-').padStart(12)}` +
+            `${(r.simd?.fps.toFixed(1) ?? '-').padStart(12)}${speedup.padStart(10)}`)
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * ABR ladder: encode one video into several renditions (mpeg4, discarded mkv),
+ * once with FanOut (decode once, cascaded scaling), once with a separate decode (and FanOut of one branch) per rendition.
+ * Prints wall time of both.
+ * 
+ *  node bench/ladder.mjs [file] [--json]
+ */
+import fs from 'fs'
+import path from 'path'
+import { fileURLToPath } from 'url'
+import createModule from '../src/wasm/ffmpeg_built.js'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2).filter(a => !a.startsWith('--'))
+const json = process.argv.includes('--json')
+const file = args[0] ?? path.join(root, 'examples/assets/Bunny.mp4')
+const data = fs.readFileSync(file)
+// fraction of source height, bitrate
+const ladder = [[1, 2000000], [2/3, 1000000], [4/9, 500000]]
+
+function fileReader(data) {
+    return {
+        size: data.byteLength,
+        offset: 0,
+        async read(buffer) {
+            const n = Math.min(buffer.byteLength, data.byteLength - this.offset)
+            buffer.set(data.subarray(this.offset, this.offset + n))
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+
+function vec2Array(vec) {
+    const arr = []
+    for (let i = 0; i < vec.size(); i++) arr.push(vec.get(i))
+    vec.delete()
+    return arr
+}
+
+const discard = () => ({ offset: 0, write(d) { this.offset += d.byteLength }, seek(pos) { this.offset = pos } })
+const even = x => Math.round(x / 2) * 2
+const rendition = (video, [scale, bitRate]) => ({
+    ...video, codecName: 'mpeg4', format: 'yuv420p', bitRate,
+    width: even(video.width * scale), height: even(video.height * scale),
+})
+
+async function openVideo(ff) {
+    const demuxer = new ff.Demuxer()
+    await demuxer.build(fileReader(data))
+    const video = vec2Array(demuxer.getMetadata().streamInfos).find(s => s.mediaType == 'video')
+    return { demuxer, video }
+}
+
+/* encode renditions ladder[i] with a single decode, parents[i]: branch scaled from (-1 for decoded) */
+async function fanOut(ff, steps, parents) {
+    const { demuxer, video } = await openVideo(ff)
+    const fanout = new ff.FanOut(demuxer, video.index)
+    const muxers = steps.map(() => new ff.Muxer('matroska', discard()))
+    steps.forEach((step, i) => fanout.addBranch(parents[i], muxers[i], rendition(video, step)))
+    while (!(await fanout.step(64)).end);
+    fanout.delete()
+    muxers.forEach(m => m.delete())
+    demuxer.delete()
+}
+
+const ff = await createModule({ wasmBinary: fs.readFileSync(path.join(root, 'src/wasm/ffmpeg_built.wasm')) })
+let t = performance.now()
+// each rendition scales from the previous one
+await fanOut(ff, ladder, ladder.map((_, i) => i - 1))
+const fanOutMs = performance.now() - t
+t = performance.now()
+for (const step of ladder) await fanOut(ff, [step], [-1])
+const separateMs = performance.now() - t
+
+if (json) console.log(JSON.stringify({ file, renditions: ladder.length, fanOutMs, separateMs }, null, 2))
+else console.log(`${ladder.length} renditions: fan-out ${fanOutMs.toFixed(0)} ms, separate decodes ${separateMs.toFixed(0)} ms ` +
+    `(${(separateMs / fanOutMs).toFixed(2)}x)`)
@@ -0,0 +1,374 @@
+/**
+ * Micro benchmarks of the C++ wrappers, built natively against system FFmpeg.
+ * 
+ *  make native && ./build/native/micro_bench [assets_dir] [--json]
+ * 
+ * Each stage reports ns/op and heap allocations/op (FFmpeg av_malloc included),
+ * only the stage itself is measured, inputs are prepared beforehand.
+ */
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "demuxer.h"
+#include "decode.h"
+#include "encode.h"
+#include "filter.h"
+#include "muxer.h"
+#include "io.h"
+using namespace std;
+
+
+/**
+ * Count allocations by interposing glibc allocator, so FFmpeg's allocations are counted too.
+ */
+static atomic<int64_t> alloc_count(0);
+
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t n, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void* __libc_memalign(size_t align, size_t size);
+    void __libc_free(void* ptr);
+
+    void* malloc(size_t size) { alloc_count++; return __libc_malloc(size); }
+    void* calloc(size_t n, size_t size) { alloc_count++; return __libc_calloc(n, size); }
+    void* realloc(void* ptr, size_t size) { alloc_count++; return __libc_realloc(ptr, size); }
+    void* memalign(size_t align, size_t size) { alloc_count++; return __libc_memalign(align, size); }
+    void* aligned_alloc(size_t align, size_t size) { alloc_count++; return __libc_memalign(align, size); }
+    int posix_memalign(void** ptr, size_t align, size_t size) {
+        alloc_count++;
+        *ptr = __libc_memalign(align, size);
+        return *ptr != NULL ? 0 : ENOMEM;
+    }
+    void free(void* ptr) { __libc_free(ptr); }
+}
+
+
+/* accumulate time and allocations of measured sections */
+class Stopwatch {
+    chrono::steady_clock::time_point t0;
+    int64_t allocs0 = 0;
+public:
+    int64_t ns = 0;
+    int64_t allocs = 0;
+    void start() {
+        allocs0 = alloc_count.load();
+        t0 = chrono::steady_clock::now();
+    }
+    void stop() {
+        ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count();
+        allocs += alloc_count.load() - allocs0;
+    }
+};
+
+struct Result {
+    string name;
+    int64_t ops;
+    double ns_per_op;
+    double allocs_per_op;
+};
+
+static Result result(string name, int64_t ops, Stopwatch& sw) {
+    ops = ops > 0 ? ops : 1;
+    return {.name = name, .ops = ops, .ns_per_op = (double)sw.ns / ops, .allocs_per_op = (double)sw.allocs / ops};
+}
+
+
+/* helpers (not measured) */
+
+static Demuxer* openDemuxer(string path) {
+    auto demuxer = new Demuxer();
+    demuxer->build(new FileReader(path));
+    return demuxer;
+}
+
+static int findStream(Demuxer* demuxer, AVMediaType type) {
+    auto index = av_find_best_stream(demuxer->av_format_context(), type, -1, -1, NULL, 0);
+    CHECK(index >= 0, "Could not find stream");
+    return index;
+}
+
+static vector<Packet*> readPackets(Demuxer* demuxer, int stream_index) {
+    vector<Packet*> pkts;
+    auto pkt = new Packet();
+    while (demuxer->readInto(pkt)) {
+        if (pkt->stream_index() != stream_index) continue;
+        pkts.push_back(pkt);
+        pkt = new Packet();
+    }
+    delete pkt;
+    return pkts;
+}
+
+/* stages modify timestamps in place, so each run uses new references */
+static vector<Packet*> refPackets(vector<Packet*>& pkts) {
+    vector<Packet*> refs;
+    for (auto p : pkts) {
+        auto ref = new Packet();
+        av_packet_ref(ref->av_packet(), p->av_packet());
+        refs.push_back(ref);
+    }
+    return refs;
+}
+
+static vector<Frame*> refFrames(vector<Frame*>& frames) {
+    vector<Frame*> refs;
+    for (auto f : frames) {
+        auto ref = new Frame(f->name());
+        av_frame_ref(ref->av_ptr(), f->av_ptr());
+        refs.push_back(ref);
+    }
+    return refs;
+}
+
+template<typename T>
+static void deleteAll(vector<T*>& vec) {
+    for (auto p : vec) delete p;
+    vec.clear();
+}
+
+static vector<Frame*> decodeAll(Decoder& decoder, vector<Packet*> pkts, size_t max_frames) {
+    vector<Frame*> frames;
+    for (auto p : pkts) {
+        for (auto f : decoder.decode(p)) {
+            f->av_ptr()->pict_type = AV_PICTURE_TYPE_NONE;
+            if (frames.size() < max_frames) frames.push_back(f);
+            else delete f;
+        }
+    }
+    deleteAll(pkts);
+    return frames;
+}
+
+static StreamInfo videoEncoderInfo(Frame* frame, string codec_name, double frame_rate) {
+    StreamInfo info = {};
+    info.codec_type = "video";
+    info.codec_name = codec_name;
+    info.format = frame->getFrameInfo().format;
+    info.width = frame->av_ptr()->width;
+    info.height = frame->av_ptr()->height;
+    info.frame_rate = frame_rate;
+    info.time_base = av_inv_q(av_d2q(frame_rate, INT_MAX));
+    info.sample_aspect_ratio = {0, 1};
+    info.bit_rate = 1000000;
+    return info;
+}
+
+static StreamInfo audioEncoderInfo(Frame* frame, string codec_name) {
+    auto frameInfo = frame->getFrameInfo();
+    StreamInfo info = {};
+    info.codec_type = "audio";
+    info.codec_name = codec_name;
+    info.format = frameInfo.format;
+    info.sample_rate = frameInfo.sample_rate;
+    info.channels = frameInfo.channels;
+    info.channel_layout = frameInfo.channel_layout;
+    info.time_base = {1, frameInfo.sample_rate};
+    info.bit_rate = 128000;
+    return info;
+}
+
+
+/* stages */
+
+static Result benchDemux(string path, int repeat) {
+    Stopwatch sw;
+    int64_t ops = 0;
+    for (int i = 0; i < repeat; i++) {
+        auto demuxer = openDemuxer(path);
+        Packet pkt;
+        sw.start();
+        while (demuxer->readInto(&pkt)) ops++;
+        sw.stop();
+        delete demuxer;
+    }
+    return result("Demuxer::read", ops, sw);
+}
+
+static Result benchDecode(string name, Demuxer* demuxer, int stream_index, vector<Packet*>& pkts, int repeat) {
+    Stopwatch sw;
+    int64_t ops = 0;
+    for (int i = 0; i < repeat; i++) {
+        Decoder decoder(demuxer, stream_index, "0:0");
+        auto refs = refPackets(pkts);
+        vector<Frame*> frames;
+        sw.start();
+        for (auto p : refs) {
+            auto out = decoder.decode(p);
+            frames.insert(frames.end(), out.begin(), out.end());
+        }
+        auto out = decoder.flush();
+        sw.stop();
+        frames.insert(frames.end(), out.begin(), out.end());
+        ops += refs.size();
+        deleteAll(frames);
+        deleteAll(refs);
+    }
+    return result(name, ops, sw);
+}
+
+static Result benchFilter(vector<Frame*>& frames, string spec, int repeat) {
+    auto info = frames[0]->getFrameInfo();
+    auto id = frames[0]->name();
+    auto args = "video_size=" + to_string(info.width) + "x" + to_string(info.height) + 
+        ":pix_fmt=" + info.format + ":time_base=1/" + to_string(AV_TIME_BASE);
+    Stopwatch sw;
+    int64_t ops = 0;
+    for (int i = 0; i < repeat; i++) {
+        Filterer filterer({{id, args}}, {{"out", ""}}, {{id, "video"}, {"out", "video"}}, "[" + id + "]" + spec + "[out]");
+        vector<Frame*> outs;
+        for (auto f : frames) {
+            vector<Frame*> in = {f};
+            sw.start();
+            auto out = filterer.filter(in);
+            sw.stop();
+            outs.insert(outs.end(), out.begin(), out.end());
+            ops++;
+        }
+        deleteAll(outs);
+    }
+    return result("Filterer::filter(" + spec + ")", ops, sw);
+}
+
+static Result benchEncode(string name, vector<Frame*>& frames, StreamInfo info, int repeat, vector<Packet*>* keep) {
+    Stopwatch sw;
+    int64_t ops = 0;
+    for (int i = 0; i < repeat; i++) {
+        Encoder encoder(info);
+        auto refs = refFrames(frames);
+        vector<Packet*> pkts;
+        sw.start();
+        for (auto f : refs) {
+            auto out = encoder.encode(f);
+            pkts.insert(pkts.end(), out.begin(), out.end());
+        }
+        auto out = encoder.flush();
+        sw.stop();
+        pkts.insert(pkts.end(), out.begin(), out.end());
+        ops += refs.size();
+        deleteAll(refs);
+        if (keep != NULL && keep->empty()) *keep = pkts;
+        else deleteAll(pkts);
+    }
+    return result(name, ops, sw);
+}
+
+static Result benchFIFO(vector<Frame*>& frames, int frame_size, int repeat) {
+    auto av_frame = frames[0]->av_ptr();
+    auto codec_ctx = avcodec_alloc_context3(NULL);
+    codec_ctx->sample_fmt = (AVSampleFormat)av_frame->format;
+    codec_ctx->sample_rate = av_frame->sample_rate;
+    codec_ctx->channels = av_frame->channels;
+    codec_ctx->channel_layout = av_frame->channel_layout;
+    codec_ctx->time_base = {1, av_frame->sample_rate};
+    Stopwatch sw;
+    int64_t ops = 0;
+    for (int i = 0; i < repeat; i++) {
+        AudioFrameFIFO fifo(codec_ctx);
+        sw.start();
+        for (auto f : frames) {
+            fifo.push(f);
+            ops++;
+            while (fifo.size() >= frame_size) {
+                fifo.pop(codec_ctx, frame_size);
+                ops++;
+            }
+        }
+        sw.stop();
+    }
+    avcodec_free_context(&codec_ctx);
+    return result("AudioFrameFIFO::push/pop", ops, sw);
+}
+
+static Result benchMux(string format, StreamInfo info, vector<Packet*>& pkts, int repeat) {
+    Stopwatch sw;
+    int64_t ops = 0;
+    for (int i = 0; i < repeat; i++) {
+        // discard output data
+        Muxer muxer(format, new FileWriter(""));
+        Encoder encoder(info);
+        muxer.newStream(&encoder);
+        muxer.writeHeader();
+        auto refs = refPackets(pkts);
+        sw.start();
+        for (auto p : refs)
+            muxer.writeFrame(p, 0);
+        sw.stop();
+        muxer.writeTrailer();
+        ops += refs.size();
+        deleteAll(refs);
+    }
+    return result("Muxer::writeFrame(" + format + ")", ops, sw);
+}
+
+
+int main(int argc, char** argv) {
+    string assets = "./examples/assets";
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) json = true;
+        else assets = argv[i];
+    }
+    av_log_set_level(AV_LOG_ERROR);
+    const int repeat = 3;
+    const size_t max_frames = 120;
+    auto video_path = assets + "/Bunny.mp4";
+    auto audio_path = assets + "/audio.mp3";
+    vector<Result> results;
+
+    // video
+    auto vdemuxer = openDemuxer(video_path);
+    auto vindex = findStream(vdemuxer, AVMEDIA_TYPE_VIDEO);
+    auto vpkts = readPackets(vdemuxer, vindex);
+    auto frame_rate = av_q2d(av_guess_frame_rate(vdemuxer->av_format_context(), vdemuxer->av_stream(vindex), NULL));
+    Decoder vdecoder(vdemuxer, vindex, "0:0");
+    auto vframes = decodeAll(vdecoder, refPackets(vpkts), max_frames);
+    auto vinfo = videoEncoderInfo(vframes[0], "mpeg4", frame_rate);
+    vector<Packet*> encoded;
+
+    results.push_back(benchDemux(video_path, repeat));
+    results.push_back(benchDecode("Decoder::decode(video)", vdemuxer, vindex, vpkts, repeat));
+    results.push_back(benchFilter(vframes, "scale=320:-2", repeat));
+    results.push_back(benchEncode("Encoder::encode(mpeg4)", vframes, vinfo, repeat, &encoded));
+    results.push_back(benchMux("matroska", vinfo, encoded, repeat));
+
+    // audio
+    auto ademuxer = openDemuxer(audio_path);
+    auto aindex = findStream(ademuxer, AVMEDIA_TYPE_AUDIO);
+    auto apkts = readPackets(ademuxer, aindex);
+    Decoder adecoder(ademuxer, aindex, "1:0");
+    auto aframes = decodeAll(adecoder, refPackets(apkts), SIZE_MAX);
+
+    results.push_back(benchDecode("Decoder::decode(audio)", ademuxer, aindex, apkts, repeat));
+    results.push_back(benchEncode("Encoder::encode(aac)", aframes, audioEncoderInfo(aframes[0], "aac"), repeat, NULL));
+    results.push_back(benchFIFO(aframes, 1024, repeat));
+
+    if (json) printf("[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& r = results[i];
+        if (json)
+            printf("  {\"name\": \"%s\", \"ops\": %lld, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f}%s\n",
+                r.name.c_str(), (long long)r.ops, r.ns_per_op, r.allocs_per_op, i + 1 < results.size() ? "," : "");
+        else
+            printf("%-36s %10lld ops %14.1f ns/op %10.2f allocs/op\n", 
+                r.name.c_str(), (long long)r.ops, r.ns_per_op, r.allocs_per_op);
+    }
+    if (json) printf("]\n");
+
+    deleteAll(vpkts);
+    deleteAll(vframes);
+    deleteAll(encoded);
+    deleteAll(apkts);
+    deleteAll(aframes);
+    delete vdemuxer;
+    delete ademuxer;
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * Decode fps of each Decoder preview mode (DecodeMode) on one asset, under Node.
+ * 
+ *  ./build_wasm.sh
+ *  node bench/preview.mjs [file] [--json]
+ * 
+ * Only the first video stream is decoded, output frames are counted and released.
+ */
+import fs from 'fs'
+import path from 'path'
+import { fileURLToPath } from 'url'
+import createModule from '../src/wasm/ffmpeg_built.js'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2)
+const json = args.includes('--json')
+const file = args.find(a => !a.startsWith('--')) ?? path.join(root, 'examples/assets/Bunny.mp4')
+
+const full = { lowres: 0, skipLoopFilter: '', skipIdct: '', skipFrame: '', fast: false, everyNth: 0 }
+const modes = {
+    full,
+    fast: { ...full, fast: true },
+    noLoopFilter: { ...full, skipLoopFilter: 'all' },
+    noIdctNonref: { ...full, skipIdct: 'nonref' },
+    skipNonref: { ...full, skipFrame: 'nonref' },
+    skipBidir: { ...full, skipFrame: 'bidir' },
+    every4th: { ...full, everyNth: 4 },
+    lowres1: { ...full, lowres: 1 },
+    scrub: { ...full, skipLoopFilter: 'all', skipFrame: 'nonref', fast: true },
+    keyOnly: { ...full, skipFrame: 'nonkey' },
+}
+
+/* ReaderForDemuxer over a whole file in memory */
+function fileReader(data) {
+    return {
+        size: data.byteLength,
+        offset: 0,
+        async read(buffer) {
+            const n = Math.min(buffer.byteLength, data.byteLength - this.offset)
+            buffer.set(data.subarray(this.offset, this.offset + n))
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+
+function vec2Array(vec) {
+    const arr = []
+    for (let i = 0; i < vec.size(); i++) arr.push(vec.get(i))
+    vec.delete()
+    return arr
+}
+
+async function run(ff, data, mode) {
+    const demuxer = new ff.Demuxer()
+    await demuxer.build(fileReader(data))
+    const info = vec2Array(demuxer.getMetadata().streamInfos).find(s => s.mediaType == 'video')
+    if (!info) throw `no video stream in ${file}`
+    const decoder = new ff.Decoder(demuxer, info.index, `0:${info.index}`)
+    decoder.setDecodeMode(mode)
+    const ring = new ff.FrameRing(16)
+    let frames = 0
+    const collect = () => {
+        frames += ring.size
+        ring.clear()
+    }
+    const start = performance.now()
+    while (true) {
+        const pkt = await demuxer.read()
+        if (pkt.size <= 0) { pkt.delete(); break }
+        if (pkt.streamIndex == info.index) {
+            decoder.decodeInto(pkt, ring)
+            collect()
+        }
+        pkt.delete()
+    }
+    decoder.flushInto(ring)
+    collect()
+    const seconds = (performance.now() - start) / 1000
+    ring.delete()
+    decoder.delete()
+    demuxer.delete()
+    return { frames, seconds, fps: frames / seconds }
+}
+
+const ff = await createModule({ wasmBinary: fs.readFileSync(path.join(root, 'src/wasm/ffmpeg_built.wasm')) })
+const data = fs.readFileSync(file)
+const report = {}
+for (const [name, mode] of Object.entries(modes)) {
+    report[name] = await run(ff, data, mode)
+}
+
+if (json) console.log(JSON.stringify(report, null, 2))
+else {
+    const base = report.full.seconds
+    console.log(`${path.basename(file)}`)
+    console.log(`${'mode'.padEnd(16)}${'frames'.padStart(8)}${'fps'.padStart(10)}${'time'.padStart(10)}`)
+    for (const [name, r] of Object.entries(report)) {
+        console.log(`${name.padEnd(16)}${String(r.frames).padStart(8)}${r.fps.toFixed(1).padStart(10)}` +
+            `${((r.seconds / base * 100).toFixed(0) + '%').padStart(10)}`)
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * Size and startup time of each built profile (ffmpeg_built[.<profile>][.simd].wasm), under Node:
+ * compile, instantiate, and first metadata probe of an asset.
+ *
+ *  PROFILE=audio ./build_ffmpeg.sh && PROFILE=audio ./build_wasm.sh
+ *  node bench/profiles.mjs [file] [--json]
+ */
+import fs from 'fs'
+import path from 'path'
+import zlib from 'zlib'
+import { fileURLToPath } from 'url'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2).filter(a => !a.startsWith('--'))
+const json = process.argv.includes('--json')
+const file = args[0] ?? path.join(root, 'examples/assets/Bunny.mp4')
+const wasmDir = path.join(root, 'src/wasm')
+const MB = 1024 * 1024
+
+function fileReader(data) {
+    return {
+        size: data.byteLength,
+        offset: 0,
+        async read(buffer) {
+            const n = Math.min(buffer.byteLength, data.byteLength - this.offset)
+            buffer.set(data.subarray(this.offset, this.offset + n))
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+
+async function startup(wasmPath) {
+    const binary = fs.readFileSync(wasmPath)
+    // each build is instantiated by its own JS glue (import names are minified per link)
+    const { default: createModule } = await import(wasmPath.replace(/\.wasm$/, '.js'))
+    let t = performance.now()
+    const wasmModule = await WebAssembly.compile(binary)
+    const compileMs = performance.now() - t
+    t = performance.now()
+    const ff = await createModule({
+        instantiateWasm(imports, done) {
+            WebAssembly.instantiate(wasmModule, imports).then(instance => done(instance))
+            return {}
+        },
+    })
+    const instantiateMs = performance.now() - t
+    t = performance.now()
+    const demuxer = new ff.Demuxer()
+    await demuxer.build(fileReader(fs.readFileSync(file)))
+    demuxer.getMetadata()
+    demuxer.delete()
+    const probeMs = performance.now() - t
+    return {
+        profile: ff.buildProfile(),
+        bytes: binary.byteLength,
+        gzipBytes: zlib.gzipSync(binary).byteLength,
+        compileMs, instantiateMs, probeMs,
+    }
+}
+
+const builds = fs.readdirSync(wasmDir).filter(f => /^ffmpeg_built(\.(probe|audio|transmux))?(\.simd)?\.wasm$/.test(f))
+    .filter(f => fs.existsSync(path.join(wasmDir, f.replace(/\.wasm$/, '.js')))).sort()
+const report = {}
+for (const build of builds)
+    report[build] = await startup(path.join(wasmDir, build))
+
+if (json) console.log(JSON.stringify(report, null, 2))
+else {
+    console.log(`${'build'.padEnd(34)}${'size'.padStart(10)}${'gzip'.padStart(10)}${'compile'.padStart(10)}${'init'.padStart(10)}${'probe'.padStart(10)}`)
+    for (const [build, r] of Object.entries(report))
+        console.log(`${build.padEnd(34)}${((r.bytes / MB).toFixed(1) + ' MB').padStart(10)}${((r.gzipBytes / MB).toFixed(1) + ' MB').padStart(10)}` +
+            `${(r.compileMs.toFixed(0) + ' ms').padStart(10)}${(r.instantiateMs.toFixed(0) + ' ms').padStart(10)}${(r.probeMs.toFixed(0) + ' ms').padStart(10)}`)
+}
@@ -0,0 +1,91 @@
+/**
+ * Long-run soak: transcode the same asset repeatedly (decode -> mpeg4 encode -> discarded mkv),
+ * and print wasm heap size, live allocations and pooled buffers after each round.
+ * With buffer pools the heap should stay flat after the first rounds.
+ * 
+ *  node bench/soak.mjs [file] [rounds] [--json]
+ */
+import fs from 'fs'
+import path from 'path'
+import { fileURLToPath } from 'url'
+import createModule from '../src/wasm/ffmpeg_built.js'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2).filter(a => !a.startsWith('--'))
+const json = process.argv.includes('--json')
+const file = args[0] ?? path.join(root, 'examples/assets/Bunny.mp4')
+const rounds = parseInt(args[1] ?? '50')
+const data = fs.readFileSync(file)
+const MB = 1024 * 1024
+
+function fileReader(data) {
+    return {
+        size: data.byteLength,
+        offset: 0,
+        async read(buffer) {
+            const n = Math.min(buffer.byteLength, data.byteLength - this.offset)
+            buffer.set(data.subarray(this.offset, this.offset + n))
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+
+function vec2Array(vec) {
+    const arr = []
+    for (let i = 0; i < vec.size(); i++) arr.push(vec.get(i))
+    vec.delete()
+    return arr
+}
+
+async function transcode(ff) {
+    const demuxer = new ff.Demuxer()
+    await demuxer.build(fileReader(data))
+    const decoders = {}
+    let video = undefined
+    for (const info of vec2Array(demuxer.getMetadata().streamInfos)) {
+        if (info.mediaType != 'video' && info.mediaType != 'audio') continue
+        decoders[info.index] = new ff.Decoder(demuxer, info.index, `0:${info.index}`)
+        if (info.mediaType == 'video' && !video) video = info
+    }
+    const muxer = new ff.Muxer('matroska', { offset: 0, write(d) { this.offset += d.byteLength }, seek(pos) { this.offset = pos } })
+    const encoder = new ff.Encoder({ ...video, codecName: 'mpeg4', format: 'yuv420p', bitRate: 1000000 })
+    muxer.newStreamWithEncoder(encoder)
+    muxer.writeHeader()
+    const write = pkts => pkts.forEach(p => { muxer.writeFrame(p, 0); p.delete() })
+    while (true) {
+        const pkt = await demuxer.read()
+        if (pkt.size <= 0) { pkt.delete(); break }
+        const streamIndex = pkt.streamIndex
+        const decoder = decoders[streamIndex]
+        const frames = decoder ? vec2Array(decoder.decode(pkt)) : []
+        pkt.delete()
+        for (const f of frames) {
+            if (streamIndex == video.index) write(vec2Array(encoder.encode(f)))
+            f.delete()
+        }
+    }
+    write(vec2Array(encoder.flush()))
+    muxer.writeTrailer()
+    Object.values(decoders).forEach(d => d.delete())
+    encoder.delete()
+    muxer.delete()
+    demuxer.delete()
+}
+
+const ff = await createModule({ wasmBinary: fs.readFileSync(path.join(root, 'src/wasm/ffmpeg_built.wasm')) })
+const report = []
+for (let i = 0; i < rounds; i++) {
+    await transcode(ff)
+    const mem = ff.getMemoryInfo()
+    const pool = ff.getBufferPoolInfo()
+    const row = { round: i, heapSize: mem.heapSize, current: mem.current, highWater: mem.highWater, poolBytes: pool.bytes }
+    report.push(row)
+    if (!json)
+        console.log(`round ${i}: heap ${(row.heapSize / MB).toFixed(1)} MB, live ${(row.current / MB).toFixed(1)} MB, ` +
+            `high-water ${(row.highWater / MB).toFixed(1)} MB, pooled ${(row.poolBytes / MB).toFixed(1)} MB`)
+}
+const growth = report[report.length - 1].heapSize - report[Math.min(2, report.length - 1)].heapSize
+if (json) console.log(JSON.stringify({ file, rounds, growthAfterWarmup: growth, report }, null, 2))
+else console.log(`heap growth after warmup: ${(growth / MB).toFixed(1)} MB`)
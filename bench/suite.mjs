@@ -0,0 +1,268 @@
+/**
+ * End-to-end benchmark suite under Node: canonical jobs over ./examples/assets and a synthetic 720p input,
+ * reporting fps, MB/s (of input), peak heap and per-stage time (ms), compared against a stored baseline.
+ *
+ *  ./build_wasm.sh            # or NODE=1 ./build_wasm.sh, and pass --node
+ *  node bench/suite.mjs [--json] [--node] [--update-baseline] [--baseline=file] [--tolerance=0.15]
+ *
+ * Exits with code 1 when fps of a job is below baseline by more than tolerance.
+ * Baselines are machine specific, store one per machine (default bench/baseline.json).
+ */
+import fs from 'fs'
+import path from 'path'
+import { fileURLToPath } from 'url'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2)
+const option = (name, value) => args.find(a => a.startsWith(`--${name}=`))?.split('=')[1] ?? value
+const json = args.includes('--json')
+const node = args.includes('--node')
+const updateBaseline = args.includes('--update-baseline')
+const baselinePath = option('baseline', path.join(root, 'bench/baseline.json'))
+const tolerance = parseFloat(option('tolerance', '0.15'))
+const assets = path.join(root, 'examples/assets')
+const MB = 1024 * 1024
+
+const name = node ? 'ffmpeg_built.node' : 'ffmpeg_built'
+const { default: createModule } = await import(`../src/wasm/${name}.${node ? 'mjs' : 'js'}`)
+const wasmModule = await WebAssembly.compile(fs.readFileSync(path.join(root, `src/wasm/${name}.wasm`)))
+/* fresh instance for each job, so that peak heap is of that job only */
+const instantiate = () => createModule({
+    instantiateWasm(imports, done) {
+        WebAssembly.instantiate(wasmModule, imports).then(instance => done(instance))
+        return {}
+    },
+})
+
+function fileReader(data) {
+    return {
+        size: data.byteLength,
+        offset: 0,
+        async read(buffer) {
+            const n = Math.min(buffer.byteLength, data.byteLength - this.offset)
+            buffer.set(data.subarray(this.offset, this.offset + n))
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+
+/* writer keeping only size, or all chunks when `keep` (synthetic input) */
+function sizeWriter(keep = false) {
+    return {
+        offset: 0, size: 0, chunks: [],
+        write(data) {
+            if (keep) this.chunks.push({ offset: this.offset, data: data.slice() })
+            this.offset += data.byteLength
+            this.size = Math.max(this.size, this.offset)
+        },
+        seek(pos) { this.offset = pos },
+        toBuffer() {
+            const buffer = new Uint8Array(this.size)
+            this.chunks.forEach(c => buffer.set(c.data, c.offset))
+            return buffer
+        },
+    }
+}
+
+function vec2Array(vec) {
+    const arr = []
+    for (let i = 0; i < vec.size(); i++) arr.push(vec.get(i))
+    vec.delete()
+    return arr
+}
+
+async function openInput(ff, data) {
+    const demuxer = new ff.Demuxer()
+    await demuxer.build(fileReader(data))
+    const streams = vec2Array(demuxer.getMetadata().streamInfos)
+    return { demuxer, streams }
+}
+
+function filterer(ff, id, info, dataFormat, spec) {
+    const isVideo = info.mediaType == 'video'
+    const inArgs = isVideo ?
+        `video_size=${info.width}x${info.height}:pix_fmt=${dataFormat.format}:time_base=1/1000000:pixel_aspect=1/1` :
+        `sample_rate=${dataFormat.sampleRate}:sample_fmt=${dataFormat.format}:channel_layout=${dataFormat.channelLayout}:time_base=1/1000000`
+    const inParams = ff.createStringStringMap()
+    const outParams = ff.createStringStringMap()
+    const mediaTypes = ff.createStringStringMap()
+    inParams.set(id, inArgs)
+    outParams.set('out', '')
+    mediaTypes.set(id, info.mediaType)
+    mediaTypes.set('out', info.mediaType)
+    return new ff.Filterer(inParams, outParams, mediaTypes, spec)
+}
+
+function filterFrames(ff, filterer, frames) {
+    const inVec = ff.createFrameVector()
+    frames.forEach(f => inVec.push_back(f))
+    const outs = vec2Array(filterer.filter(inVec))
+    inVec.delete()
+    frames.forEach(f => f.delete())
+    return outs
+}
+
+/**
+ * decode one stream -> [filter] -> [encode -> mux], return number of frames decoded.
+ * createFilterer(decoder) builds filterer from decoder data format.
+ * stages: {demuxer, decoder, filterer?, encoder?, muxer?} are collected for stats.
+ */
+async function transcodeStream(ff, demuxer, index, { createFilterer, encoder, muxer }, stages) {
+    const decoder = new ff.Decoder(demuxer, index, 'in')
+    const filterer = createFilterer?.(decoder)
+    Object.assign(stages, { decoder, ...(filterer ? { filterer } : {}) })
+    let frames = 0
+    const write = pkts => pkts.forEach(p => { muxer.writeFrame(p, 0); p.delete() })
+    const encode = outs => outs.forEach(f => {
+        if (encoder) write(vec2Array(encoder.encode(f)))
+        f.delete()
+    })
+    const handle = decoded => {
+        frames += decoded.length
+        encode(filterer ? filterFrames(ff, filterer, decoded) : decoded)
+    }
+    muxer?.writeHeader()
+    while (true) {
+        const pkt = await demuxer.read()
+        if (pkt.size <= 0) { pkt.delete(); break }
+        if (pkt.streamIndex == index) handle(vec2Array(decoder.decode(pkt)))
+        pkt.delete()
+    }
+    handle(vec2Array(decoder.flush()))
+    if (filterer) encode(vec2Array(filterer.flush()))
+    if (encoder) write(vec2Array(encoder.flush()))
+    muxer?.writeTrailer()
+    return frames
+}
+
+const jobs = {
+    /* packets copied into another container */
+    async transmux(ff, data, stages) {
+        const { demuxer, streams } = await openInput(ff, data)
+        const muxer = new ff.Muxer('mp4', sizeWriter())
+        Object.assign(stages, { demuxer, muxer })
+        const outIndex = {}
+        streams.forEach((s, i) => { outIndex[s.index] = i; muxer.newStreamWithDemuxer(demuxer, s.index) })
+        muxer.writeHeader()
+        let packets = 0
+        while (true) {
+            const pkt = await demuxer.read()
+            if (pkt.size <= 0) { pkt.delete(); break }
+            muxer.writeFrame(pkt, outIndex[pkt.streamIndex])
+            pkt.delete()
+            packets++
+        }
+        muxer.writeTrailer()
+        return packets
+    },
+    /* video only, to vp8 webm */
+    async vp8(ff, data, stages) {
+        const { demuxer, streams } = await openInput(ff, data)
+        const video = streams.find(s => s.mediaType == 'video')
+        const encoder = new ff.Encoder({ ...video, codecName: 'vp8', format: 'yuv420p', bitRate: 1000000 })
+        const muxer = new ff.Muxer('webm', sizeWriter())
+        muxer.newStreamWithEncoder(encoder)
+        Object.assign(stages, { demuxer, encoder, muxer })
+        return transcodeStream(ff, demuxer, video.index, { encoder, muxer }, stages)
+    },
+    /* audio only, to aac mp4 */
+    async aac(ff, data, stages) {
+        const { demuxer, streams } = await openInput(ff, data)
+        const audio = streams.find(s => s.mediaType == 'audio')
+        const encoder = new ff.Encoder({ ...audio, codecName: 'aac', format: 'fltp', bitRate: 128000 })
+        const muxer = new ff.Muxer('mp4', sizeWriter())
+        muxer.newStreamWithEncoder(encoder)
+        Object.assign(stages, { demuxer, encoder, muxer })
+        const createFilterer = decoder => filterer(ff, 'in', audio, decoder.dataFormat, '[in]aformat=sample_fmts=fltp[out]')
+        return transcodeStream(ff, demuxer, audio.index, { createFilterer, encoder, muxer }, stages)
+    },
+    /* video trim + scale graph, frames discarded */
+    async trimScale(ff, data, stages) {
+        const { demuxer, streams } = await openInput(ff, data)
+        const video = streams.find(s => s.mediaType == 'video')
+        stages.demuxer = demuxer
+        const createFilterer = decoder => filterer(ff, 'in', video, decoder.dataFormat, '[in]trim=start=1:end=6,setpts=PTS-STARTPTS,scale=640:-2[out]')
+        return transcodeStream(ff, demuxer, video.index, { createFilterer }, stages)
+    },
+}
+
+/* 720p mpeg4 mkv of moving noise (hard to compress), encoded once */
+async function syntheticInput(seconds = 10, fps = 30) {
+    const ff = await instantiate()
+    const { demuxer, streams } = await openInput(ff, fs.readFileSync(path.join(assets, 'Bunny.mp4')))
+    const template = streams.find(s => s.mediaType == 'video')
+    const info = { ...template, codecName: 'mpeg4', format: 'yuv420p', width: 1280, height: 720,
+        frameRate: fps, timeBase: { num: 1, den: fps }, bitRate: 8000000 }
+    const writer = sizeWriter(true)
+    const muxer = new ff.Muxer('matroska', writer)
+    const encoder = new ff.Encoder(info)
+    muxer.newStreamWithEncoder(encoder)
+    muxer.writeHeader()
+    const noise = new Uint8Array(2 * info.width * info.height).map(() => Math.random() * 256)
+    const write = pkts => pkts.forEach(p => { muxer.writeFrame(p, 0); p.delete() })
+    for (let i = 0; i < seconds * fps; i++) {
+        const frame = new ff.Frame({ format: 'yuv420p', width: info.width, height: info.height,
+            channels: 0, sampleRate: 0, nbSamples: 0, channelLayout: '' }, i * 1000000 / fps, 'synthetic')
+        for (const plane of vec2Array(frame.getPlanes()))
+            plane.set(noise.subarray(i * 997 % plane.length, i * 997 % plane.length + plane.length))
+        write(vec2Array(encoder.encode(frame)))
+        frame.delete()
+    }
+    write(vec2Array(encoder.flush()))
+    muxer.writeTrailer()
+    ;[encoder, muxer, demuxer].forEach(o => o.delete())
+    return writer.toBuffer()
+}
+
+const read = file => fs.readFileSync(path.join(assets, file))
+const synthetic = await syntheticInput()
+const cases = [
+    ['transmux Bunny.mkv -> mp4', 'transmux', read('Bunny.mkv')],
+    ['transmux synthetic720p.mkv -> mp4', 'transmux', synthetic],
+    ['h264 Bunny.mp4 -> vp8', 'vp8', read('Bunny.mp4')],
+    ['mpeg4 synthetic720p.mkv -> vp8', 'vp8', synthetic],
+    ['mp3 audio.mp3 -> aac', 'aac', read('audio.mp3')],
+    ['trim+scale Bunny.mp4', 'trimScale', read('Bunny.mp4')],
+    ['trim+scale synthetic720p.mkv', 'trimScale', synthetic],
+]
+
+const report = {}
+for (const [name, job, data] of cases) {
+    const ff = await instantiate()
+    ff.enableStats(true)
+    const stages = {}
+    const start = performance.now()
+    const frames = await jobs[job](ff, data, stages)
+    const seconds = (performance.now() - start) / 1000
+    const memory = ff.getMemoryInfo()
+    report[name] = {
+        frames,
+        seconds,
+        fps: frames / seconds,
+        mbps: data.byteLength / MB / seconds,
+        peakHeap: memory.heapSize,
+        peakAllocated: memory.highWater,
+        stages: Object.fromEntries(Object.entries(stages).map(([k, s]) => [k, s.getStats().processTime])),
+    }
+    Object.values(stages).forEach(s => s.delete())
+}
+
+const baseline = fs.existsSync(baselinePath) ? JSON.parse(fs.readFileSync(baselinePath, 'utf8')) : undefined
+const regressions = baseline ? Object.entries(report).filter(([name, r]) =>
+    baseline[name] && r.fps < baseline[name].fps * (1 - tolerance)).map(([name]) => name) : []
+
+if (json) console.log(JSON.stringify({ tolerance, baseline: baseline ? baselinePath : null, regressions, report }, null, 2))
+else {
+    console.log(`${'job'.padEnd(36)}${'fps'.padStart(10)}${'MB/s'.padStart(8)}${'peak heap'.padStart(12)}${'baseline'.padStart(10)}`)
+    for (const [name, r] of Object.entries(report)) {
+        const base = baseline?.[name] ? (r.fps / baseline[name].fps * 100 - 100).toFixed(0) + '%' : '-'
+        console.log(`${name.padEnd(36)}${r.fps.toFixed(1).padStart(10)}${r.mbps.toFixed(2).padStart(8)}` +
+            `${((r.peakHeap / MB).toFixed(0) + ' MB').padStart(12)}${base.padStart(10)}`)
+    }
+    if (!baseline) console.log(`no baseline at ${baselinePath} (create with --update-baseline)`)
+    regressions.forEach(name => console.log(`regression: ${name}`))
+}
+if (updateBaseline) fs.writeFileSync(baselinePath, JSON.stringify(report, null, 2) + '\n')
+process.exitCode = regressions.length > 0 && !updateBaseline ? 1 : 0
@@ -0,0 +1,79 @@
+/**
+ * Native Pipeline (decode -> scale -> vp8 encode -> webm) with stages in sequence vs on threads,
+ * with the pthread build.
+ *
+ *  THREADS=1 ./build_wasm.sh
+ *  node bench/threads.mjs [file] [--json]
+ */
+import fs from 'fs'
+import path from 'path'
+import { fileURLToPath } from 'url'
+import createModule from '../src/wasm/ffmpeg_built.threads.js'
+
+const root = path.join(path.dirname(fileURLToPath(import.meta.url)), '..')
+const args = process.argv.slice(2).filter(a => !a.startsWith('--'))
+const json = process.argv.includes('--json')
+const file = args[0] ?? path.join(root, 'examples/assets/Bunny.mp4')
+const data = fs.readFileSync(file)
+
+function fileReader(data) {
+    return {
+        size: data.byteLength,
+        offset: 0,
+        async read(buffer) {
+            const n = Math.min(buffer.byteLength, data.byteLength - this.offset)
+            buffer.set(data.subarray(this.offset, this.offset + n))
+            this.offset += n
+            return n
+        },
+        async seek(pos) { this.offset = pos },
+    }
+}
+
+function sizeWriter() {
+    return {
+        offset: 0, size: 0,
+        write(data) {
+            this.offset += data.byteLength
+            this.size = Math.max(this.size, this.offset)
+        },
+        seek(pos) { this.offset = pos },
+    }
+}
+
+function vec2Array(vec) {
+    const arr = []
+    for (let i = 0; i < vec.size(); i++) arr.push(vec.get(i))
+    vec.delete()
+    return arr
+}
+
+async function transcode(ff, threaded) {
+    const demuxer = new ff.Demuxer()
+    await demuxer.build(fileReader(data))
+    const video = vec2Array(demuxer.getMetadata().streamInfos).find(s => s.mediaType == 'video')
+    const pipeline = new ff.Pipeline()
+    pipeline.addDecoder(demuxer, video.index, 'in')
+    const [inTypes, outTypes] = [ff.createStringStringMap(), ff.createStringStringMap()]
+    inTypes.set('in', 'video')
+    outTypes.set('out', 'video')
+    pipeline.setFilter(inTypes, outTypes, '[in]scale=640:360[out]')
+    const writer = sizeWriter()
+    const muxer = new ff.Muxer('webm', writer)
+    pipeline.addEncoder('out', muxer, { ...video, codecName: 'vp8', format: 'yuv420p', width: 640, height: 360, bitRate: 1000000 })
+    const enabled = pipeline.setThreaded(threaded)
+    const start = performance.now()
+    while (!(await pipeline.step(32)).end);
+    const seconds = (performance.now() - start) / 1000
+    pipeline.delete()
+    muxer.delete()
+    demuxer.delete()
+    return { threaded: enabled, seconds, speed: video.duration / seconds, outputBytes: writer.size }
+}
+
+const ff = await createModule()
+const report = { sequential: await transcode(ff, false), threaded: await transcode(ff, true) }
+
+if (json) console.log(JSON.stringify({ file, ...report }, null, 2))
+else for (const [mode, r] of Object.entries(report))
+    console.log(`${mode.padEnd(12)}${(r.seconds.toFixed(2) + ' s').padStart(10)}${(r.speed.toFixed(2) + 'x').padStart(10)}  (${r.outputBytes} bytes)`)
@@ -14,6 +14,36 @@ source $EMSDK_ROOT/emsdk_env.sh
 
 CFLAGS="-s USE_PTHREADS=1 -O3"
 
+# `SIMD=1 ./build_ffmpeg.sh` builds the WebAssembly SIMD128 variant.
+# x86 asm cannot target wasm, so SIMD comes from LLVM auto-vectorization of C code
+# (swscale/swresample conversions, x264/vpx pixel compares, DCTs...).
+# FFmpeg only builds in its source tree, so the variant uses a copy of it.
+if [ "$SIMD" = "1" ]; then
+  if [ ! -d "$ROOT/FFmpeg-simd" ]; then
+    cp -r "$FFMPEG" "$ROOT/FFmpeg-simd"
+    (cd "$ROOT/FFmpeg-simd" && make distclean || true)
+  fi
+  FFMPEG=$ROOT/FFmpeg-simd
+  EXT_LIB_BUILD=$EXT_LIB/build-simd
+  EXT_LIB_BUILD_PKG_CONFIG=$EXT_LIB_BUILD/lib/pkgconfig
+  CFLAGS="$CFLAGS -msimd128"
+fi
+
+# `PROFILE=<name> ./build_ffmpeg.sh` builds only components allowlisted in build_profiles/<name>.sh
+# (probe, audio, transmux), default `full` is all components. Each profile uses its own copy of FFmpeg.
+PROFILE=${PROFILE:-full}
+EXTERNAL_LIBS=(x264 vpx)
+if [ "$PROFILE" != "full" ]; then
+  source "$ROOT/build_profiles/$PROFILE.sh"
+  PROFILE_FFMPEG=$FFMPEG-$PROFILE
+  if [ ! -d "$PROFILE_FFMPEG" ]; then
+    cp -r "$FFMPEG" "$PROFILE_FFMPEG"
+    (cd "$PROFILE_FFMPEG" && make distclean || true)
+  fi
+  FFMPEG=$PROFILE_FFMPEG
+fi
+has_lib() { [[ " ${EXTERNAL_LIBS[*]} " == *" $1 "* ]]; }
+
 
 ###################
 # External libraries build
@@ -21,6 +51,7 @@ CFLAGS="-s USE_PTHREADS=1 -O3"
 
 # external libraries
 # x264
+if has_lib x264; then
 cd "$EXT_LIB"/x264 && emconfigure ./configure \
   --prefix="${EXT_LIB_BUILD}" \
   --host=i686-gnu \
@@ -30,8 +61,10 @@ cd "$EXT_LIB"/x264 && emconfigure ./configure \
   --extra-cflags="$CFLAGS"
 cd "$EXT_LIB"/x264 && emmake make clean
 cd "$EXT_LIB"/x264 && emmake make install-lib-static -j4
+fi
 
 # libvpx
+if has_lib vpx; then
 cd "$EXT_LIB"/libvpx && emconfigure ./configure \
   --prefix="${EXT_LIB_BUILD}" \
   --target=generic-gnu \
@@ -43,7 +76,9 @@ cd "$EXT_LIB"/libvpx && emconfigure ./configure \
   --disable-dependency-tracking \
   --extra-cflags="$CFLAGS" \
   --extra-cxxflags="$CFLAGS"
+cd "$EXT_LIB"/libvpx && emmake make clean
 cd "$EXT_LIB"/libvpx && emmake make install -j4
+fi
 
 # export global env variable for FFmpeg to detect
 export EM_PKG_CONFIG_PATH=$EXT_LIB_BUILD_PKG_CONFIG
@@ -79,10 +114,6 @@ CONFIG_ARGS=(
   --disable-protocols
   --enable-protocol=file
 
-  # external libraries
-  --enable-libx264
-  --enable-libvpx
-  
   --disable-sdl2
   --disable-hwaccels
   --disable-doc
@@ -99,6 +130,21 @@ CONFIG_ARGS=(
   --objcc=emcc
   --dep-cc=emcc
 )
+# external libraries
+has_lib x264 && CONFIG_ARGS+=(--enable-libx264)
+has_lib vpx && CONFIG_ARGS+=(--enable-libvpx)
+
+# allowlisted components only
+if [ "$PROFILE" != "full" ]; then
+  CONFIG_ARGS+=(--disable-demuxers --disable-muxers --disable-decoders --disable-encoders --disable-parsers --disable-filters)
+  for c in "${DEMUXERS[@]}"; do CONFIG_ARGS+=(--enable-demuxer=$c); done
+  for c in "${MUXERS[@]}"; do CONFIG_ARGS+=(--enable-muxer=$c); done
+  for c in "${DECODERS[@]}"; do CONFIG_ARGS+=(--enable-decoder=$c); done
+  for c in "${ENCODERS[@]}"; do CONFIG_ARGS+=(--enable-encoder=$c); done
+  for c in "${PARSERS[@]}"; do CONFIG_ARGS+=(--enable-parser=$c); done
+  for c in "${FILTERS[@]}"; do CONFIG_ARGS+=(--enable-filter=$c); done
+fi
+
 # build FFmpeg library
 cd "$FFMPEG" && emconfigure ./configure "${CONFIG_ARGS[@]}"
 read -r -p "Check the FFmpeg configure, and press key to continue..."
@@ -0,0 +1,8 @@
+# audio transcoding (decode -> filters -> aac/flac/pcm), and probing of any input.
+DEMUXERS=(aac avi flac h264 hevc m4v matroska mov mp3 mpegts ogg wav)
+PARSERS=(aac av1 flac h264 hevc mpeg4video mpegaudio opus vorbis vp8 vp9)
+DECODERS=(aac aac_latm alac flac mp2 mp3 mp3float opus vorbis pcm_alaw pcm_f32le pcm_mulaw pcm_s16be pcm_s16le pcm_s24le pcm_s32le pcm_u8)
+ENCODERS=(aac flac pcm_f32le pcm_s16le)
+MUXERS=(adts flac ipod matroska mov mp3 mp4 ogg wav webm)
+FILTERS=(buffer buffersink abuffer abuffersink aformat aresample atrim asetpts asettb afifo volume amerge concat asplit anull)
+EXTERNAL_LIBS=()
@@ -0,0 +1,9 @@
+# metadata probing only (Demuxer.getMetadata): demuxers and parsers, no codecs.
+# stream parameters (size, pixel/sample format...) come from parsers and container headers.
+DEMUXERS=(aac avi flac h264 hevc m4v matroska mov mp3 mpegts ogg wav)
+PARSERS=(aac av1 flac h264 hevc mpeg4video mpegaudio opus vorbis vp8 vp9)
+DECODERS=()
+ENCODERS=()
+MUXERS=()
+FILTERS=(buffer buffersink abuffer abuffersink)
+EXTERNAL_LIBS=()
@@ -0,0 +1,9 @@
+# container conversion by copying packets (Remuxer), no codecs:
+# smart cut / concat of incompatible sources need the full build.
+DEMUXERS=(aac avi flac h264 hevc m4v matroska mov mp3 mpegts ogg wav)
+PARSERS=(aac av1 flac h264 hevc mpeg4video mpegaudio opus vorbis vp8 vp9)
+DECODERS=()
+ENCODERS=()
+MUXERS=(adts avi flac ipod matroska mov mp3 mp4 mpegts ogg wav webm)
+FILTERS=(buffer buffersink abuffer abuffersink)
+EXTERNAL_LIBS=()
@@ -4,6 +4,49 @@ ROOT=$PWD
 EMSDK_ROOT=$ROOT/emsdk
 FFMPEG=$ROOT/FFmpeg
 EXT_LIB_BUILD=$ROOT/ffmpeg_libraries/build
+NAME="ffmpeg_built"
+EXT="js"
+ENVIRONMENT="web,worker,node" # node for benchmarks
+SIMD_FLAGS=()
+
+# `SIMD=1 ./build_wasm.sh` links the SIMD128 variant (after `SIMD=1 ./build_ffmpeg.sh`), with its own JS glue.
+if [ "$SIMD" = "1" ]; then
+  FFMPEG=$ROOT/FFmpeg-simd
+  EXT_LIB_BUILD=$ROOT/ffmpeg_libraries/build-simd
+  NAME="ffmpeg_built.simd"
+  SIMD_FLAGS=(-msimd128)
+fi
+
+# `PROFILE=<name> ./build_wasm.sh` links a slim build (ffmpeg_built.<name>.wasm/.js) after `PROFILE=<name> ./build_ffmpeg.sh`.
+PROFILE=${PROFILE:-full}
+EXTERNAL_LIBS=(x264 vpx)
+if [ "$PROFILE" != "full" ]; then
+  source "$ROOT/build_profiles/$PROFILE.sh"
+  FFMPEG=$FFMPEG-$PROFILE
+  NAME="ffmpeg_built.$PROFILE${NAME#ffmpeg_built}"
+fi
+EXT_LIB_FLAGS=()
+for lib in "${EXTERNAL_LIBS[@]}"; do EXT_LIB_FLAGS+=(-l$lib); done
+
+# `NODE=1 ./build_wasm.sh` links a Node-only variant (ffmpeg_built.node.mjs/.wasm) for headless runs and servers,
+# without browser code paths in its JS glue.
+# Host files are accessed directly (NODERAWFS) by Demuxer.buildFromFile/Muxer.toFile.
+FS_FLAGS=(-s FILESYSTEM=0)
+if [ "$NODE" = "1" ]; then
+  NAME="ffmpeg_built.node"
+  EXT="mjs"
+  ENVIRONMENT="node"
+  FS_FLAGS=(-s FILESYSTEM=1 -s NODERAWFS=1)
+fi
+
+# `THREADS=1 ./build_wasm.sh` links a pthread variant (ffmpeg_built[.node].threads), where Pipeline runs
+# decode/filter/encode stages on threads (Pipeline.setThreaded). FFmpeg libraries are already built with pthreads.
+# It needs SharedArrayBuffer (Node, or cross-origin isolated pages) and has its own JS glue (pthread workers).
+THREAD_FLAGS=()
+if [ "$THREADS" = "1" ]; then
+  NAME="$NAME.threads"
+  THREAD_FLAGS=(-pthread -s PTHREAD_POOL_SIZE=8)
+fi
 
 # activate emcc
 source $EMSDK_ROOT/emsdk_env.sh
@@ -12,7 +55,6 @@ source $EMSDK_ROOT/emsdk_env.sh
 emcc -v
 
 
-NAME="ffmpeg_built"
 WASM_DIR="./src/wasm"
 
 # build ffmpeg.wasm (FFmpeg library + src/cpp/*)
@@ -20,21 +62,25 @@ mkdir -p $WASM_DIR
 ARGS=(
   -Isrc/cpp -I$FFMPEG src/cpp/*.cpp
   -L$FFMPEG/libavcodec -L$FFMPEG/libavfilter -L$FFMPEG/libavformat -L$FFMPEG/libavutil -L$FFMPEG/libswresample -L$FFMPEG/libswscale -L$FFMPEG/libpostproc -L$EXT_LIB_BUILD/lib
-  -lavfilter -lavformat -lavcodec -lavutil -lswresample -lswscale -lpostproc -lx264 -lvpx
+  -lavfilter -lavformat -lavcodec -lavutil -lswresample -lswscale -lpostproc "${EXT_LIB_FLAGS[@]}"
+  -DBUILD_PROFILE=\"$PROFILE\"
   # -Wno-deprecated-declarations -Wno-pointer-sign -Wno-implicit-int-float-conversion -Wno-switch -Wno-parentheses -Qunused-arguments
   # -fno-rtti -fno-exceptions
   -lembind
-  -o $WASM_DIR/$NAME.js
+  "${SIMD_FLAGS[@]}"
+  "${THREAD_FLAGS[@]}"
+  -o $WASM_DIR/$NAME.$EXT
 
   # all settings can be see at: https://github.com/emscripten-core/emscripten/blob/main/src/settings.js
   -s INITIAL_MEMORY=33554432      # 33554432 bytes = 32 MB
   -s MODULARIZE=1
   -s EXPORT_ES6=1
-  -s EXPORT_NAME=$NAME
-  -s FILESYSTEM=0
+  -s EXPORT_NAME=ffmpeg_built
+  "${FS_FLAGS[@]}"
   -s WASM_BIGINT=1 # need platform support JS BigInt
-  -s ENVIRONMENT='web,worker' # node?
+  -s ENVIRONMENT=$ENVIRONMENT
   -s ALLOW_MEMORY_GROWTH=1
+  -s EXPORTED_FUNCTIONS=_malloc,_free # destination buffers of Frame.copyTo
   
   -s ASYNCIFY # need -O3 when enable asyncify
   -O3
@@ -43,6 +89,23 @@ ARGS=(
 echo "${ARGS[@]}"
 em++ "${ARGS[@]}"
 
+echo "$WASM_DIR/$NAME.wasm: $(stat -c %s $WASM_DIR/$NAME.wasm) bytes, $(gzip -c $WASM_DIR/$NAME.wasm | wc -c) gzipped"
+
+# pthread variant is only for scripts (bench/) and cross-origin isolated apps, not bundled
+if [ "$THREADS" = "1" ]; then
+  exit 0
+fi
+# SIMD and profile variants are separate links (-O3 minifies import/export names per link, and a profile imports
+# fewer functions), so each keeps its own JS glue, loaded by the worker together with its wasm.
+# They share the types of the default build.
+if [ "$SIMD" = "1" ] || [ "$PROFILE" != "full" ]; then
+  exit 0
+fi
+# Node variant is only for scripts (bench/), not bundled
+if [ "$NODE" = "1" ]; then
+  exit 0
+fi
+
 # copy *.d.ts to enable typescript
 TYPE_WASM=src/ts/types/ffmpeg.d.ts
 echo "copy $TYPE_WASM to $WASM_DIR/$NAME.d.ts"
@@ -10,6 +10,23 @@
 #include "decode.h"
 #include "filter.h"
 #include "muxer.h"
+#include "remuxer.h"
+#include "smart_cut.h"
+#include "concat.h"
+#include "pipeline.h"
+#include "fanout.h"
+#include "peaks.h"
+#include "scene.h"
+#include "quality.h"
+#include "frame_cache.h"
+#include "stats.h"
+#include "log.h"
+#include "memory.h"
+#include "live.h"
+#include "speed.h"
+#include "features.h"
+#include "buffer_pool.h"
+#include "result_ring.h"
 using namespace emscripten;
 
 
@@ -53,17 +70,29 @@ EMSCRIPTEN_BINDINGS(demuxer) {
     class_<Demuxer>("Demuxer")
         // .constructor<emscripten::val>()
         .constructor<>()
-        .function("build", &Demuxer::build)
+        .function("build", select_overload<void(emscripten::val)>(&Demuxer::build))
+        .function("buildFromFile", &Demuxer::buildFromFile)
         .function("seek", &Demuxer::seek)
         .function("read", &Demuxer::read, allow_raw_pointers())
         .function("dump", &Demuxer::dump)
         .function("getTimeBase", &Demuxer::getTimeBase)
         .function("getMetadata", &Demuxer::getMetadata)
         .function("currentTime", &Demuxer::currentTime)
+        .function("getStats", &Demuxer::getStats)
+        .function("getMemory", &Demuxer::getMemory)
     ;
 }
 
 EMSCRIPTEN_BINDINGS(decode) {
+    value_object<DecodeMode>("DecodeMode")
+        .field("lowres", &DecodeMode::lowres)
+        .field("skipLoopFilter", &DecodeMode::skip_loop_filter)
+        .field("skipIdct", &DecodeMode::skip_idct)
+        .field("skipFrame", &DecodeMode::skip_frame)
+        .field("fast", &DecodeMode::fast)
+        .field("everyNth", &DecodeMode::every_nth)
+    ;
+
     class_<Decoder>("Decoder")
         .constructor<Demuxer*, int, std::string>(allow_raw_pointers())
         .constructor<StreamInfo, std::string>()
@@ -72,6 +101,13 @@ EMSCRIPTEN_BINDINGS(decode) {
         .property("dataFormat", &Decoder::dataFormat)
         .function("decode", &Decoder::decode, allow_raw_pointers())
         .function("flush", &Decoder::flush, allow_raw_pointers())
+        .function("decodeInto", &Decoder::decodeInto, allow_raw_pointers())
+        .function("flushInto", &Decoder::flushInto, allow_raw_pointers())
+        .function("setDecodeMode", &Decoder::setDecodeMode)
+        .function("getDecodeMode", &Decoder::getDecodeMode)
+        .function("flushBuffers", &Decoder::flushBuffers)
+        .function("getStats", &Decoder::getStats)
+        .function("getMemory", &Decoder::getMemory)
     ;
 
 }
@@ -114,15 +150,27 @@ EMSCRIPTEN_BINDINGS(frame) {
         .property("pts", &Frame::doublePTS)
         .property("name", &Frame::name)
         .function("getPlanes", &Frame::getPlanes)
+        .function("copySize", &Frame::copySize)
+        .function("copyTo", &Frame::copyTo)
         .function("dump", &Frame::dump)
     ;
 }
 
 EMSCRIPTEN_BINDINGS(filter) {
+    value_object<FilterGraphInfo>("FilterGraphInfo")
+        .field("reinits", &FilterGraphInfo::reinits)
+        .field("converted", &FilterGraphInfo::converted)
+    ;
+
     class_<Filterer>("Filterer")
         .constructor<std::map<std::string, std::string>, std::map<std::string, std::string>, std::map<std::string, std::string>, std::string>()
         .function("filter", &Filterer::filter, allow_raw_pointers())
         .function("flush", &Filterer::flush, allow_raw_pointers())
+        .function("filterInto", &Filterer::filterInto, allow_raw_pointers())
+        .function("flushInto", &Filterer::flushInto, allow_raw_pointers())
+        .function("getStats", &Filterer::getStats)
+        .function("getMemory", &Filterer::getMemory)
+        .function("getGraphInfo", &Filterer::getGraphInfo)
     ;
     
     class_<BitstreamFilterer>("BitstreamFilterer")
@@ -143,6 +191,12 @@ EMSCRIPTEN_BINDINGS(encode) {
         .property("dataFormat", &Encoder::dataFormat)
         .function("encode", &Encoder::encode, allow_raw_pointers())
         .function("flush", &Encoder::flush, allow_raw_pointers())
+        .function("encodeInto", &Encoder::encodeInto, allow_raw_pointers())
+        .function("flushInto", &Encoder::flushInto, allow_raw_pointers())
+        .function("getStats", &Encoder::getStats)
+        .function("getMemory", &Encoder::getMemory)
+        .function("setSpeedTarget", &Encoder::setSpeedTarget)
+        .function("getSpeedHistory", &Encoder::getSpeedHistory)
     ;
 }
 
@@ -150,6 +204,7 @@ EMSCRIPTEN_BINDINGS(muxer) {
     class_<Muxer>("Muxer")
         .constructor<std::string, emscripten::val>()
         .class_function("inferFormatInfo", &Muxer::inferFormatInfo)
+        .class_function("toFile", &Muxer::toFile, allow_raw_pointers())
         .function("dump", &Muxer::dump)
         .function("newStreamWithDemuxer", select_overload<void(Demuxer*, int)>(&Muxer::newStream), allow_raw_pointers())
         .function("newStreamWithEncoder", select_overload<void(Encoder*)>(&Muxer::newStream), allow_raw_pointers())
@@ -157,6 +212,9 @@ EMSCRIPTEN_BINDINGS(muxer) {
         .function("writeHeader", &Muxer::writeHeader)
         .function("writeTrailer", &Muxer::writeTrailer)
         .function("writeFrame", &Muxer::writeFrame, allow_raw_pointers())
+        .function("writeRing", &Muxer::writeRing, allow_raw_pointers())
+        .function("getStats", &Muxer::getStats)
+        .function("getMemory", &Muxer::getMemory)
     ;
 
     value_object<InferredFormatInfo>("InferredFormatInfo")
@@ -171,6 +229,292 @@ EMSCRIPTEN_BINDINGS(muxer) {
     ;
 }
 
+EMSCRIPTEN_BINDINGS(remuxer) {
+    value_object<RemuxStatus>("RemuxStatus")
+        .field("packets", &RemuxStatus::packets)
+        .field("bytes", &RemuxStatus::bytes)
+        .field("end", &RemuxStatus::end)
+        .field("throttled", &RemuxStatus::throttled)
+    ;
+
+    class_<Remuxer>("Remuxer")
+        .constructor<Demuxer*>(allow_raw_pointers())
+        .function("addStream", &Remuxer::addStream, allow_raw_pointers())
+        .function("setTimeOffset", &Remuxer::setTimeOffset)
+        .function("process", &Remuxer::process)
+    ;
+
+    class_<SmartCutter>("SmartCutter")
+        .constructor<Demuxer*, double, double>(allow_raw_pointers())
+        .function("addStream", &SmartCutter::addStream, allow_raw_pointers())
+        .function("process", &SmartCutter::process)
+    ;
+
+    class_<Concatenator>("Concatenator")
+        .constructor<>()
+        .function("addSegment", &Concatenator::addSegment, allow_raw_pointers())
+        .function("addStream", &Concatenator::addStream, allow_raw_pointers())
+        .function("process", &Concatenator::process)
+    ;
+}
+
+EMSCRIPTEN_BINDINGS(pipeline) {
+    value_object<PipelineStatus>("PipelineStatus")
+        .field("steps", &PipelineStatus::steps)
+        .field("end", &PipelineStatus::end)
+        .field("throttled", &PipelineStatus::throttled)
+    ;
+
+    class_<Pipeline>("Pipeline")
+        .constructor<>()
+        .function("addDecoder", &Pipeline::addDecoder, allow_raw_pointers())
+        .function("setFilter", &Pipeline::setFilter)
+        .function("addEncoder", &Pipeline::addEncoder, allow_raw_pointers())
+        .function("addExternalEncoder", 
+            select_overload<void(std::string, Muxer*, StreamInfo, std::string, emscripten::val)>(&Pipeline::addExternalEncoder), allow_raw_pointers())
+        .function("setThreaded", &Pipeline::setThreaded)
+        .function("step", &Pipeline::step)
+    ;
+}
+
+EMSCRIPTEN_BINDINGS(fanout) {
+    value_object<FanOutStatus>("FanOutStatus")
+        .field("packets", &FanOutStatus::packets)
+        .field("end", &FanOutStatus::end)
+        .field("throttled", &FanOutStatus::throttled)
+        .field("blocked", &FanOutStatus::blocked)
+    ;
+
+    class_<FanOut>("FanOut")
+        .constructor<Demuxer*, int>()
+        .function("addBranch", &FanOut::addBranch, allow_raw_pointers())
+        .function("setPaused", &FanOut::setPaused)
+        .function("setMaxQueue", &FanOut::setMaxQueue)
+        .function("queueSize", &FanOut::queueSize)
+        .function("step", &FanOut::step)
+    ;
+}
+
+EMSCRIPTEN_BINDINGS(peaks) {
+    class_<AudioPeaks>("AudioPeaks")
+        .constructor<int, int>()
+        .constructor<Demuxer*, int, int, int>(allow_raw_pointers())
+        .function("addFrame", &AudioPeaks::addFrame, allow_raw_pointers())
+        .function("flush", &AudioPeaks::flush)
+        .function("process", &AudioPeaks::process)
+        .function("nbLevels", &AudioPeaks::nbLevels)
+        .function("nbBuckets", &AudioPeaks::nbBuckets)
+        .function("samplesPerBucket", &AudioPeaks::samplesPerBucket)
+        .function("peaks", &AudioPeaks::peaks)
+    ;
+}
+
+EMSCRIPTEN_BINDINGS(scene) {
+    value_object<SceneOptions>("SceneOptions")
+        .field("threshold", &SceneOptions::threshold)
+        .field("minDuration", &SceneOptions::min_duration)
+        .field("keyframesOnly", &SceneOptions::keyframes_only)
+        .field("lowres", &SceneOptions::lowres)
+    ;
+
+    value_object<SceneCut>("SceneCut")
+        .field("time", &SceneCut::time)
+        .field("score", &SceneCut::score)
+    ;
+    register_vector<SceneCut>("vector<SceneCut>");
+
+    class_<SceneDetector>("SceneDetector")
+        .constructor<Demuxer*, int, SceneOptions>(allow_raw_pointers())
+        .function("process", &SceneDetector::process)
+        .function("getCuts", &SceneDetector::getCuts)
+    ;
+}
+
+
+EMSCRIPTEN_BINDINGS(quality) {
+    value_object<QualityOptions>("QualityOptions")
+        .field("everyNth", &QualityOptions::every_nth)
+        .field("ssim", &QualityOptions::ssim)
+    ;
+
+    value_object<FrameQuality>("FrameQuality")
+        .field("time", &FrameQuality::time)
+        .field("psnrY", &FrameQuality::psnr_y)
+        .field("psnrU", &FrameQuality::psnr_u)
+        .field("psnrV", &FrameQuality::psnr_v)
+        .field("psnr", &FrameQuality::psnr)
+        .field("ssimY", &FrameQuality::ssim_y)
+        .field("ssim", &FrameQuality::ssim)
+    ;
+    register_vector<FrameQuality>("vector<FrameQuality>");
+
+    value_object<QualitySummary>("QualitySummary")
+        .field("frames", &QualitySummary::frames)
+        .field("psnr", &QualitySummary::psnr)
+        .field("psnrY", &QualitySummary::psnr_y)
+        .field("ssim", &QualitySummary::ssim)
+        .field("ssimY", &QualitySummary::ssim_y)
+        .field("minPsnr", &QualitySummary::min_psnr)
+        .field("minSsim", &QualitySummary::min_ssim)
+    ;
+
+    class_<QualityMeter>("QualityMeter")
+        .constructor<Demuxer*, int, Demuxer*, int, QualityOptions>(allow_raw_pointers())
+        .function("process", &QualityMeter::process)
+        .function("getFrames", &QualityMeter::getFrames)
+        .function("getSummary", &QualityMeter::getSummary)
+    ;
+}
+
+
+EMSCRIPTEN_BINDINGS(frame_cache) {
+    value_object<FrameCacheOptions>("FrameCacheOptions")
+        .field("budget", &FrameCacheOptions::budget)
+        .field("maxWidth", &FrameCacheOptions::max_width)
+        .field("maxHeight", &FrameCacheOptions::max_height)
+        .field("prefetch", &FrameCacheOptions::prefetch)
+    ;
+
+    value_object<FrameCacheInfo>("FrameCacheInfo")
+        .field("frames", &FrameCacheInfo::frames)
+        .field("bytes", &FrameCacheInfo::bytes)
+        .field("hits", &FrameCacheInfo::hits)
+        .field("misses", &FrameCacheInfo::misses)
+    ;
+
+    class_<FrameCache>("FrameCache")
+        .constructor<Demuxer*, FrameCacheOptions>(allow_raw_pointers())
+        .function("get", &FrameCache::get, allow_raw_pointers())
+        .function("has", &FrameCache::has)
+        .function("prefetch", &FrameCache::prefetch)
+        .function("clear", &FrameCache::clear)
+        .function("getInfo", &FrameCache::getInfo)
+    ;
+}
+
+EMSCRIPTEN_BINDINGS(stats) {
+    value_object<Stats>("Stats")
+        .field("packets", &Stats::packets)
+        .field("frames", &Stats::frames)
+        .field("bytes", &Stats::bytes)
+        .field("calls", &Stats::calls)
+        .field("processTime", &Stats::process_time)
+        .field("ioTime", &Stats::io_time)
+        .field("allocs", &Stats::allocs)
+        .field("latency", &Stats::latency)
+        .field("maxLatency", &Stats::max_latency)
+    ;
+
+    emscripten::function("enableStats", &enableStats);
+}
+
+EMSCRIPTEN_BINDINGS(live) {
+    value_object<LiveProfile>("LiveProfile")
+        .field("enabled", &LiveProfile::enabled)
+        .field("probesize", &LiveProfile::probesize)
+        .field("analyzeDuration", &LiveProfile::analyze_duration)
+        .field("interleaveDelta", &LiveProfile::interleave_delta)
+    ;
+
+    emscripten::function("setLiveProfile", &setLiveProfile);
+    emscripten::function("getLiveProfile", &getLiveProfile);
+}
+
+EMSCRIPTEN_BINDINGS(speed) {
+    value_object<SpeedTarget>("SpeedTarget")
+        .field("speed", &SpeedTarget::speed)
+        .field("headroom", &SpeedTarget::headroom)
+        .field("window", &SpeedTarget::window)
+        .field("level", &SpeedTarget::level)
+    ;
+
+    value_object<SpeedChange>("SpeedChange")
+        .field("time", &SpeedChange::time)
+        .field("level", &SpeedChange::level)
+        .field("setting", &SpeedChange::setting)
+        .field("speed", &SpeedChange::speed)
+    ;
+    register_vector<SpeedChange>("vector<SpeedChange>");
+
+    emscripten::function("setDefaultSpeedTarget", &setDefaultSpeedTarget);
+    emscripten::function("getDefaultSpeedTarget", &getDefaultSpeedTarget);
+}
+
+template<typename T>
+void bindResultRing(const char* name) {
+    class_<ResultRing<T>>(name)
+        .template constructor<int>()
+        .property("size", &ResultRing<T>::size)
+        .function("take", &ResultRing<T>::take, allow_raw_pointers())
+        .function("clear", &ResultRing<T>::clear)
+        .function("setSink", &ResultRing<T>::setSink)
+        .function("flushSink", &ResultRing<T>::flushSink)
+        .function("handles", &ResultRing<T>::handlesView)
+        .function("pts", &ResultRing<T>::ptsView)
+        .function("dts", &ResultRing<T>::dtsView)
+        .function("durations", &ResultRing<T>::durationsView)
+        .function("sizes", &ResultRing<T>::sizesView)
+        .function("keys", &ResultRing<T>::keysView)
+        .function("data", &ResultRing<T>::dataView)
+    ;
+}
+
+EMSCRIPTEN_BINDINGS(result_ring) {
+    bindResultRing<Frame>("FrameRing");
+    bindResultRing<Packet>("PacketRing");
+}
+
+EMSCRIPTEN_BINDINGS(memory) {
+    value_object<MemoryInfo>("MemoryInfo")
+        .field("current", &MemoryInfo::current)
+        .field("highWater", &MemoryInfo::high_water)
+        .field("allocs", &MemoryInfo::allocs)
+        .field("heapSize", &MemoryInfo::heap_size)
+    ;
+
+    value_object<MemoryBudget>("MemoryBudget")
+        .field("heap", &MemoryBudget::heap)
+        .field("ioBuffer", &MemoryBudget::io_buffer)
+        .field("interleaveDelta", &MemoryBudget::interleave_delta)
+    ;
+
+    emscripten::function("getMemoryInfo", &getMemoryInfo);
+    emscripten::function("setMemoryBudget", &setMemoryBudget);
+    emscripten::function("getMemoryBudget", &getMemoryBudget);
+
+    value_object<BufferPoolInfo>("BufferPoolInfo")
+        .field("buffers", &BufferPoolInfo::buffers)
+        .field("bytes", &BufferPoolInfo::bytes)
+    ;
+
+    emscripten::function("getBufferPoolInfo", &getBufferPoolInfo);
+    emscripten::function("trimBufferPools", &trimBufferPools);
+}
+
+EMSCRIPTEN_BINDINGS(features) {
+    emscripten::function("buildProfile", &buildProfile);
+    emscripten::function("hasDecoder", &hasDecoder);
+    emscripten::function("hasEncoder", &hasEncoder);
+    emscripten::function("hasDemuxer", &hasDemuxer);
+    emscripten::function("hasMuxer", &hasMuxer);
+    emscripten::function("hasFilter", &hasFilter);
+}
+
+EMSCRIPTEN_BINDINGS(log) {
+    value_object<LogEntry>("LogEntry")
+        .field("level", &LogEntry::level)
+        .field("category", &LogEntry::category)
+        .field("message", &LogEntry::message)
+        .field("repeats", &LogEntry::repeats)
+    ;
+
+    register_vector<LogEntry>("vector<LogEntry>");
+    emscripten::function("setConsoleLogger", &setConsoleLogger);
+    emscripten::function("setLogLevel", &setLogLevel);
+    emscripten::function("setLogRateLimit", &setLogRateLimit);
+    emscripten::function("drainLogs", &drainLogs);
+}
+
 EMSCRIPTEN_BINDINGS(utils) {
     emscripten::function("createFrameVector", &createVector<Frame*>);
     emscripten::function("createStringStringMap", &createMap<std::string, std::string>);
@@ -181,8 +525,6 @@ EMSCRIPTEN_BINDINGS(utils) {
 	register_vector<StreamInfo>("vector<StreamInfo>");
     register_vector<std::string>("vector<string>"); // map.keys()
     register_map<std::string, std::string>("MapStringString");
-
-    emscripten::function("setConsoleLogger", &setConsoleLogger);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "bitstream.h"
+#include <cstring>
+
+
+/**
+ * Parameter sets (SPS/PPS/VPS) of avcC/hvcC extradata, as length prefixed NAL units.
+ * return NAL length size, 0 if extradata is not avcC/hvcC (e.g. annexb).
+ */
+static int lengthPrefixedParameterSets(AVCodecParameters* par, vector<uint8_t>& out) {
+    auto data = par->extradata;
+    auto size = par->extradata_size;
+    if (data == NULL || size < 7 || data[0] != 1) return 0;
+    vector<pair<const uint8_t*, int>> nals;
+    int pos = 0;
+    auto readNal = [&]() {
+        if (pos + 2 > size) return false;
+        auto n = (data[pos] << 8) | data[pos + 1];
+        pos += 2;
+        if (pos + n > size) return false;
+        nals.push_back({data + pos, n});
+        pos += n;
+        return true;
+    };
+    int length_size = 0;
+    if (par->codec_id == AV_CODEC_ID_H264) {
+        length_size = (data[4] & 3) + 1;
+        auto nb_sps = data[5] & 0x1f;
+        pos = 6;
+        for (int i = 0; i < nb_sps; i++)
+            if (!readNal()) return 0;
+        if (pos >= size) return 0;
+        auto nb_pps = data[pos++];
+        for (int i = 0; i < nb_pps; i++)
+            if (!readNal()) return 0;
+    }
+    else if (par->codec_id == AV_CODEC_ID_HEVC && size >= 23) {
+        length_size = (data[21] & 3) + 1;
+        auto nb_arrays = data[22];
+        pos = 23;
+        for (int i = 0; i < nb_arrays; i++) {
+            if (pos + 3 > size) return 0;
+            auto nb_nals = (data[pos + 1] << 8) | data[pos + 2];
+            pos += 3;
+            for (int j = 0; j < nb_nals; j++)
+                if (!readNal()) return 0;
+        }
+    }
+    else return 0;
+
+    for (const auto& [nal, n] : nals) {
+        for (int i = length_size - 1; i >= 0; i--)
+            out.push_back((n >> (8 * i)) & 0xff);
+        out.insert(out.end(), nal, nal + n);
+    }
+    return length_size;
+}
+
+
+/* annexb (start codes) NAL units -> length prefixed */
+static vector<uint8_t> annexbToLengthPrefixed(const uint8_t* data, int size, int length_size) {
+    auto end = data + size;
+    auto findStartCode = [&](const uint8_t* p) {
+        for (; p + 3 <= end; p++)
+            if (p[0] == 0 && p[1] == 0 && p[2] == 1) return p;
+        return end;
+    };
+    vector<uint8_t> out;
+    out.reserve(size + 16);
+    auto p = findStartCode(data);
+    while (p < end) {
+        auto nal = p + 3;
+        auto next = findStartCode(nal);
+        // zero bytes before next start code (4 bytes start code, trailing zeros)
+        auto nal_end = next;
+        while (nal_end > nal && nal_end[-1] == 0) nal_end--;
+        auto n = (int)(nal_end - nal);
+        for (int i = length_size - 1; i >= 0; i--)
+            out.push_back((n >> (8 * i)) & 0xff);
+        out.insert(out.end(), nal, nal_end);
+        p = next;
+    }
+    return out;
+}
+
+
+static void replacePacketData(AVPacket* pkt, const vector<uint8_t>& data) {
+    auto out = av_packet_alloc();
+    auto ret = av_new_packet(out, data.size());
+    CHECK(ret >= 0, "ExtradataKeeper: could not allocate packet");
+    memcpy(out->data, data.data(), data.size());
+    av_packet_copy_props(out, pkt);
+    av_packet_unref(pkt);
+    av_packet_move_ref(pkt, out);
+    av_packet_free(&out);
+}
+
+
+ExtradataKeeper::ExtradataKeeper(AVCodecParameters* par) {
+    nal_length_size = lengthPrefixedParameterSets(par, parameter_sets);
+}
+
+
+void ExtradataKeeper::reencoded(AVPacket* pkt) {
+    if (nal_length_size == 0) return;
+    replacePacketData(pkt, annexbToLengthPrefixed(pkt->data, pkt->size, nal_length_size));
+    restore = true;
+}
+
+
+void ExtradataKeeper::copied(AVPacket* pkt) {
+    if (!restore || !(pkt->flags & AV_PKT_FLAG_KEY)) return;
+    auto data = parameter_sets;
+    data.insert(data.end(), pkt->data, pkt->data + pkt->size);
+    replacePacketData(pkt, data);
+    restore = false;
+}
@@ -0,0 +1,33 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <cstdint>
+#include <vector>
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * Mixing re-encoded packets into a stream-copied H.264/HEVC stream stored as avcC/hvcC
+ * (extradata of the output is the source one, packets are length prefixed NAL units).
+ * Re-encoded (annexb) packets are converted to length prefixed, they carry their own parameter
+ * sets in-band, so the source parameter sets are put back at the next copied key frame.
+ * Other codecs/annexb streams are left unchanged.
+ */
+class ExtradataKeeper {
+    int nal_length_size = 0;
+    vector<uint8_t> parameter_sets; // length prefixed
+    bool restore = false;
+public:
+    ExtradataKeeper() {}
+    ExtradataKeeper(AVCodecParameters* par);
+    void reencoded(AVPacket* pkt);
+    void copied(AVPacket* pkt);
+};
+
+
+#endif
@@ -0,0 +1,215 @@
+#include <atomic>
+#include <climits>
+#include <cstring>
+extern "C" {
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
+    #include <libavutil/channel_layout.h>
+}
+#include "buffer_pool.h"
+#include "memory.h"
+#include "utils.h"
+
+
+static const int min_class_bits = 10; // 1 KB
+static const int max_class_bits = 28; // 256 MB
+static const int num_classes = (max_class_bits - min_class_bits) * 4 + 1;
+
+static std::atomic<AVBufferPool*> pools[num_classes];
+static std::atomic<int64_t> pool_buffers {0};
+static std::atomic<int64_t> pool_bytes {0};
+
+
+/* index of the smallest class >= size, -1 if too large */
+static int class_index(size_t size, size_t& class_size) {
+    if (size <= ((size_t)1 << min_class_bits)) {
+        class_size = (size_t)1 << min_class_bits;
+        return 0;
+    }
+    int bits = 0; // 2^bits < size <= 2^(bits+1)
+    while (((size_t)2 << bits) < size) bits++;
+    if (bits >= max_class_bits) return -1;
+    auto base = (size_t)1 << bits;
+    auto step = base / 4;
+    auto n = (size - base + step - 1) / step; // 1..4
+    class_size = base + n * step;
+    return (bits - min_class_bits) * 4 + (int)n;
+}
+
+
+static void pool_buffer_free(void* opaque, uint8_t* data) {
+    pool_buffers--;
+    pool_bytes -= (int64_t)(intptr_t)opaque;
+    av_free(data);
+}
+
+/* pooled buffers outlive the object that happened to grow the pool: counted in total only, not in its account */
+static AVBufferRef* pool_alloc(void* opaque, size_t size) {
+    MemoryScope scope(NULL);
+    auto data = (uint8_t*)av_malloc(size);
+    if (data == NULL) return NULL;
+    auto buf = av_buffer_create(data, size, pool_buffer_free, (void*)(intptr_t)size, 0);
+    if (buf == NULL) {
+        av_free(data);
+        return NULL;
+    }
+    pool_buffers++;
+    pool_bytes += size;
+    return buf;
+}
+
+
+AVBufferRef* poolBuffer(size_t size) {
+    size_t class_size;
+    auto i = class_index(size, class_size);
+    if (i < 0) return av_buffer_alloc(size);
+    auto pool = pools[i].load();
+    if (pool == NULL) {
+        MemoryScope scope(NULL);
+        auto new_pool = av_buffer_pool_init2(class_size, NULL, pool_alloc, NULL);
+        if (new_pool == NULL) return NULL;
+        if (pools[i].compare_exchange_strong(pool, new_pool))
+            pool = new_pool;
+        else
+            av_buffer_pool_uninit(&new_pool);
+    }
+    return av_buffer_pool_get(pool);
+}
+
+
+static int pool_video_buffer(AVFrame* frame, int width, int height, int align) {
+    auto format = (AVPixelFormat)frame->format;
+    if (align <= 0) align = 32;
+    // linesizes aligned (same as av_frame_get_buffer)
+    int linesize[4] = {0};
+    for (int i = 1; i <= align; i += i) {
+        auto ret = av_image_fill_linesizes(linesize, format, FFALIGN(width, i));
+        if (ret < 0) return ret;
+        if (FFALIGN(linesize[0], align) == linesize[0]) break;
+    }
+    ptrdiff_t linesizes[4] = {0};
+    for (int i = 0; i < 4 && linesize[i]; i++)
+        linesizes[i] = linesize[i] = FFALIGN(linesize[i], align);
+    size_t sizes[4] = {0};
+    auto ret = av_image_fill_plane_sizes(sizes, format, FFALIGN(height, 32), linesizes);
+    if (ret < 0) return ret;
+
+    for (int i = 0; i < 4 && sizes[i] > 0; i++) {
+        // extra bytes for alignment and simd overread
+        frame->buf[i] = poolBuffer(sizes[i] + 16 + align - 1);
+        if (frame->buf[i] == NULL) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = (uint8_t*)FFALIGN((uintptr_t)frame->buf[i]->data, (uintptr_t)align);
+        frame->linesize[i] = linesize[i];
+    }
+    frame->extended_data = frame->data;
+
+    return 0;
+}
+
+static int pool_audio_buffer(AVFrame* frame, int align) {
+    auto format = (AVSampleFormat)frame->format;
+    if (!frame->channels)
+        frame->channels = av_get_channel_layout_nb_channels(frame->channel_layout);
+    auto planes = av_sample_fmt_is_planar(format) ? frame->channels : 1;
+    // extended_data of many channels, left to FFmpeg
+    if (planes > AV_NUM_DATA_POINTERS || planes <= 0)
+        return av_frame_get_buffer(frame, align);
+    auto ret = av_samples_get_buffer_size(&frame->linesize[0], frame->channels, frame->nb_samples, format, align);
+    if (ret < 0) return ret;
+
+    for (int i = 0; i < planes; i++) {
+        frame->buf[i] = poolBuffer(frame->linesize[0]);
+        if (frame->buf[i] == NULL) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = frame->buf[i]->data;
+    }
+    frame->extended_data = frame->data;
+
+    return 0;
+}
+
+int poolFrameBuffer(AVFrame* frame, int align) {
+    if (frame->format < 0) return AVERROR(EINVAL);
+    if (frame->width > 0 && frame->height > 0)
+        return pool_video_buffer(frame, frame->width, frame->height, align);
+    if (frame->nb_samples > 0 && (frame->channel_layout || frame->channels > 0))
+        return pool_audio_buffer(frame, align);
+
+    return AVERROR(EINVAL);
+}
+
+
+int poolPacketBuffer(AVPacket* pkt, int size) {
+    if (size < 0 || size >= INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) return AVERROR(EINVAL);
+    av_packet_unref(pkt);
+    pkt->buf = poolBuffer(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (pkt->buf == NULL) return AVERROR(ENOMEM);
+    memset(pkt->buf->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    pkt->data = pkt->buf->data;
+    pkt->size = size;
+
+    return 0;
+}
+
+
+/* refer: avcodec_default_get_buffer2 (libavcodec/decode.c) */
+static int pool_get_buffer2(AVCodecContext* ctx, AVFrame* frame, int flags) {
+    if (!(ctx->codec->capabilities & AV_CODEC_CAP_DR1))
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    if (ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        auto desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+        if (desc == NULL || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        // coded size required by codec
+        int width = frame->width, height = frame->height;
+        int linesize_align[AV_NUM_DATA_POINTERS];
+        avcodec_align_dimensions2(ctx, &width, &height, linesize_align);
+        int align = 32;
+        for (int i = 0; i < AV_NUM_DATA_POINTERS; i++)
+            align = FFMAX(align, linesize_align[i]);
+        return pool_video_buffer(frame, width, height, align);
+    }
+    if (ctx->codec_type == AVMEDIA_TYPE_AUDIO)
+        return pool_audio_buffer(frame, 0);
+
+    return avcodec_default_get_buffer2(ctx, frame, flags);
+}
+
+/* refer: avcodec_default_get_encode_buffer (libavcodec/encode.c) */
+static int pool_get_encode_buffer(AVCodecContext* ctx, AVPacket* pkt, int flags) {
+    if (pkt->size < 0 || pkt->size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(EINVAL);
+    if (pkt->data || pkt->buf)
+        return AVERROR(EINVAL);
+    pkt->buf = poolBuffer(pkt->size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (pkt->buf == NULL) return AVERROR(ENOMEM);
+    memset(pkt->buf->data + pkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    pkt->data = pkt->buf->data;
+
+    return 0;
+}
+
+void usePoolForCodec(AVCodecContext* codec_ctx) {
+    if (av_codec_is_decoder(codec_ctx->codec))
+        codec_ctx->get_buffer2 = pool_get_buffer2;
+    else
+        codec_ctx->get_encode_buffer = pool_get_encode_buffer;
+}
+
+
+void trimBufferPools() {
+    for (int i = 0; i < num_classes; i++) {
+        auto pool = pools[i].exchange(NULL);
+        if (pool != NULL)
+            av_buffer_pool_uninit(&pool);
+    }
+}
+
+BufferPoolInfo getBufferPoolInfo() {
+    return {.buffers = (double)pool_buffers.load(), .bytes = (double)pool_bytes.load()};
+}
@@ -0,0 +1,40 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/buffer.h>
+    #include <libavutil/frame.h>
+}
+
+
+/**
+ * Size-class pools of av_buffers, shared by all Decoders/Encoders/Frames/Packets,
+ * so that large media buffers are reused in a few fixed sizes instead of fragmenting the heap.
+ * Classes are quarter steps between powers of two (at most 25% unused), from 1 KB to 256 MB.
+ */
+struct BufferPoolInfo {
+    double buffers;     // buffers allocated by pools (in use or free)
+    double bytes;
+};
+
+/* buffer of at least `size` bytes */
+AVBufferRef* poolBuffer(size_t size);
+
+/* same as av_frame_get_buffer (format, width/height or nb_samples/channel_layout should be set) */
+int poolFrameBuffer(AVFrame* frame, int align);
+
+/* same as av_new_packet */
+int poolPacketBuffer(AVPacket* pkt, int size);
+
+/* set get_buffer2 (decoder) / get_encode_buffer (encoder), before avcodec_open2 */
+void usePoolForCodec(AVCodecContext* codec_ctx);
+
+/* release free buffers (buffers in use are released when returned) */
+void trimBufferPools();
+
+BufferPoolInfo getBufferPoolInfo();
+
+
+#endif
@@ -0,0 +1,234 @@
+#include "concat.h"
+#include <cstring>
+
+
+/* packets of b can be muxed into a stream created from a */
+static bool codecParametersCompatible(const AVCodecParameters* a, const AVCodecParameters* b) {
+    if (a->codec_type != b->codec_type || a->codec_id != b->codec_id) return false;
+    if (a->extradata_size != b->extradata_size) return false;
+    if (a->extradata_size > 0 && memcmp(a->extradata, b->extradata, a->extradata_size) != 0) return false;
+    if (a->codec_type == AVMEDIA_TYPE_VIDEO)
+        return a->width == b->width && a->height == b->height && a->format == b->format;
+    if (a->codec_type == AVMEDIA_TYPE_AUDIO)
+        return a->sample_rate == b->sample_rate && a->channels == b->channels && a->format == b->format;
+    return true;
+}
+
+
+/* convert decoded frames (id "in") to size/format of output stream (id "out") */
+static Filterer* conversionFilterer(AVCodecParameters* in, DataFormat in_format, AVCodecParameters* out) {
+    char in_args[512];
+    char spec[512];
+    string media_type;
+    if (in->codec_type == AVMEDIA_TYPE_VIDEO) {
+        media_type = "video";
+        auto in_sar = in->sample_aspect_ratio.num > 0 ? in->sample_aspect_ratio : AVRational{1, 1};
+        auto out_sar = out->sample_aspect_ratio.num > 0 ? out->sample_aspect_ratio : AVRational{1, 1};
+        snprintf(in_args, sizeof(in_args), "video_size=%dx%d:pix_fmt=%s:time_base=1/%d:pixel_aspect=%d/%d",
+            in->width, in->height, in_format.format.c_str(), AV_TIME_BASE, in_sar.num, in_sar.den);
+        snprintf(spec, sizeof(spec), "[in]scale=%d:%d,format=%s,setsar=%d/%d[out]",
+            out->width, out->height, av_get_pix_fmt_name((AVPixelFormat)out->format), out_sar.num, out_sar.den);
+    }
+    else {
+        media_type = "audio";
+        snprintf(in_args, sizeof(in_args), "sample_rate=%d:sample_fmt=%s:channel_layout=%s:time_base=1/%d",
+            in_format.sampleRate, in_format.format.c_str(), in_format.channelLayout.c_str(), AV_TIME_BASE);
+        snprintf(spec, sizeof(spec), "[in]aresample=%d,aformat=sample_fmts=%s:channel_layouts=%s[out]",
+            out->sample_rate, av_get_sample_fmt_name((AVSampleFormat)out->format),
+            get_channel_layout_name(out->channels, out->channel_layout).c_str());
+    }
+    return new Filterer({{"in", in_args}}, {{"out", ""}}, {{"in", media_type}, {"out", media_type}}, spec);
+}
+
+
+Concatenator::~Concatenator() {
+    for (auto& segment : segments)
+        for (auto& [_, route] : segment.routes) {
+            if (route.transcode == NULL) continue;
+            delete route.transcode->decoder;
+            delete route.transcode->filterer;
+            delete route.transcode->encoder;
+            delete route.transcode;
+        }
+    for (auto& [_, output] : outputs)
+        delete output;
+}
+
+
+int Concatenator::addSegment(Demuxer* demuxer) {
+    auto start = demuxer->av_format_context()->start_time;
+    segments.push_back({
+        .demuxer = demuxer,
+        .routes = {},
+        .start = start != AV_NOPTS_VALUE ? start : 0,
+        .end = AV_NOPTS_VALUE,
+    });
+    return segments.size() - 1;
+}
+
+
+bool Concatenator::addStream(int segment, int in_stream_index, Muxer* muxer, int out_stream_index) {
+    CHECK(segment >= 0 && segment < segments.size(), "Concatenator: segment out of range");
+    auto& seg = segments[segment];
+    auto stream = seg.demuxer->av_stream(in_stream_index);
+    auto key = make_pair(muxer, out_stream_index);
+    if (outputs.count(key) == 0) {
+        outputs[key] = new Output {
+            .muxer = muxer,
+            .stream_index = out_stream_index,
+            .source = stream,
+            .last_dts = AV_NOPTS_VALUE,
+            .delay = -1,
+            .extradata = ExtradataKeeper(stream->codecpar),
+        };
+    }
+    auto output = outputs[key];
+    auto reencode = !codecParametersCompatible(output->source->codecpar, stream->codecpar);
+    seg.routes[in_stream_index] = {.output = output, .reencode = reencode, .transcode = NULL};
+    return !reencode;
+}
+
+
+/* shift to position of current segment, and keep dts increasing across segments */
+void Concatenator::writePacket(Output* output, Packet* pkt, bool reencoded) {
+    auto av_pkt = pkt->av_packet();
+    if (reencoded) {
+        output->extradata.reencoded(av_pkt);
+        // re-encoded packets have no reordering (dts == pts), shift dts as copied ones
+        if (av_pkt->pts != AV_NOPTS_VALUE)
+            av_pkt->dts = av_pkt->pts - FFMAX(output->delay, 0);
+    }
+    else {
+        output->extradata.copied(av_pkt);
+        auto key = (av_pkt->flags & AV_PKT_FLAG_KEY) != 0;
+        if (key && output->delay < 0 && av_pkt->pts != AV_NOPTS_VALUE && av_pkt->dts != AV_NOPTS_VALUE)
+            output->delay = FFMAX(av_pkt->pts - av_pkt->dts, 0);
+    }
+    auto shift = offset - segments[current].start;
+    if (av_pkt->pts != AV_NOPTS_VALUE) av_pkt->pts += shift;
+    if (av_pkt->dts != AV_NOPTS_VALUE) {
+        av_pkt->dts += shift;
+        // compare in output time base (muxer rescales), and step by one tick of it
+        auto tb = output->muxer->av_stream(output->stream_index)->time_base;
+        if (output->last_dts != AV_NOPTS_VALUE && 
+            av_rescale_q(av_pkt->dts, AV_TIME_BASE_Q, tb) <= av_rescale_q(output->last_dts, AV_TIME_BASE_Q, tb))
+            av_pkt->dts = output->last_dts + av_rescale_q_rnd(1, tb, AV_TIME_BASE_Q, AV_ROUND_UP);
+        if (av_pkt->pts != AV_NOPTS_VALUE && av_pkt->dts > av_pkt->pts)
+            av_pkt->pts = av_pkt->dts;
+        output->last_dts = av_pkt->dts;
+    }
+    output->muxer->writeFrame(pkt, output->stream_index);
+}
+
+
+/* decoded frames (or flush) -> scale/resample -> encode -> write, frames are deleted */
+void Concatenator::encodeFrames(Route& route, vector<Frame*> frames, bool flush) {
+    auto transcode = route.transcode;
+    auto writeAll = [&](vector<Packet*> pkts) {
+        for (auto pkt : pkts) {
+            writePacket(route.output, pkt, true);
+            delete pkt;
+        }
+    };
+    if (frames.empty() && !flush) return;
+    auto converted = flush ? transcode->filterer->flush() : transcode->filterer->filter(frames);
+    for (auto frame : frames)
+        delete frame;
+    for (auto frame : converted) {
+        writeAll(transcode->encoder->encode(frame));
+        delete frame;
+    }
+}
+
+
+void Concatenator::beginSegment(size_t index) {
+    auto& seg = segments[index];
+    // same source again (loop), read from start
+    for (size_t i = 0; i < index; i++)
+        if (segments[i].demuxer == seg.demuxer) {
+            seg.demuxer->seek(seg.start, -1);
+            break;
+        }
+    for (auto& [in_stream_index, route] : seg.routes) {
+        if (!route.reencode) continue;
+        auto decoder = new Decoder(seg.demuxer, in_stream_index, "in");
+        auto in_par = seg.demuxer->av_stream(in_stream_index)->codecpar;
+        route.transcode = new Transcode {
+            .decoder = decoder,
+            .filterer = conversionFilterer(in_par, decoder->dataFormat(), route.output->source->codecpar),
+            .encoder = new Encoder(route.output->source),
+        };
+    }
+}
+
+
+void Concatenator::endSegment(Segment& seg) {
+    for (auto& [_, route] : seg.routes) {
+        auto transcode = route.transcode;
+        if (transcode == NULL) continue;
+        encodeFrames(route, transcode->decoder->flush());
+        encodeFrames(route, {}, true);
+        for (auto pkt : transcode->encoder->flush()) {
+            writePacket(route.output, pkt, true);
+            delete pkt;
+        }
+        delete transcode->decoder;
+        delete transcode->filterer;
+        delete transcode->encoder;
+        delete transcode;
+        route.transcode = NULL;
+    }
+    if (seg.end != AV_NOPTS_VALUE && seg.end > seg.start)
+        offset += seg.end - seg.start;
+}
+
+
+RemuxStatus Concatenator::process(int max_packets, int max_bytes) {
+    RemuxStatus status = {.packets = 0, .bytes = 0, .end = finished, .throttled = false};
+
+    while (!finished && status.packets < max_packets && status.bytes < max_bytes) {
+        // backpressure: at least one packet each call, so that caller can drain outputs
+        if (status.packets > 0 && overMemoryBudget()) {
+            for (auto& [_, output] : outputs)
+                output->muxer->flushInterleave();
+            if (overMemoryBudget()) {
+                status.throttled = true;
+                break;
+            }
+        }
+        if (current >= segments.size()) {
+            finished = true;
+            break;
+        }
+        if (!started) {
+            beginSegment(current);
+            started = true;
+        }
+        auto& seg = segments[current];
+        if (!seg.demuxer->readInto(&packet)) {
+            endSegment(seg);
+            current++;
+            started = false;
+            continue;
+        }
+        auto av_pkt = packet.av_packet();
+        status.packets++;
+        status.bytes += av_pkt->size;
+        auto it = seg.routes.find(av_pkt->stream_index);
+        if (it == seg.routes.end() || av_pkt->pts == AV_NOPTS_VALUE) {
+            av_packet_unref(av_pkt);
+            continue;
+        }
+        auto pkt_end = av_pkt->pts + av_pkt->duration;
+        seg.end = seg.end == AV_NOPTS_VALUE ? pkt_end : FFMAX(seg.end, pkt_end);
+        auto& route = it->second;
+        if (route.transcode != NULL)
+            encodeFrames(route, route.transcode->decoder->decode(&packet));
+        else
+            writePacket(route.output, &packet, false);
+        av_packet_unref(av_pkt);
+    }
+    status.end = finished;
+
+    return status;
+}
@@ -0,0 +1,89 @@
+#ifndef CONCAT_H
+#define CONCAT_H
+
+#include <map>
+#include <vector>
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+#include "packet.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "encode.h"
+#include "filter.h"
+#include "muxer.h"
+#include "remuxer.h"
+#include "bitstream.h"
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * Packet level concatenation: Demuxers (segments) are read one after another into Muxer(s),
+ * each segment shifted by the duration of previous ones.
+ * 
+ * An output stream is created from the stream of the first segment mapped to it
+ * (Muxer::newStream(demuxer, index)). Streams of later segments with compatible codec parameters
+ * (codec, size/sample rate, format, extradata...) are stream-copied, others are re-encoded
+ * (decode -> scale/resample -> Encoder matched to the output stream) for that segment only.
+ * The same Demuxer can be added several times (loop), it is seeked back to start.
+ * Demuxers and Muxers are owned by the caller.
+ */
+class Concatenator {
+    struct Output {
+        Muxer* muxer;
+        int stream_index;
+        AVStream* source;   // stream that output is created from
+        int64_t last_dts;
+        int64_t delay;      // pts - dts of copied key frames (B-frames reorder delay)
+        ExtradataKeeper extradata;
+    };
+    struct Transcode {
+        Decoder* decoder;
+        Filterer* filterer;
+        Encoder* encoder;
+    };
+    struct Route {
+        Output* output;
+        bool reencode;
+        Transcode* transcode; // created while its segment is processed
+    };
+    struct Segment {
+        Demuxer* demuxer;
+        map<int, Route> routes; // input stream index -> output
+        int64_t start;  // in AV_TIME_BASE
+        int64_t end;
+    };
+    vector<Segment> segments;
+    map<pair<Muxer*, int>, Output*> outputs;
+    Packet packet;
+    size_t current = 0;
+    bool started = false;
+    int64_t offset = 0; // in AV_TIME_BASE, start of current segment in output
+    bool finished = false;
+
+    void writePacket(Output* output, Packet* pkt, bool reencoded);
+    void encodeFrames(Route& route, vector<Frame*> frames, bool flush = false);
+    void beginSegment(size_t index);
+    void endSegment(Segment& segment);
+
+public:
+    Concatenator() {}
+    ~Concatenator();
+
+    /* append a segment, return its index */
+    int addSegment(Demuxer* demuxer);
+
+    /**
+     * map an input stream of a segment to an output stream, should be called before Muxer::writeHeader.
+     * return true if packets are stream-copied, false if the segment stream is re-encoded.
+     */
+    bool addStream(int segment, int in_stream_index, Muxer* muxer, int out_stream_index);
+
+    /* async, process until max_packets or max_bytes read, or end of all segments */
+    RemuxStatus process(int max_packets, int max_bytes);
+};
+
+
+#endif
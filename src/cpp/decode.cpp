@@ -2,6 +2,7 @@
 
 
 Decoder::Decoder(Demuxer* demuxer, int stream_index, string name) {
+    MemoryScope scope(memory);
     this->_name = name;
     auto stream = demuxer->av_stream(stream_index);
     auto codecpar = stream->codecpar;
@@ -10,10 +11,11 @@ Decoder::Decoder(Demuxer* demuxer, int stream_index, string name) {
     codec_ctx = avcodec_alloc_context3(codec);
     avcodec_parameters_to_context(codec_ctx, codecpar);
     codec_ctx->framerate = av_guess_frame_rate(demuxer->av_format_context(), stream, NULL);
-    avcodec_open2(codec_ctx, codec, NULL);
+    open(codec);
 }
 
 Decoder::Decoder(StreamInfo info, string name) {
+    MemoryScope scope(memory);
     this->_name = name;
     // create codec
     auto codec = avcodec_find_decoder(avcodec_descriptor_get_by_name(info.codec_name.c_str())->id);
@@ -22,17 +24,82 @@ Decoder::Decoder(StreamInfo info, string name) {
     codec_ctx = avcodec_alloc_context3(codec);
     // set parameters
     set_avcodec_context_from_streamInfo(info, codec_ctx);
-    avcodec_open2(codec_ctx, codec, NULL);
+    open(codec);
+}
+
+
+static AVDiscard discardLevel(const std::string& level) {
+    if (level == "") return AVDISCARD_DEFAULT;
+    if (level == "nonref") return AVDISCARD_NONREF;
+    if (level == "bidir") return AVDISCARD_BIDIR;
+    if (level == "nonintra") return AVDISCARD_NONINTRA;
+    if (level == "nonkey") return AVDISCARD_NONKEY;
+    if (level == "all") return AVDISCARD_ALL;
+    CHECK(false, "Decoder: unknown skip level");
+    return AVDISCARD_DEFAULT;
+}
+
+
+/* apply decode mode and open codec_ctx */
+void Decoder::open(const AVCodec* codec) {
+    codec_ctx->lowres = FFMIN(FFMAX(mode.lowres, 0), codec->max_lowres);
+    if (mode.fast) codec_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+    else codec_ctx->flags2 &= ~AV_CODEC_FLAG2_FAST;
+    codec_ctx->skip_loop_filter = discardLevel(mode.skip_loop_filter);
+    codec_ctx->skip_idct = discardLevel(mode.skip_idct);
+    codec_ctx->skip_frame = discardLevel(mode.skip_frame);
+    applyLiveDecoder(codec_ctx);
+    usePoolForCodec(codec_ctx);
+    auto ret = avcodec_open2(codec_ctx, codec, NULL);
+    CHECK(ret >= 0, "Decoder: could not open codec");
+}
+
+
+void Decoder::setDecodeMode(DecodeMode mode) {
+    MemoryScope scope(memory);
+    auto reopen = mode.lowres != this->mode.lowres || mode.fast != this->mode.fast;
+    this->mode = mode;
+    this->decoded_count = 0;
+    if (!reopen) {
+        // skip levels are read by decoders for each frame
+        codec_ctx->skip_loop_filter = discardLevel(mode.skip_loop_filter);
+        codec_ctx->skip_idct = discardLevel(mode.skip_idct);
+        codec_ctx->skip_frame = discardLevel(mode.skip_frame);
+        return;
+    }
+    // lowres/flags2 only take effect on open, so recreate context with same parameters
+    auto codec = codec_ctx->codec;
+    auto par = avcodec_parameters_alloc();
+    avcodec_parameters_from_context(par, codec_ctx);
+    auto new_ctx = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(new_ctx, par);
+    avcodec_parameters_free(&par);
+    new_ctx->framerate = codec_ctx->framerate;
+    new_ctx->time_base = codec_ctx->time_base;
+    new_ctx->pkt_timebase = codec_ctx->pkt_timebase;
+    avcodec_free_context(&codec_ctx);
+    codec_ctx = new_ctx;
+    open(codec);
 }
 
 std::vector<Frame*> Decoder::decodePacket(Packet* pkt) {
+    MemoryScope scope(memory);
+    StatsTimer timer(stats.process_time);
+    if (pkt->size() > 0) {
+        stats.packets++;
+        stats.bytes += pkt->size();
+        latency.in(pkt->av_packet()->pts);
+    }
     int ret = avcodec_send_packet(codec_ctx, pkt->av_packet());
+    stats.calls++;
     // get all the available frames from the decoder
     std::vector<Frame*> frames;
 
     while (1) {
         auto frame = new Frame(this->name());
         ret = avcodec_receive_frame(codec_ctx, frame->av_ptr());
+        stats.calls++;
+        stats.allocs++;
         if (ret < 0) {
             // those two return values are special and mean there is no output
             // frame available, but there were no errors during decoding
@@ -41,8 +108,15 @@ std::vector<Frame*> Decoder::decodePacket(Packet* pkt) {
                 break;
             CHECK(false, "decode frame failed");
         }
+        latency.out(frame->av_ptr()->best_effort_timestamp, stats);
+        // preview mode: drop frames in between (decoding is still needed for references)
+        if (mode.every_nth > 1 && decoded_count++ % mode.every_nth != 0) {
+            delete frame;
+            continue;
+        }
         frame->av_ptr()->pts = frame->av_ptr()->best_effort_timestamp;
         frames.push_back(frame);
+        stats.frames++;
     }
     return frames;
 }
@@ -11,17 +11,48 @@ extern "C" {
 #include "frame.h"
 #include "packet.h"
 #include "demuxer.h"
+#include "stats.h"
+#include "memory.h"
+#include "buffer_pool.h"
+#include "result_ring.h"
+#include "live.h"
 using namespace std;
 
 
+/**
+ * Preview (speed over quality) decoding knobs, default is full quality.
+ * skip_*: "" (default), "nonref", "bidir", "nonintra", "nonkey", "all" (AVDiscard levels)
+ * lowres: decode at 1/2^lowres size (only codecs supporting it, e.g. mjpeg)
+ * fast: AV_CODEC_FLAG2_FAST (non spec-compliant speedups)
+ * every_nth: output only every Nth decoded frame (0/1 outputs all)
+ */
+struct DecodeMode {
+    int lowres;
+    std::string skip_loop_filter;
+    std::string skip_idct;
+    std::string skip_frame;
+    bool fast;
+    int every_nth;
+};
+
+
 class Decoder {
     AVCodecContext* codec_ctx;
     std::string _name;
+    Stats stats = {};
+    MemoryAccount* memory = new MemoryAccount();
+    DecodeMode mode = {};
+    int64_t decoded_count = 0;
+    LatencyTracker latency;
+    void open(const AVCodec* codec);
 
 public:
     Decoder(Demuxer* demuxer, int stream_index, std::string name);
     Decoder(StreamInfo info, std::string name);
-    ~Decoder() { avcodec_free_context(&codec_ctx); };
+    ~Decoder() { 
+        avcodec_free_context(&codec_ctx); 
+        memory->detach();
+    };
     std::string name() const { return _name; }
     AVRational timeBase() const { return codec_ctx->time_base; }
     DataFormat dataFormat() const { return createDataFormat(codec_ctx); }
@@ -36,6 +67,24 @@ public:
         
         return frames;
     }
+    /* same as decode/flush, outputs appended to ring, return number of outputs */
+    int decodeInto(Packet* pkt, FrameRing* ring) {
+        auto frames = decode(pkt);
+        ring->push(frames);
+        return frames.size();
+    }
+    int flushInto(FrameRing* ring) {
+        auto frames = flush();
+        ring->push(frames);
+        return frames.size();
+    }
+    /* lowres/fast reopen the codec (call before decoding or after seeking to a key frame) */
+    void setDecodeMode(DecodeMode mode);
+    DecodeMode getDecodeMode() const { return mode; }
+    /* drop buffered frames/references after seeking */
+    void flushBuffers() { avcodec_flush_buffers(codec_ctx); }
+    Stats getStats() const { return stats; }
+    MemoryInfo getMemory() const { return memory->info(); }
 };
 
 
@@ -4,9 +4,9 @@
 // Custom reading avio https://www.codeproject.com/Tips/489450/Creating-Custom-FFmpeg-IO-Context
 static int read_packet(void *opaque, uint8_t *buf, int buf_size)
 {
-    auto& reader = *reinterpret_cast<val*>(opaque);
-    auto data = val(typed_memory_view(buf_size, buf));
-    auto read_size = reader.call<val>("read", data).await().as<int>();
+    auto demuxer = reinterpret_cast<Demuxer*>(opaque);
+    StatsTimer timer(demuxer->mutableStats().io_time);
+    auto read_size = demuxer->inputIO()->read(buf, buf_size);
 
     if (!read_size)
         return AVERROR_EOF;
@@ -19,24 +19,26 @@ static int read_packet(void *opaque, uint8_t *buf, int buf_size)
  * Warning: enable asyncify will disable bigInt, so be careful that binding int64_t not allowed 
  */
 static int64_t seek_for_read(void* opaque, int64_t pos, int whence) {
-    auto& reader = *reinterpret_cast<val*>(opaque);
-    auto size = (int64_t)reader["size"].as<double>();
-    auto offset = (int64_t)reader["offset"].as<double>();
+    auto demuxer = reinterpret_cast<Demuxer*>(opaque);
+    StatsTimer timer(demuxer->mutableStats().io_time);
+    auto io = demuxer->inputIO();
+    auto size = io->size();
+    auto offset = io->offset();
 
     switch (whence) {
         case AVSEEK_SIZE:
             return size;
         case SEEK_SET:
             if (pos >= size) return AVERROR_EOF;
-            reader.call<val>("seek", (double)pos).await(); break;
+            io->seek(pos); break;
         case SEEK_CUR:
             pos += offset;
             if (pos >= size) return AVERROR_EOF;
-            reader.call<val>("seek", (double)pos).await(); break;
+            io->seek(pos); break;
         case SEEK_END:
             if (pos >= size) return AVERROR_EOF;
             pos = size - pos;
-            reader.call<val>("seek", (double)pos).await(); break;
+            io->seek(pos); break;
         default:
             CHECK(false, "cannot process seek_for_read");
     }
@@ -45,15 +47,18 @@ static int64_t seek_for_read(void* opaque, int64_t pos, int whence) {
 }
 
 
-void Demuxer::build(val _reader) {
-    reader = std::move(_reader); // reader will be destroyed at end of this function 
+void Demuxer::build(InputIO* _io) {
+    MemoryScope scope(memory);
+    io = _io;
+    auto buf_size = getMemoryBudget().io_buffer;
     auto buffer = (uint8_t*)av_malloc(buf_size);
-    auto readerPtr = reinterpret_cast<void*>(&reader);
-    if ((int64_t)reader["size"].as<double>() <= 0)
-        io_ctx = avio_alloc_context(buffer, buf_size, 0, readerPtr, &read_packet, NULL, NULL);
+    auto ioPtr = reinterpret_cast<void*>(this);
+    if (io->size() <= 0)
+        io_ctx = avio_alloc_context(buffer, buf_size, 0, ioPtr, &read_packet, NULL, NULL);
     else
-        io_ctx = avio_alloc_context(buffer, buf_size, 0, readerPtr, &read_packet, NULL, &seek_for_read);
+        io_ctx = avio_alloc_context(buffer, buf_size, 0, ioPtr, &read_packet, NULL, &seek_for_read);
     format_ctx->pb = io_ctx;
+    applyLiveDemuxer(format_ctx);
     // open and get metadata
     auto ret = avformat_open_input(&format_ctx, NULL, NULL, NULL);
 
@@ -68,11 +73,29 @@ void Demuxer::build(val _reader) {
 
 Packet* Demuxer::read() {
     auto pkt = new Packet();
-    auto ret = av_read_frame(format_ctx, pkt->av_packet());
+    stats.allocs++;
+    readInto(pkt);
 
-    if (pkt->size() <= 0) return pkt;
-    // update current stream pts (avoid end of file where pkt is empty with uninit values)
+    return pkt;
+}
+
+
+bool Demuxer::readInto(Packet* pkt) {
+    MemoryScope scope(memory);
     auto av_pkt = pkt->av_packet();
+    av_packet_unref(av_pkt);
+    int ret;
+    {
+        StatsTimer timer(stats.process_time);
+        LatencyTimer latency(stats);
+        ret = av_read_frame(format_ctx, av_pkt);
+    }
+    stats.calls++;
+
+    if (ret < 0 || pkt->size() <= 0) return false;
+    stats.packets++;
+    stats.bytes += pkt->size();
+    // update current stream pts (avoid end of file where pkt is empty with uninit values)
     // convert to microseconds
     auto& time_base = format_ctx->streams[pkt->stream_index()]->time_base;
     av_packet_rescale_ts(av_pkt, time_base, AV_TIME_BASE_Q);
@@ -80,5 +103,5 @@ Packet* Demuxer::read() {
     auto next_pts = av_pkt->pts + av_pkt->duration;
     currentStreamsPTS[pkt->stream_index()] = next_pts / (double)AV_TIME_BASE;
 
-    return pkt;
-}
\ No newline at end of file
+    return true;
+}
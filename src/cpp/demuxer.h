@@ -4,7 +4,6 @@
 #include <cstdio>
 #include <string>
 #include <vector>
-#include <emscripten/val.h>
 extern "C" {
     #include <libavformat/avformat.h>
 }
@@ -13,27 +12,41 @@ extern "C" {
 #include "utils.h"
 #include "stream.h"
 #include "packet.h"
-using namespace emscripten;
+#include "io.h"
+#include "stats.h"
+#include "memory.h"
+#include "live.h"
 
 
 class Demuxer {
     AVFormatContext* format_ctx;
-    AVIOContext* io_ctx;
+    AVIOContext* io_ctx = NULL;
     std::map<int, double> currentStreamsPTS; 
-    int buf_size = 32*1024;
-    val reader;
+    InputIO* io = NULL;
+    Stats stats = {};
+    MemoryAccount* memory = new MemoryAccount();
 public:
     Demuxer() {
+        MemoryScope scope(memory);
         format_ctx = avformat_alloc_context();
     }
+#ifdef __EMSCRIPTEN__
     /* async */
-    void build(val _reader);
+    void build(emscripten::val _reader) { build(new ValReader(std::move(_reader))); }
+#endif
+    /* async, take ownership of io */
+    void build(InputIO* _io);
+    /* host file read directly (native or Node build) */
+    void buildFromFile(std::string path) { build(new FileReader(path)); }
 
     ~Demuxer() { 
         avformat_close_input(&format_ctx);
         if (io_ctx)
             av_freep(&io_ctx->buffer);
         avio_context_free(&io_ctx);
+        if (io != NULL)
+            delete io;
+        memory->detach();
     }
     
     /* async */
@@ -44,6 +57,9 @@ public:
     /* async */
     Packet* read();
 
+    /* async, read next packet into a reused one, return false at end of file */
+    bool readInto(Packet* pkt);
+
     void dump() {
         av_dump_format(format_ctx, 0, NULL, 0);
     }
@@ -62,8 +78,13 @@ public:
         return currentStreamsPTS[stream_index];
     }
 
+    Stats getStats() const { return stats; }
+    MemoryInfo getMemory() const { return memory->info(); }
+
 // only for c++    
     AVFormatContext* av_format_context() { return format_ctx; }
+    InputIO* inputIO() { return io; }
+    Stats& mutableStats() { return stats; }
     AVStream* av_stream(int i) { 
         CHECK(i >= 0 && i < format_ctx->nb_streams, "get av stream i error");
         return format_ctx->streams[i]; 
@@ -1,7 +1,9 @@
 #include "encode.h"
+#include <cstring>
 
 
 Encoder::Encoder(StreamInfo info) {
+    MemoryScope scope(memory);
     /* codec_ctx.time_base should smaller than 1/sample_rate (maybe change when open...??)
      * Because we need high resolution if using audio fifo to encode smaller sample size frame.
      */ 
@@ -11,7 +13,7 @@ Encoder::Encoder(StreamInfo info) {
     }
 
     // use codec id to specified codec name (h264 -> libx264)
-    auto codec = avcodec_find_encoder(avcodec_descriptor_get_by_name(info.codec_name.c_str())->id);
+    codec = avcodec_find_encoder(avcodec_descriptor_get_by_name(info.codec_name.c_str())->id);
     // auto codec = avcodec_find_encoder_by_name(info.codec_name.c_str());
     
     CHECK(codec, "Could not allocate video codec context");
@@ -20,31 +22,139 @@ Encoder::Encoder(StreamInfo info) {
     set_avcodec_context_from_streamInfo(info, codec_ctx);
     /* Allow the use of the experimental encoder. */
     codec_ctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
-    auto ret = avcodec_open2(codec_ctx, codec, NULL);
-    CHECK(ret == 0, "could not open codec");
+    auto target = getDefaultSpeedTarget();
+    if (target.speed > 0 && SpeedController::supported(codec))
+        speed = new SpeedController(codec, target);
+    open();
     // create fifo for audio (after codec_ctx init)
     if (codec_ctx->codec_type == AVMEDIA_TYPE_AUDIO)
         this->fifo = new AudioFrameFIFO(codec_ctx);
 }
 
 
+Encoder::Encoder(AVStream* source) {
+    MemoryScope scope(memory);
+    codec = avcodec_find_encoder(source->codecpar->codec_id);
+    CHECK(codec, "Could not find encoder of source stream");
+    codec_ctx = avcodec_alloc_context3(codec);
+    CHECK(codec_ctx, "Could not allocate video codec context");
+    auto ret = avcodec_parameters_to_context(codec_ctx, source->codecpar);
+    CHECK(ret >= 0, "Could not copy source stream parameters");
+    // headers are written in-band by encoder (no global header)
+    av_freep(&codec_ctx->extradata);
+    codec_ctx->extradata_size = 0;
+    codec_ctx->time_base = source->time_base;
+    codec_ctx->framerate = source->avg_frame_rate;
+    // keep presentation order, so that re-encoded parts join copied packets
+    codec_ctx->max_b_frames = 0;
+    codec_ctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+    open();
+    if (codec_ctx->codec_type == AVMEDIA_TYPE_AUDIO)
+        this->fifo = new AudioFrameFIFO(codec_ctx);
+}
+
+
+void Encoder::open() {
+    AVDictionary* options = NULL;
+    applyLiveEncoder(codec_ctx, &options);
+    if (speed != NULL)
+        speed->apply(codec_ctx, &options);
+    usePoolForCodec(codec_ctx);
+    auto ret = avcodec_open2(codec_ctx, codec, &options);
+    av_dict_free(&options);
+    CHECK(ret == 0, "could not open codec");
+}
+
+
+/**
+ * Drain and close current codec, then open a new one with the same parameters (at current speed level).
+ * Stream headers were written by muxer from the extradata of the first codec: when the new one differs,
+ * the level is refused and codec opened again at the previous level.
+ * Return drained packets (in codec time_base, unchanged).
+ */
+vector<Packet*> Encoder::reopen() {
+    auto packets = encodeFrame(NULL);
+    vector<uint8_t> header(codec_ctx->extradata, codec_ctx->extradata + codec_ctx->extradata_size);
+    recreate();
+    open();
+    auto same = header.size() == (size_t)codec_ctx->extradata_size && 
+        (header.empty() || memcmp(header.data(), codec_ctx->extradata, header.size()) == 0);
+    if (!same && speed != NULL) {
+        speed->reject();
+        recreate();
+        open();
+    }
+    return packets;
+}
+
+
+/* new (not opened) codec context with the parameters of current one */
+void Encoder::recreate() {
+    auto ctx = avcodec_alloc_context3(codec);
+    CHECK(ctx, "Could not allocate video codec context");
+    auto par = avcodec_parameters_alloc();
+    avcodec_parameters_from_context(par, codec_ctx);
+    auto ret = avcodec_parameters_to_context(ctx, par);
+    avcodec_parameters_free(&par);
+    CHECK(ret >= 0, "Could not copy codec parameters");
+    // headers generated again by encoder
+    av_freep(&ctx->extradata);
+    ctx->extradata_size = 0;
+    ctx->time_base = codec_ctx->time_base;
+    ctx->framerate = codec_ctx->framerate;
+    ctx->flags = codec_ctx->flags;
+    ctx->gop_size = codec_ctx->gop_size;
+    ctx->max_b_frames = codec_ctx->max_b_frames;
+    ctx->rc_max_rate = codec_ctx->rc_max_rate;
+    ctx->rc_buffer_size = codec_ctx->rc_buffer_size;
+    ctx->thread_count = codec_ctx->thread_count;
+    ctx->thread_type = codec_ctx->thread_type;
+    ctx->strict_std_compliance = codec_ctx->strict_std_compliance;
+    avcodec_free_context(&codec_ctx);
+    codec_ctx = ctx;
+}
+
+
+bool Encoder::setSpeedTarget(SpeedTarget target) {
+    if (codec_ctx->codec_type != AVMEDIA_TYPE_VIDEO || !SpeedController::supported(codec)) 
+        return false;
+    // once adapted, the codec keeps its speed options (and stream headers), speed 0 only stops adapting
+    if (speed != NULL)
+        speed_reopen = speed->setTarget(target) || speed_reopen;
+    else if (target.speed > 0) {
+        speed = new SpeedController(codec, target);
+        speed_reopen = true;
+    }
+    return true;
+}
+
+
 /**
  * refer: FFmpeg/doc/examples/encode_video.c
  */
 vector<Packet*> Encoder::encodeFrame(Frame* frame) {
+    StatsTimer timer(stats.process_time);
     auto avframe = frame == NULL ? NULL : frame->av_ptr();
+    if (avframe != NULL) latency.in(avframe->pts);
     auto ret = avcodec_send_frame(codec_ctx, avframe);
     CHECK(ret >= 0, "Error sending a frame for encoding");
+    stats.calls++;
+    if (frame != NULL) stats.frames++;
     vector<Packet*> packets;
     while (1) {
         auto pkt = new Packet();
         ret = avcodec_receive_packet(codec_ctx, pkt->av_packet());
+        stats.calls++;
+        stats.allocs++;
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             delete pkt;
             break;
         }
         CHECK(ret >= 0, "Error during encoding");
+        latency.out(pkt->av_packet()->pts, stats);
         packets.push_back(pkt);
+        stats.packets++;
+        stats.bytes += pkt->size();
     }
     return packets;
 }
@@ -54,10 +164,17 @@ vector<Packet*> Encoder::encodeFrame(Frame* frame) {
  * refer: FFmpeg/doc/examples/transcode_aac.c
  */
 vector<Packet*> Encoder::encode(Frame* frame) {
-    // rescale pts
-    frame->set_pts(av_rescale_q(frame->pts(), AV_TIME_BASE_Q, codec_ctx->time_base));
-
+    MemoryScope scope(memory);
     vector<Packet*> outVec;
+    // speed level changes at this frame: new GOP from a reopened codec
+    if (frame != NULL && ((speed != NULL && speed->next(frame->pts())) || speed_reopen)) {
+        outVec = reopen();
+        speed_reopen = false;
+    }
+    // rescale pts (frame is NULL when flushing)
+    if (frame != NULL)
+        frame->set_pts(av_rescale_q(frame->pts(), AV_TIME_BASE_Q, codec_ctx->time_base));
+
     /* Make sure that there is one frame worth of samples in the FIFO
      * buffer so that the encoder can do its work.
      * Since the decoder's and the encoder's frame size may differ, we
@@ -75,7 +192,10 @@ vector<Packet*> Encoder::encode(Frame* frame) {
         }
     }
     else {
+        auto start = speed != NULL ? stats_now() : 0;
         const auto& pkt_vec = this->encodeFrame(frame);
+        if (speed != NULL) 
+            speed->addTime(stats_now() - start);
         outVec.insert(std::end(outVec), std::begin(pkt_vec), std::end(pkt_vec)); 
     }
     // rescale back to base time_base
@@ -13,6 +13,12 @@ extern "C" {
 #include "packet.h"
 #include "frame.h"
 #include "utils.h"
+#include "stats.h"
+#include "memory.h"
+#include "buffer_pool.h"
+#include "result_ring.h"
+#include "live.h"
+#include "speed.h"
 
 
 class Encoder {
@@ -20,21 +26,50 @@ class Encoder {
      * @brief encoder for a video/audio stream.
      * 
      */
+    const AVCodec* codec;
     AVCodecContext* codec_ctx;
     AudioFrameFIFO* fifo = NULL;
+    SpeedController* speed = NULL;
+    bool speed_reopen = false;
+    Stats stats = {};
+    LatencyTracker latency;
+    MemoryAccount* memory = new MemoryAccount();
+
+    void open();
+    void recreate();
+    vector<Packet*> reopen();
 
 public:
     Encoder(StreamInfo info);
+    /* c++ only, same codec and parameters (size, profile, level...) as a demuxed stream, without B-frames */
+    Encoder(AVStream* source);
     ~Encoder() { 
         if (fifo != NULL)
             delete fifo;
+        if (speed != NULL)
+            delete speed;
         avcodec_free_context(&codec_ctx); 
+        memory->detach();
     };
     AVRational timeBase() const { return codec_ctx->time_base; }
     DataFormat dataFormat() const { return createDataFormat(codec_ctx); }
     vector<Packet*> encodeFrame(Frame* frame);
     vector<Packet*> encode(Frame* frame);
     vector<Packet*> flush() { return encode(NULL); }
+    /* same as encode/flush, outputs appended to ring, return number of outputs */
+    int encodeInto(Frame* frame, PacketRing* ring) {
+        auto pkts = encode(frame);
+        ring->push(pkts);
+        return pkts.size();
+    }
+    int flushInto(PacketRing* ring) { return encodeInto(NULL, ring); }
+    Stats getStats() const { return stats; }
+    MemoryInfo getMemory() const { return memory->info(); }
+    /* adaptive speed (see SpeedTarget), applied from next frame. Return false if codec not supported */
+    bool setSpeedTarget(SpeedTarget target);
+    vector<SpeedChange> getSpeedHistory() const { 
+        return speed != NULL ? speed->getHistory() : vector<SpeedChange>(); 
+    }
 // c++ only
     void setFlags(int flag) { codec_ctx->flags |= flag; }
     const AVCodecContext* av_codecContext_ptr() { return codec_ctx; }
@@ -0,0 +1,155 @@
+#include "fanout.h"
+#include <algorithm>
+
+
+FanOut::FanOut(Demuxer* demuxer, int stream_index) {
+    this->demuxer = demuxer;
+    this->stream_index = stream_index;
+    CHECK(demuxer->av_stream(stream_index)->codecpar->codec_type == AVMEDIA_TYPE_VIDEO, 
+        "FanOut: only video stream");
+    decoder = new Decoder(demuxer, stream_index, "fanout");
+}
+
+
+FanOut::~FanOut() {
+    for (auto& b : branches) {
+        for (auto f : b.queue)
+            delete f;
+        sws_freeContext(b.sws_ctx);
+        delete b.encoder;
+    }
+    delete decoder;
+}
+
+
+int FanOut::addBranch(int parent, Muxer* muxer, StreamInfo info) {
+    CHECK(parent >= -1 && parent < (int)branches.size(), "FanOut: parent branch should be added before");
+    CHECK(!started, "FanOut: add branches before first step");
+    auto in_format = parent < 0 ? (AVPixelFormat)demuxer->av_stream(stream_index)->codecpar->format : 
+        branches[parent].format;
+    auto format = info.format != "" ? av_get_pix_fmt(info.format.c_str()) : in_format;
+    auto encoder = new Encoder(info);
+    auto out_stream_index = muxer->nb_streams();
+    muxer->newStream(encoder);
+    if (std::find(muxers.begin(), muxers.end(), muxer) == muxers.end())
+        muxers.push_back(muxer);
+    branches.push_back({
+        .parent = parent, .width = info.width, .height = info.height, .format = format,
+        .sws_ctx = NULL, .encoder = encoder, .muxer = muxer, .stream_index = out_stream_index,
+        .queue = {}, .paused = false,
+    });
+    return branches.size() - 1;
+}
+
+
+void FanOut::setPaused(int branch, bool paused) {
+    CHECK(branch >= 0 && branch < (int)branches.size(), "FanOut: branch out of range");
+    branches[branch].paused = paused;
+}
+
+
+/* queue a frame (shared or scaled) to every branch, frame is deleted */
+void FanOut::distribute(Frame* frame) {
+    vector<Frame*> outs(branches.size(), NULL);
+    for (size_t i = 0; i < branches.size(); i++) {
+        auto& b = branches[i];
+        auto src = b.parent < 0 ? frame : outs[b.parent];
+        auto src_frame = src->av_ptr();
+        Frame* out;
+        // decoded size/format may differ from stream parameters, or change mid-stream
+        if (src_frame->width == b.width && src_frame->height == b.height && src_frame->format == b.format) {
+            out = new Frame(src->name());
+            auto ret = av_frame_ref(out->av_ptr(), src->av_ptr());
+            CHECK(ret >= 0, "FanOut: could not reference frame");
+        }
+        else {
+            FrameInfo info = {.format = av_get_pix_fmt_name(b.format), .height = b.height, .width = b.width};
+            out = new Frame(info, src->pts(), src->name());
+            auto dst_frame = out->av_ptr();
+            b.sws_ctx = sws_getCachedContext(b.sws_ctx, src_frame->width, src_frame->height, 
+                (AVPixelFormat)src_frame->format, b.width, b.height, b.format, SWS_BICUBIC, NULL, NULL, NULL);
+            CHECK(b.sws_ctx != NULL, "FanOut: cannot create scaler");
+            sws_scale(b.sws_ctx, src_frame->data, src_frame->linesize, 0, src_frame->height, 
+                dst_frame->data, dst_frame->linesize);
+            av_frame_copy_props(dst_frame, src_frame);
+        }
+        // let each encoder decide its own frame types
+        out->av_ptr()->pict_type = AV_PICTURE_TYPE_NONE;
+        outs[i] = out;
+        b.queue.push_back(out);
+    }
+    delete frame;
+}
+
+
+void FanOut::drain(Branch& b) {
+    while (!b.paused && !b.queue.empty()) {
+        auto frame = b.queue.front();
+        b.queue.pop_front();
+        for (auto pkt : b.encoder->encode(frame)) {
+            b.muxer->writeFrame(pkt, b.stream_index);
+            delete pkt;
+        }
+        delete frame;
+    }
+}
+
+
+void FanOut::finish() {
+    for (auto& b : branches)
+        for (auto pkt : b.encoder->flush()) {
+            b.muxer->writeFrame(pkt, b.stream_index);
+            delete pkt;
+        }
+    for (auto muxer : muxers)
+        muxer->writeTrailer();
+    end = true;
+}
+
+
+FanOutStatus FanOut::step(int max_packets) {
+    FanOutStatus status = {.packets = 0, .end = end, .throttled = false, .blocked = -1};
+    if (!started) {
+        for (auto muxer : muxers)
+            muxer->writeHeader();
+        started = true;
+    }
+
+    while (!end) {
+        for (auto& b : branches)
+            drain(b);
+        // per-branch backpressure: a full queue stops decoding until the branch resumes
+        for (size_t i = 0; i < branches.size() && status.blocked < 0; i++)
+            if (branches[i].queue.size() >= (size_t)max_queue)
+                status.blocked = i;
+        if (status.blocked >= 0) break;
+        if (input_end) {
+            auto pending = std::any_of(branches.begin(), branches.end(), [](Branch& b) { return !b.queue.empty(); });
+            if (!pending) finish();
+            break;
+        }
+        if (status.packets >= max_packets) break;
+        if (status.packets > 0 && overMemoryBudget()) {
+            for (auto muxer : muxers)
+                muxer->flushInterleave();
+            if (overMemoryBudget()) {
+                status.throttled = true;
+                break;
+            }
+        }
+        if (!demuxer->readInto(&packet)) {
+            for (auto frame : decoder->flush())
+                distribute(frame);
+            input_end = true;
+            continue;
+        }
+        status.packets++;
+        if (packet.stream_index() == stream_index)
+            for (auto frame : decoder->decode(&packet))
+                distribute(frame);
+        av_packet_unref(packet.av_packet());
+    }
+    status.end = end;
+
+    return status;
+}
@@ -0,0 +1,88 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <deque>
+#include <vector>
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libswscale/swscale.h>
+}
+
+#include "packet.h"
+#include "frame.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "encode.h"
+#include "muxer.h"
+#include "metadata.h"
+#include "utils.h"
+using namespace std;
+
+
+struct FanOutStatus {
+    int packets;
+    bool end;
+    bool throttled; // stopped early because over memory budget
+    int blocked;    // branch whose queue is full (paused), -1 if none
+};
+
+
+/**
+ * Decode once, encode many (e.g. ABR ladder): one video stream of a Demuxer is decoded once
+ * and fed to several Scale -> Encoder -> Muxer branches.
+ * 
+ * A branch scales from the decoded frames or from the output of another branch (cascade,
+ * 1080p -> 720p -> 480p), frames of the same size/format are shared by reference (av_frame_ref),
+ * never copied. Each branch has a frame queue: a paused branch (e.g. its output not drained)
+ * keeps its queue, and decoding stops once any queue reaches max_queue frames.
+ * Demuxer and Muxers are owned by the caller, headers and trailers are written by FanOut.
+ */
+class FanOut {
+    struct Branch {
+        int parent;             // -1 for decoded frames
+        int width;
+        int height;
+        AVPixelFormat format;
+        SwsContext* sws_ctx;    // scaler of the last input size/format, NULL until frames need scaling
+        Encoder* encoder;
+        Muxer* muxer;
+        int stream_index;
+        deque<Frame*> queue;
+        bool paused;
+    };
+    Demuxer* demuxer;
+    int stream_index;
+    Decoder* decoder;
+    vector<Branch> branches; // parents always before children
+    vector<Muxer*> muxers;
+    Packet packet;
+    int max_queue = 8;
+    bool started = false;
+    bool input_end = false;
+    bool end = false;
+
+    void distribute(Frame* frame);
+    void drain(Branch& branch);
+    void finish();
+
+public:
+    FanOut(Demuxer* demuxer, int stream_index);
+    ~FanOut();
+
+    /**
+     * add a branch encoding frames of `parent` (-1 for decoded frames) scaled to info.width/height/format,
+     * into a new stream of muxer. return branch index.
+     */
+    int addBranch(int parent, Muxer* muxer, StreamInfo info);
+
+    /* paused branch does not encode, its queued frames block decoding when full */
+    void setPaused(int branch, bool paused);
+    void setMaxQueue(int frames) { max_queue = FFMAX(frames, 1); }
+    int queueSize(int branch) { return branches[branch].queue.size(); }
+
+    /* async, read at most max_packets packets */
+    FanOutStatus step(int max_packets);
+};
+
+
+#endif
@@ -0,0 +1,37 @@
+#include "features.h"
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libavfilter/avfilter.h>
+}
+
+#ifndef BUILD_PROFILE
+#define BUILD_PROFILE "full"
+#endif
+
+
+string buildProfile() { return BUILD_PROFILE; }
+
+
+/* same lookup as Decoder/Encoder: codec id of descriptor name (h264 -> libx264) */
+static AVCodecID codecId(const string& name) {
+    auto desc = avcodec_descriptor_get_by_name(name.c_str());
+    return desc ? desc->id : AV_CODEC_ID_NONE;
+}
+
+bool hasDecoder(string name) {
+    auto id = codecId(name);
+    return id != AV_CODEC_ID_NONE && avcodec_find_decoder(id) != NULL;
+}
+
+bool hasEncoder(string name) {
+    auto id = codecId(name);
+    return id != AV_CODEC_ID_NONE && avcodec_find_encoder(id) != NULL;
+}
+
+bool hasDemuxer(string name) { return av_find_input_format(name.c_str()) != NULL; }
+
+/* same lookup as Muxer */
+bool hasMuxer(string name) { return av_guess_format(name.c_str(), NULL, NULL) != NULL; }
+
+bool hasFilter(string name) { return avfilter_get_by_name(name.c_str()) != NULL; }
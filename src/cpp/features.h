@@ -0,0 +1,22 @@
+#ifndef FEATURES_H
+#define FEATURES_H
+
+#include <string>
+using namespace std;
+
+
+/* build profile (build_profiles/<name>.sh): "probe", "audio", "transmux" or "full" */
+string buildProfile();
+
+/**
+ * Components of this build, names as used by Decoder/Encoder (codec descriptor names, e.g. h264),
+ * Demuxer/Muxer (format names, e.g. mp4) and Filterer (filter names).
+ */
+bool hasDecoder(string name);
+bool hasEncoder(string name);
+bool hasDemuxer(string name);
+bool hasMuxer(string name);
+bool hasFilter(string name);
+
+
+#endif
@@ -28,8 +28,11 @@ Filterer::Filterer(
     map<string, string> outParams, 
     map<string, string> mediaTypes, 
     string filterSpec
-) {
+) : media_types(mediaTypes) {
+    MemoryScope scope(memory);
     AVFilterGraph* graph = filterGraph.av_FilterGraph();
+    InOut inputs;
+    InOut outputs;
     // create input nodes
     for (auto const& [id, params] : inParams) {
         CHECK(id.length() > 0, "Filterer: buffersrc id should not be empty");
@@ -57,6 +60,130 @@ Filterer::Filterer(
     CHECK(ret >= 0, "cannot parse filter graph");
     ret = avfilter_graph_config(graph, NULL);
     CHECK(ret >= 0, "cannot configure graph");
+
+    // parameters negotiated on buffersrc links, to detect changes of input frames
+    for (auto const& [id, ctx] : buffersrc_ctx_map) {
+        auto link = ctx->outputs[0];
+        src_params[id] = {link->w, link->h, link->format, link->sample_rate, link->channel_layout};
+        inplace[id] = media_types[id] == "video" && strcmp(link->dst->filter->name, "scale") == 0;
+    }
+}
+
+
+Filterer::~Filterer() {
+    {
+        MemoryScope scope(memory);
+        for (auto const& [_, adapter] : adapters) delete adapter;
+    }
+    memory->detach();
+}
+
+
+bool Filterer::changed(AVFrame* f, const SourceParams& p, bool video) {
+    if (video)
+        return f->width != p.width || f->height != p.height || f->format != p.format;
+    return f->sample_rate != p.sample_rate || f->format != p.format || 
+        (f->channel_layout != 0 && f->channel_layout != p.channel_layout);
+}
+
+
+/* send a frame to its buffersrc, and pull frames as much as possible */
+void Filterer::feed(const string& id, AVFrame* frame, vector<Frame*>& out_frames) {
+    latency.in(frame->pts);
+    auto ret = av_buffersrc_add_frame_flags(buffersrc_ctx_map[id], frame, AV_BUFFERSRC_FLAG_KEEP_REF);
+    CHECK(ret >= 0, "Error while feeding the filtergraph");
+    stats.calls++;
+    pull(out_frames);
+}
+
+
+/* pull filtered frames from each entry of filtergraph outputs */
+void Filterer::pull(vector<Frame*>& out_frames) {
+    for (auto const& [id, ctx] : buffersink_ctx_map) {
+        while (1) {
+            auto out_frame = new Frame(id);
+            auto ret = av_buffersink_get_frame(ctx, out_frame->av_ptr());
+            stats.calls++;
+            stats.allocs++;
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                delete out_frame;
+                break;
+            }
+            CHECK(ret >= 0, "error get filtered frames from buffersink");
+            latency.out(out_frame->av_ptr()->pts, stats);
+            out_frame->av_ptr()->pict_type = AV_PICTURE_TYPE_NONE;
+            out_frames.push_back(out_frame);
+            stats.frames++;
+        }
+    }
+}
+
+
+/**
+ * Input frame parameters differ from its buffersrc ones (e.g. concatenated/HLS sources).
+ * A video input going straight into a scaler (also auto-inserted ones) only gets its buffersrc updated,
+ * the scaler renegotiates its input link on the next frame (as vf_scale does on frame changes).
+ * Other inputs are converted back to the configured parameters by a small adapter graph (scale/aresample),
+ * so that the graph is not rebuilt: its buffered frames and state (setpts STARTPTS, trim...) are kept.
+ */
+void Filterer::adapt(const string& id, Frame* frame, vector<Frame*>& out_frames) {
+    auto f = frame->av_ptr();
+    auto isVideo = media_types[id] == "video";
+    if (inplace[id]) {
+        auto par = av_buffersrc_parameters_alloc();
+        par->width = f->width;
+        par->height = f->height;
+        par->format = f->format;
+        auto ret = av_buffersrc_parameters_set(buffersrc_ctx_map[id], par);
+        av_free(par);
+        CHECK(ret >= 0, "Filterer: cannot update buffersrc parameters");
+        src_params[id] = {f->width, f->height, f->format, 0, 0};
+        graph_info.reinits++;
+        feed(id, f, out_frames);
+        return;
+    }
+
+    // changed again, the previous adapter may hold frames (resampler)
+    if (adapters.count(id) > 0 && changed(f, adapter_params[id], isVideo))
+        dropAdapter(id, out_frames);
+    if (adapters.count(id) == 0) {
+        auto& p = src_params[id];
+        auto link = buffersrc_ctx_map[id]->outputs[0];
+        auto info = frame->getFrameInfo();
+        auto tb = to_string(link->time_base.num) + "/" + to_string(link->time_base.den);
+        auto args = isVideo ?
+            "video_size=" + to_string(f->width) + "x" + to_string(f->height) + ":pix_fmt=" + info.format + ":time_base=" + tb :
+            "sample_rate=" + to_string(f->sample_rate) + ":sample_fmt=" + info.format + 
+                ":channel_layout=" + info.channel_layout + ":time_base=" + tb;
+        // resampler outputs in 1/sample_rate, back to time base of the buffersrc
+        auto spec = isVideo ?
+            "scale=" + to_string(p.width) + ":" + to_string(p.height) + 
+                ",format=pix_fmts=" + av_get_pix_fmt_name((AVPixelFormat)p.format) :
+            "aresample=" + to_string(p.sample_rate) + 
+                ",aformat=sample_fmts=" + av_get_sample_fmt_name((AVSampleFormat)p.format) + 
+                ":channel_layouts=" + get_channel_layout_name(av_get_channel_layout_nb_channels(p.channel_layout), p.channel_layout) +
+                ",asettb=" + tb;
+        adapters[id] = new Filterer(
+            {{id, args}}, {{id, ""}}, {{id, media_types[id]}}, "[" + id + "]" + spec + "[" + id + "]");
+        adapter_params[id] = {f->width, f->height, f->format, f->sample_rate, f->channel_layout};
+        graph_info.converted++;
+    }
+    for (auto converted : adapters[id]->filter({frame})) {
+        feed(id, converted->av_ptr(), out_frames);
+        delete converted;
+    }
+}
+
+
+/* flush the adapter of an input into the graph */
+void Filterer::dropAdapter(const string& id, vector<Frame*>& out_frames) {
+    auto adapter = adapters[id];
+    for (auto converted : adapter->flush()) {
+        feed(id, converted->av_ptr(), out_frames);
+        delete converted;
+    }
+    delete adapter;
+    adapters.erase(id);
 }
 
 
@@ -65,6 +192,8 @@ Filterer::Filterer(
  * In/Out frames should all have non-empty Frame::name.
  */
 vector<Frame*> Filterer::filter(vector<Frame*> frames) {
+    MemoryScope scope(memory);
+    StatsTimer timer(stats.process_time);
     std::vector<Frame*> out_frames;
     
     // At each time, send a frame, and pull frames as much as possible.
@@ -72,23 +201,14 @@ vector<Frame*> Filterer::filter(vector<Frame*> frames) {
         // feed to graph
         const auto& id = frame->name();
         if (buffersrc_ctx_map.count(id) == 0) continue;
-        auto ctx = buffersrc_ctx_map[id];
-        auto ret = av_buffersrc_add_frame_flags(ctx, frame->av_ptr(), AV_BUFFERSRC_FLAG_KEEP_REF);
-        CHECK(ret >= 0, "Error while feeding the filtergraph");
-        // pull filtered frames from each entry of filtergraph outputs
-        for (auto const& [id, ctx] : buffersink_ctx_map) {
-            while (1) {
-                auto out_frame = new Frame(id);
-                auto ret = av_buffersink_get_frame(ctx, out_frame->av_ptr());
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                    delete out_frame;
-                    break;
-                }
-                CHECK(ret >= 0, "error get filtered frames from buffersink");
-                out_frame->av_ptr()->pict_type = AV_PICTURE_TYPE_NONE;
-                out_frames.push_back(out_frame);
-            }
+        if (changed(frame->av_ptr(), src_params[id], media_types[id] == "video")) {
+            adapt(id, frame, out_frames);
+            continue;
         }
+        // back to configured parameters
+        if (adapters.count(id) > 0)
+            dropAdapter(id, out_frames);
+        feed(id, frame->av_ptr(), out_frames);
     }
 
     return out_frames;
@@ -96,24 +216,16 @@ vector<Frame*> Filterer::filter(vector<Frame*> frames) {
     
 
 vector<Frame*> Filterer::flush() {
+    MemoryScope scope(memory);
+    StatsTimer timer(stats.process_time);
     std::vector<Frame*> out_frames;
+    while (adapters.size() > 0)
+        dropAdapter(adapters.begin()->first, out_frames);
     for (const auto& [id, ctx] : buffersrc_ctx_map) {
         auto ret = av_buffersrc_add_frame_flags(ctx, NULL, AV_BUFFERSRC_FLAG_KEEP_REF);
         CHECK(ret >= 0, "Error while flushing the filtergraph");
-        // pull filtered frames from each entry of filtergraph outputs
-        for (auto const& [id, ctx] : buffersink_ctx_map) {
-            while (1) {
-                auto out_frame = new Frame(id);
-                auto ret = av_buffersink_get_frame(ctx, out_frame->av_ptr());
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                    delete out_frame;
-                    break;
-                }
-                CHECK(ret >= 0, "error get filtered frames from buffersink");
-                out_frame->av_ptr()->pict_type = AV_PICTURE_TYPE_NONE;
-                out_frames.push_back(out_frame);
-            }
-        }
+        stats.calls++;
+        pull(out_frames);
     }
 
     return out_frames;
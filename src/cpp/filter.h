@@ -14,6 +14,9 @@ extern "C" {
 #include "stream.h"
 #include "demuxer.h"
 #include "muxer.h"
+#include "stats.h"
+#include "memory.h"
+#include "result_ring.h"
 using namespace std;
 
 
@@ -36,12 +39,37 @@ public:
 };
 
 
+/* input changes handled by a Filterer, see Filterer::filter */
+struct FilterGraphInfo {
+    int reinits;    // handled in place by the scaler after the buffersrc
+    int converted;  // converted to the configured buffersrc parameters
+};
+
+
 class Filterer {
+    /* frame parameters a buffersrc is configured with */
+    struct SourceParams {
+        int width, height, format, sample_rate;
+        uint64_t channel_layout;
+    };
     FilterGraph filterGraph;
-    InOut inputs;
-    InOut outputs;
     map<string, AVFilterContext*> buffersrc_ctx_map;
     map<string, AVFilterContext*> buffersink_ctx_map;
+    map<string, string> media_types;
+    map<string, SourceParams> src_params;
+    map<string, bool> inplace;          // video buffersrc feeding a scale filter (reconfigures itself on frame changes)
+    map<string, Filterer*> adapters;    // input id -> conversion of changed input frames to src_params
+    map<string, SourceParams> adapter_params;
+    FilterGraphInfo graph_info = {};
+    Stats stats = {};
+    LatencyTracker latency;
+    MemoryAccount* memory = new MemoryAccount();
+
+    static bool changed(AVFrame* f, const SourceParams& p, bool video);
+    void feed(const string& id, AVFrame* frame, vector<Frame*>& out_frames);
+    void pull(vector<Frame*>& out_frames);
+    void adapt(const string& id, Frame* frame, vector<Frame*>& out_frames);
+    void dropAdapter(const string& id, vector<Frame*>& out_frames);
 
 public:
     /**
@@ -53,8 +81,24 @@ public:
      * @param filterSpec 
      */
     Filterer(map<string, string> inParams, map<string, string> outParams, map<string, string> mediaTypes, string filterSpec);
+    ~Filterer();
     vector<Frame*> filter(vector<Frame*>);
     vector<Frame*> flush();
+    /* filter a single frame (no input vector), outputs appended to ring, return number of outputs */
+    int filterInto(Frame* frame, FrameRing* ring) {
+        auto frames = filter({frame});
+        ring->push(frames);
+        return frames.size();
+    }
+    int flushInto(FrameRing* ring) {
+        auto frames = flush();
+        ring->push(frames);
+        return frames.size();
+    }
+    /* frames counts output frames */
+    Stats getStats() const { return stats; }
+    MemoryInfo getMemory() const { return memory->info(); }
+    FilterGraphInfo getGraphInfo() const { return graph_info; }
 };
 
 
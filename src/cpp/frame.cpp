@@ -1,4 +1,9 @@
 #include "frame.h"
+#include <cstring>
+extern "C" {
+    #include <libswscale/swscale.h>
+    #include <libswresample/swresample.h>
+}
 
 
  
@@ -10,7 +15,7 @@ Frame::Frame(FrameInfo info, double pts, std::string name) {
         av_frame->format = av_get_pix_fmt(info.format.c_str());
         av_frame->height = info.height;
         av_frame->width = info.width;
-        auto ret = av_frame_get_buffer(av_frame, 0);
+        auto ret = poolFrameBuffer(av_frame, 0);
         CHECK(ret >= 0, "Could not allocate output frame samples (error '%s')");
     }
     else {
@@ -54,11 +59,120 @@ void Frame::audio_reinit(AVSampleFormat sample_fmt, int sample_rate, uint64_t ch
     av_frame->format         = sample_fmt;
     av_frame->sample_rate    = sample_rate;
     av_frame->nb_samples = nb_samples;
-    auto ret = av_frame_get_buffer(av_frame, 0);
+    auto ret = poolFrameBuffer(av_frame, 0);
     CHECK(ret >= 0, "Could not allocate output frame samples");
 }
 
 
+/* WebCodecs style names, or FFmpeg format names */
+static AVPixelFormat layoutPixelFormat(const std::string& layout, AVPixelFormat src) {
+    if (layout == "") return src;
+    if (layout == "I420") return AV_PIX_FMT_YUV420P;
+    if (layout == "NV12") return AV_PIX_FMT_NV12;
+    if (layout == "RGBA") return AV_PIX_FMT_RGBA;
+    auto format = av_get_pix_fmt(layout.c_str());
+    CHECK(format != AV_PIX_FMT_NONE, "Frame::copyTo: unknown video layout");
+    return format;
+}
+
+static AVSampleFormat layoutSampleFormat(const std::string& layout, AVSampleFormat src) {
+    if (layout == "") return src;
+    if (layout == "f32") return AV_SAMPLE_FMT_FLT;
+    if (layout == "s16") return AV_SAMPLE_FMT_S16;
+    auto format = av_get_sample_fmt(layout.c_str());
+    CHECK(format != AV_SAMPLE_FMT_NONE, "Frame::copyTo: unknown audio layout");
+    return format;
+}
+
+/* linesizes of each plane, first plane with given stride (0 for packed) and others scaled */
+static void layoutLinesizes(int linesizes[4], AVPixelFormat format, int width, int stride) {
+    auto ret = av_image_fill_linesizes(linesizes, format, width);
+    CHECK(ret >= 0, "Frame::copyTo: invalid video size");
+    if (stride <= 0 || stride == linesizes[0]) return;
+    CHECK(stride > linesizes[0], "Frame::copyTo: stride is smaller than row size");
+    for (int i = 1; i < 4; i++)
+        linesizes[i] = (int)(((int64_t)linesizes[i] * stride + linesizes[0] - 1) / linesizes[0]);
+    linesizes[0] = stride;
+}
+
+
+int Frame::copySize(std::string layout, int stride) {
+    auto isVideo = av_frame->height > 0 && av_frame->width > 0;
+    if (isVideo) {
+        auto format = layoutPixelFormat(layout, (AVPixelFormat)av_frame->format);
+        int linesizes[4];
+        layoutLinesizes(linesizes, format, av_frame->width, stride);
+        uint8_t* data[4];
+        return av_image_fill_pointers(data, format, av_frame->height, NULL, linesizes);
+    }
+    auto format = layoutSampleFormat(layout, (AVSampleFormat)av_frame->format);
+    return av_samples_get_buffer_size(NULL, av_frame->channels, av_frame->nb_samples, format, 1);
+}
+
+
+int Frame::copyTo(uintptr_t dest, std::string layout, int stride) {
+    auto isVideo = av_frame->height > 0 && av_frame->width > 0;
+    auto dst = (uint8_t*)dest;
+    CHECK(dst != NULL, "Frame::copyTo: empty destination");
+
+    if (isVideo) {
+        auto src_format = (AVPixelFormat)av_frame->format;
+        auto format = layoutPixelFormat(layout, src_format);
+        int linesizes[4];
+        uint8_t* data[4];
+        layoutLinesizes(linesizes, format, av_frame->width, stride);
+        auto size = av_image_fill_pointers(data, format, av_frame->height, dst, linesizes);
+        CHECK(size >= 0, "Frame::copyTo: failed to fill video planes");
+        if (format == src_format) {
+            av_image_copy(data, linesizes, (const uint8_t**)av_frame->data, av_frame->linesize, 
+                format, av_frame->width, av_frame->height);
+        }
+        else {
+            // same size, only pixel format conversion (context reused across frames)
+            thread_local SwsContext* sws_ctx = NULL;
+            sws_ctx = sws_getCachedContext(sws_ctx, 
+                av_frame->width, av_frame->height, src_format,
+                av_frame->width, av_frame->height, format, SWS_BILINEAR, NULL, NULL, NULL);
+            CHECK(sws_ctx != NULL, "Frame::copyTo: cannot convert pixel format");
+            sws_scale(sws_ctx, av_frame->data, av_frame->linesize, 0, av_frame->height, data, linesizes);
+        }
+        return size;
+    }
+
+    auto src_format = (AVSampleFormat)av_frame->format;
+    auto format = layoutSampleFormat(layout, src_format);
+    auto planar = av_sample_fmt_is_planar(format);
+    std::vector<uint8_t*> planes(planar ? av_frame->channels : 1);
+    int linesize = 0;
+    auto size = av_samples_fill_arrays(
+        planes.data(), &linesize, dst, av_frame->channels, av_frame->nb_samples, format, 1);
+    CHECK(size >= 0, "Frame::copyTo: failed to fill audio planes");
+    if (format == src_format) {
+        av_samples_copy(planes.data(), av_frame->extended_data, 0, 0, 
+            av_frame->nb_samples, av_frame->channels, format);
+    }
+    else {
+        // same sample rate, only (de)interleave and sample format conversion
+        thread_local SwrContext* swr_ctx = NULL;
+        thread_local int64_t swr_key[4] = {0};
+        auto channel_layout = av_frame->channel_layout ? 
+            av_frame->channel_layout : av_get_default_channel_layout(av_frame->channels);
+        int64_t key[4] = {(int64_t)channel_layout, av_frame->sample_rate, src_format, format};
+        if (swr_ctx == NULL || memcmp(key, swr_key, sizeof(key)) != 0) {
+            swr_free(&swr_ctx);
+            swr_ctx = swr_alloc_set_opts(NULL, 
+                channel_layout, format, av_frame->sample_rate,
+                channel_layout, src_format, av_frame->sample_rate, 0, NULL);
+            CHECK(swr_ctx != NULL && swr_init(swr_ctx) >= 0, "Frame::copyTo: cannot convert sample format");
+            memcpy(swr_key, key, sizeof(key));
+        }
+        auto ret = swr_convert(swr_ctx, planes.data(), av_frame->nb_samples, 
+            (const uint8_t**)av_frame->extended_data, av_frame->nb_samples);
+        CHECK(ret == av_frame->nb_samples, "Frame::copyTo: failed to convert samples");
+    }
+    return size;
+}
+
 void AudioFrameFIFO::push(Frame* in_frame) {
     auto num_sample = in_frame->av_ptr()->nb_samples;
     auto fifo_size = this->size() + num_sample;
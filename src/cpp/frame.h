@@ -2,7 +2,9 @@
 #define FRAME_H
 
 #include <cstdio>
+#ifdef __EMSCRIPTEN__
 #include <emscripten/val.h>
+#endif
 extern "C" {
     #include <libavcodec/avcodec.h>
     #include <libavutil/frame.h>
@@ -13,7 +15,10 @@ extern "C" {
 }
 
 #include "utils.h"
+#include "buffer_pool.h"
+#ifdef __EMSCRIPTEN__
 using namespace emscripten;
+#endif
 
 
 struct FrameInfo {
@@ -52,7 +57,19 @@ public:
     }
 
     void audio_reinit(AVSampleFormat sample_fmt, int sample_rate, uint64_t channel_layout, int nb_samples);
+
+    /**
+     * Copy data into `dest` in one pass (converted if layout differs from frame format).
+     * layout: "" (frame format), I420/NV12/RGBA (video), f32/s16 (interleaved audio),
+     *  or any FFmpeg pixel/sample format name.
+     * stride: bytes per row of the first video plane (0 for tightly packed), others scaled.
+     *  Planes are contiguous; planar audio planes are contiguous without padding.
+     * return number of bytes written (same as copySize).
+     */
+    int copySize(std::string layout, int stride);
+    int copyTo(uintptr_t dest, std::string layout, int stride);
     
+#ifdef __EMSCRIPTEN__
     std::vector<emscripten::val> getPlanes() {
         std::vector<emscripten::val> data;
         auto isVideo = av_frame->height > 0 && av_frame->width > 0;
@@ -84,6 +101,7 @@ public:
         
         return data;
     }
+#endif
 
     void dump() {
         auto& time_base = av_frame->time_base;
@@ -0,0 +1,243 @@
+#include "frame_cache.h"
+#include <algorithm>
+extern "C" {
+    #include <libavutil/imgutils.h>
+}
+
+/* a request this far (microseconds) after the last decoded frame keeps decoding instead of seeking */
+static const int64_t CONTINUE_DISTANCE = 2 * AV_TIME_BASE;
+
+
+FrameCache::FrameCache(Demuxer* demuxer, FrameCacheOptions options) {
+    this->demuxer = demuxer;
+    this->options = options;
+}
+
+
+FrameCache::~FrameCache() {
+    clear();
+    for (auto& [_, decoder] : decoders) delete decoder;
+    if (sws_ctx) sws_freeContext(sws_ctx);
+}
+
+
+Decoder* FrameCache::decoder(int stream_index) {
+    auto it = decoders.find(stream_index);
+    if (it != decoders.end()) return it->second;
+    CHECK(demuxer->av_stream(stream_index)->codecpar->codec_type == AVMEDIA_TYPE_VIDEO, 
+        "FrameCache: only video stream");
+    auto decoder = new Decoder(demuxer, stream_index, "cache");
+    decoders[stream_index] = decoder;
+    return decoder;
+}
+
+
+FrameCache::Entry* FrameCache::find(int stream_index, int64_t pts) {
+    auto s = entries.find(stream_index);
+    if (s == entries.end()) return NULL;
+    auto it = s->second.upper_bound(pts);
+    if (it == s->second.begin()) return NULL;
+    --it;
+    return pts < it->second.end ? &it->second : NULL;
+}
+
+
+/* first time in [from, to) not covered by cached frames, AV_NOPTS_VALUE if none */
+int64_t FrameCache::firstGap(int stream_index, int64_t from, int64_t to) {
+    auto pos = from;
+    while (pos < to) {
+        auto entry = find(stream_index, pos);
+        if (entry == NULL) return pos;
+        pos = entry->end;
+    }
+    return AV_NOPTS_VALUE;
+}
+
+
+void FrameCache::seek(int stream_index, int64_t pts) {
+    auto dec = decoder(stream_index);
+    demuxer->seek(av_rescale_q(pts, AV_TIME_BASE_Q, demuxer->getTimeBase(stream_index)), stream_index);
+    dec->flushBuffers();
+    cur_stream = stream_index;
+    run_start = pts;
+    cur_pts = AV_NOPTS_VALUE;
+}
+
+
+/* whether decoding forward from current position reaches pts soon (without seeking) */
+bool FrameCache::reaches(int stream_index, int64_t pts) {
+    if (cur_stream != stream_index || pts < run_start) return false;
+    return cur_pts == AV_NOPTS_VALUE || (pts > cur_pts && pts - cur_pts <= CONTINUE_DISTANCE);
+}
+
+
+void FrameCache::evict(int stream_index, int64_t pts) {
+    auto& frames = entries[stream_index];
+    auto it = frames.find(pts);
+    bytes -= it->second.bytes;
+    av_frame_free(&it->second.frame);
+    lru.erase(it->second.lru);
+    frames.erase(it);
+}
+
+
+/**
+ * Cache a frame of current stream, scaled down if needed. Return false when it doesn't fit in budget
+ * without evicting frames around the last requested one (prefetch only).
+ */
+bool FrameCache::insert(Frame* frame, bool prefetching) {
+    auto pts = frame->pts();
+    if (pts == AV_NOPTS_VALUE) return true;
+    auto& frames = entries[cur_stream];
+    // previous decoded frame lasts until this one
+    if (cur_pts != AV_NOPTS_VALUE && cur_pts < pts) {
+        auto prev = frames.find(cur_pts);
+        if (prev != frames.end()) prev->second.end = pts;
+    }
+    cur_pts = pts;
+    if (frames.count(pts) > 0) return true;
+
+    auto f = frame->av_ptr();
+    auto width = f->width, height = f->height;
+    if (options.max_width > 0 && options.max_height > 0 && (width > options.max_width || height > options.max_height)) {
+        auto scale = std::min(options.max_width / (double)width, options.max_height / (double)height);
+        width = std::max(2, (int)(width * scale) & ~1);
+        height = std::max(2, (int)(height * scale) & ~1);
+    }
+    int64_t size = av_image_get_buffer_size((AVPixelFormat)f->format, width, height, 1);
+    auto window = (int64_t)(options.prefetch * AV_TIME_BASE);
+    while (bytes + size > options.budget && lru.size() > 0) {
+        auto [stream_index, oldest] = lru.back();
+        if (prefetching && stream_index == play_stream && oldest >= play_pts - window && oldest <= play_pts + window)
+            return false;
+        evict(stream_index, oldest);
+    }
+
+    AVFrame* stored;
+    if (width == f->width && height == f->height)
+        stored = av_frame_clone(f);
+    else {
+        sws_ctx = sws_getCachedContext(sws_ctx, f->width, f->height, (AVPixelFormat)f->format, 
+            width, height, (AVPixelFormat)f->format, SWS_FAST_BILINEAR, NULL, NULL, NULL);
+        CHECK(sws_ctx != NULL, "FrameCache: cannot create scaler");
+        stored = av_frame_alloc();
+        stored->width = width;
+        stored->height = height;
+        stored->format = f->format;
+        CHECK(av_frame_get_buffer(stored, 0) >= 0, "FrameCache: cannot allocate frame");
+        av_frame_copy_props(stored, f);
+        sws_scale(sws_ctx, f->data, f->linesize, 0, f->height, stored->data, stored->linesize);
+    }
+    CHECK(stored != NULL, "FrameCache: cannot reference frame");
+    // until next frame is decoded
+    auto duration = av_rescale_q(f->pkt_duration, decoders[cur_stream]->timeBase(), AV_TIME_BASE_Q);
+    lru.push_front({cur_stream, pts});
+    frames[pts] = { .frame = stored, .end = pts + std::max(duration, (int64_t)1), .bytes = size, .lru = lru.begin() };
+    bytes += size;
+    return true;
+}
+
+
+/**
+ * Read one packet, caching frames of current stream.
+ * Return false at end of file (position lost) or when prefetch is out of budget.
+ */
+bool FrameCache::decodeNext(bool prefetching, RemuxStatus& status) {
+    auto dec = decoders[cur_stream];
+    if (!demuxer->readInto(&packet)) {
+        for (auto frame : dec->flush()) {
+            insert(frame, false);
+            delete frame;
+        }
+        // last frame lasts forever
+        if (cur_pts != AV_NOPTS_VALUE) {
+            auto last = entries[cur_stream].find(cur_pts);
+            if (last != entries[cur_stream].end()) last->second.end = INT64_MAX;
+        }
+        cur_stream = -1;
+        return false;
+    }
+    status.packets++;
+    status.bytes += packet.size();
+    if (packet.stream_index() != cur_stream) return true;
+    auto fits = true;
+    for (auto frame : dec->decode(&packet)) {
+        fits = fits && insert(frame, prefetching);
+        delete frame;
+    }
+    // frames not cached are decoded anyway, seek again to get them
+    if (!fits) cur_stream = -1;
+    return fits;
+}
+
+
+Frame* FrameCache::get(int stream_index, double time) {
+    int64_t pts = time * AV_TIME_BASE;
+    play_stream = stream_index;
+    play_pts = pts;
+    auto entry = find(stream_index, pts);
+    if (entry != NULL)
+        hits++;
+    else {
+        misses++;
+        if (!reaches(stream_index, pts))
+            seek(stream_index, pts);
+        RemuxStatus status = {};
+        while ((entry = find(stream_index, pts)) == NULL && (cur_pts == AV_NOPTS_VALUE || cur_pts <= pts)) {
+            if (!decodeNext(false, status)) break;
+        }
+        entry = find(stream_index, pts);
+    }
+    if (entry == NULL) {
+        // before first frame (or not decodable): nearest one
+        auto& frames = entries[stream_index];
+        if (frames.size() == 0) return NULL;
+        auto it = frames.lower_bound(pts);
+        if (it == frames.end()) --it;
+        entry = &it->second;
+    }
+    lru.splice(lru.begin(), lru, entry->lru);
+    auto frame = new Frame();
+    av_frame_ref(frame->av_ptr(), entry->frame);
+    return frame;
+}
+
+
+RemuxStatus FrameCache::prefetch(int max_packets) {
+    RemuxStatus status = {.packets = 0, .bytes = 0, .end = true, .throttled = false};
+    auto window = (int64_t)(options.prefetch * AV_TIME_BASE);
+    while (play_stream >= 0) {
+        // frames after the playhead first, then before it
+        auto gap = firstGap(play_stream, play_pts, play_pts + window);
+        if (gap == AV_NOPTS_VALUE)
+            gap = firstGap(play_stream, std::max(play_pts - window, (int64_t)0), play_pts);
+        if (gap == AV_NOPTS_VALUE) break;
+        if (status.packets >= max_packets) {
+            status.end = false;
+            break;
+        }
+        if (!reaches(play_stream, gap)) {
+            // decoded past it since seeking before it: no frame there
+            if (cur_stream == play_stream && run_start <= gap && cur_pts != AV_NOPTS_VALUE && gap <= cur_pts) break;
+            seek(play_stream, gap);
+        }
+        // end of file, or out of budget
+        if (!decodeNext(true, status)) break;
+    }
+    return status;
+}
+
+
+void FrameCache::clear() {
+    for (auto& stream : entries)
+        for (auto& it : stream.second)
+            av_frame_free(&it.second.frame);
+    entries.clear();
+    lru.clear();
+    bytes = 0;
+}
+
+
+FrameCacheInfo FrameCache::getInfo() const {
+    return { .frames = (int)lru.size(), .bytes = (double)bytes, .hits = hits, .misses = misses };
+}
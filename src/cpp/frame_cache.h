@@ -0,0 +1,93 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <list>
+#include <map>
+extern "C" {
+    #include <libswscale/swscale.h>
+}
+
+#include "packet.h"
+#include "frame.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "remuxer.h"
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * budget: bytes of cached frames, least recently used ones evicted above it
+ * max_width/max_height: frames stored scaled down to fit in (0 keeps original size)
+ * prefetch: seconds before and after the last requested frame decoded by `prefetch`
+ */
+struct FrameCacheOptions {
+    double budget;
+    int max_width;
+    int max_height;
+    double prefetch;
+};
+
+struct FrameCacheInfo {
+    int frames;
+    double bytes;
+    double hits;
+    double misses;
+};
+
+
+/**
+ * Decoded video frames of a Demuxer (owned by caller), keyed by stream and pts, for random access (scrubbing).
+ * A miss seeks to the previous key frame and decodes up to the requested time, caching every frame on the way,
+ * or keeps decoding without seeking when the time is shortly after the last decoded frame.
+ * Frames cover [pts, next frame pts), so any time inside a cached interval is a hit.
+ */
+class FrameCache {
+    struct Entry {
+        AVFrame* frame;
+        int64_t end;        // pts of next frame (INT64_MAX for last one)
+        int64_t bytes;
+        list<pair<int, int64_t>>::iterator lru;
+    };
+    Demuxer* demuxer;
+    FrameCacheOptions options;
+    map<int, Decoder*> decoders;
+    map<int, map<int64_t, Entry>> entries;
+    list<pair<int, int64_t>> lru;   // (stream, pts), most recent first
+    int64_t bytes = 0;
+    double hits = 0;
+    double misses = 0;
+    SwsContext* sws_ctx = NULL;
+    Packet packet;
+    // decoding position (after a seek)
+    int cur_stream = -1;
+    int64_t run_start = AV_NOPTS_VALUE;    // seeked time
+    int64_t cur_pts = AV_NOPTS_VALUE;      // last decoded frame
+    // last requested frame
+    int play_stream = -1;
+    int64_t play_pts = AV_NOPTS_VALUE;
+
+    Decoder* decoder(int stream_index);
+    Entry* find(int stream_index, int64_t pts);
+    int64_t firstGap(int stream_index, int64_t from, int64_t to);
+    void seek(int stream_index, int64_t pts);
+    bool reaches(int stream_index, int64_t pts);
+    bool decodeNext(bool prefetching, RemuxStatus& status);
+    bool insert(Frame* frame, bool prefetching);
+    void evict(int stream_index, int64_t pts);
+
+public:
+    FrameCache(Demuxer* demuxer, FrameCacheOptions options);
+    ~FrameCache();
+
+    /* async, frame shown at `time` (seconds), NULL if the stream has no frame */
+    Frame* get(int stream_index, double time);
+    bool has(int stream_index, double time) { return find(stream_index, time * AV_TIME_BASE) != NULL; }
+    /* async, idle work: decode at most max_packets packets around the last requested frame, end when done */
+    RemuxStatus prefetch(int max_packets);
+    void clear();
+    FrameCacheInfo getInfo() const;
+};
+
+
+#endif
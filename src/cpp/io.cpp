@@ -0,0 +1,56 @@
+#include "io.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+
+
+#ifdef __EMSCRIPTEN__
+using namespace emscripten;
+
+int ValReader::read(uint8_t* buf, int buf_size) {
+    auto data = val(typed_memory_view(buf_size, buf));
+    return reader.call<val>("read", data).await().as<int>();
+}
+
+void ValReader::seek(int64_t pos) {
+    reader.call<val>("seek", (double)pos).await();
+}
+
+void ValWriter::write(uint8_t* buf, int buf_size) {
+    auto data = val(typed_memory_view(buf_size, buf));
+    writer.call<void>("write", data);
+}
+#endif
+
+
+FileReader::FileReader(std::string path) {
+    fd = open(path.c_str(), O_RDONLY);
+    CHECK(fd >= 0, "Could not open input file");
+    struct stat st;
+    CHECK(fstat(fd, &st) == 0, "Could not get size of input file");
+    file_size = st.st_size;
+}
+
+int FileReader::read(uint8_t* buf, int buf_size) {
+    auto n = pread(fd, buf, buf_size, pos);
+    if (n <= 0) return 0;
+    pos += n;
+    return n;
+}
+
+
+FileWriter::FileWriter(std::string path) {
+    if (path.length() > 0) {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        CHECK(fd >= 0, "Could not open output file");
+    }
+}
+
+void FileWriter::write(uint8_t* buf, int buf_size) {
+    // muxers seek back to patch headers (e.g. mp4 moov size), so always write at pos
+    for (int written = 0; fd >= 0 && written < buf_size; ) {
+        auto n = pwrite(fd, buf + written, buf_size - written, pos + written);
+        CHECK(n > 0, "Could not write output file");
+        written += n;
+    }
+    pos += buf_size;
+}
@@ -0,0 +1,95 @@
+#ifndef IO_H
+#define IO_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten/val.h>
+#endif
+
+#include "utils.h"
+
+
+/**
+ * Input of Demuxer.
+ * Warning: JS reader is async, so any function involving read/seek may give promise.
+ */
+class InputIO {
+public:
+    virtual ~InputIO() {}
+    /* bytes read, 0 at end of file */
+    virtual int read(uint8_t* buf, int buf_size) = 0;
+    virtual void seek(int64_t pos) = 0;
+    /* total size, <= 0 if unknown (then not seekable) */
+    virtual int64_t size() = 0;
+    virtual int64_t offset() = 0;
+};
+
+
+/* Output of Muxer */
+class OutputIO {
+public:
+    virtual ~OutputIO() {}
+    virtual void write(uint8_t* buf, int buf_size) = 0;
+    virtual void seek(int64_t pos) = 0;
+    virtual int64_t offset() = 0;
+};
+
+
+#ifdef __EMSCRIPTEN__
+/* JS reader: { size, offset, read(Uint8Array) => Promise<number>, seek(pos) => Promise<void> } */
+class ValReader : public InputIO {
+    emscripten::val reader;
+public:
+    ValReader(emscripten::val _reader) { reader = std::move(_reader); }
+    int read(uint8_t* buf, int buf_size) override;
+    void seek(int64_t pos) override;
+    int64_t size() override { return (int64_t)reader["size"].as<double>(); }
+    int64_t offset() override { return (int64_t)reader["offset"].as<double>(); }
+};
+
+/* JS writer: { offset, write(Uint8Array), seek(pos) } */
+class ValWriter : public OutputIO {
+    emscripten::val writer;
+public:
+    ValWriter(emscripten::val _writer) { writer = std::move(_writer); }
+    void write(uint8_t* buf, int buf_size) override;
+    void seek(int64_t pos) override { writer.call<emscripten::val>("seek", (double)pos); }
+    int64_t offset() override { return (int64_t)writer["offset"].as<double>(); }
+};
+#endif
+
+
+/**
+ * Local file by positioned reads (pread) into AVIO buffer, no JS in the loop.
+ * Native build, or Node build (NODERAWFS: host files directly).
+ */
+class FileReader : public InputIO {
+    int fd;
+    int64_t file_size = 0;
+    int64_t pos = 0;
+public:
+    FileReader(std::string path);
+    ~FileReader() { close(fd); }
+    int read(uint8_t* buf, int buf_size) override;
+    void seek(int64_t pos) override { this->pos = pos; }
+    int64_t size() override { return file_size; }
+    int64_t offset() override { return pos; }
+};
+
+/* local file by positioned writes (pwrite), or discard all data if path is empty (benchmark) */
+class FileWriter : public OutputIO {
+    int fd = -1;
+    int64_t pos = 0;
+public:
+    FileWriter(std::string path);
+    ~FileWriter() { if (fd >= 0) close(fd); }
+    void write(uint8_t* buf, int buf_size) override;
+    void seek(int64_t pos) override { this->pos = pos; }
+    int64_t offset() override { return pos; }
+};
+
+
+#endif
@@ -0,0 +1,54 @@
+#include <cstring>
+#include "live.h"
+
+
+static LiveProfile profile = {
+    .enabled = false,
+    .probesize = 32768,
+    .analyze_duration = 0.5,
+    .interleave_delta = 0.1,
+};
+
+void setLiveProfile(LiveProfile _profile) { profile = _profile; }
+
+LiveProfile getLiveProfile() { return profile; }
+
+
+void applyLiveDemuxer(AVFormatContext* format_ctx) {
+    if (!profile.enabled) return;
+    format_ctx->flags |= AVFMT_FLAG_NOBUFFER;
+    format_ctx->probesize = FFMAX(profile.probesize, 32);
+    format_ctx->max_analyze_duration = (int64_t)(profile.analyze_duration * AV_TIME_BASE);
+    format_ctx->fps_probe_size = 0;
+}
+
+
+void applyLiveDecoder(AVCodecContext* codec_ctx) {
+    if (!profile.enabled) return;
+    codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    codec_ctx->thread_type = FF_THREAD_SLICE;
+}
+
+
+void applyLiveEncoder(AVCodecContext* codec_ctx, AVDictionary** options) {
+    if (!profile.enabled) return;
+    codec_ctx->max_b_frames = 0;
+    codec_ctx->thread_type = FF_THREAD_SLICE;
+    // private options, only given to their encoder (libvpx `tune` only accepts psnr/ssim)
+    auto name = codec_ctx->codec != NULL ? codec_ctx->codec->name : "";
+    if (strcmp(name, "libx264") == 0)
+        av_dict_set(options, "tune", "zerolatency", 0);     // no lookahead, no frame threads
+    else if (strcmp(name, "libvpx") == 0 || strcmp(name, "libvpx-vp9") == 0) {
+        av_dict_set(options, "deadline", "realtime", 0);
+        av_dict_set(options, "lag-in-frames", "0", 0);
+    }
+}
+
+
+void applyLiveMuxer(AVFormatContext* format_ctx, AVDictionary** options) {
+    if (!profile.enabled) return;
+    format_ctx->flush_packets = 1;
+    format_ctx->max_interleave_delta = FFMAX((int64_t)(profile.interleave_delta * AV_TIME_BASE), 1); // 0 is unbounded
+    // moov at the end cannot be streamed
+    av_dict_set(options, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+}
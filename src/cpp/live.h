@@ -0,0 +1,37 @@
+#ifndef LIVE_H
+#define LIVE_H
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libavutil/dict.h>
+}
+
+
+/**
+ * Low-latency profile for live capture-to-stream, applied to Demuxer/Decoder/Encoder/Muxer created afterwards.
+ * - Demuxer: no packet buffering, probe only `probesize` bytes / `analyze_duration` seconds
+ * - Decoder: low_delay, slice threads only (frame threads add one frame of delay per thread)
+ * - Encoder: no B-frames, zerolatency (x264) / realtime (vpx), slice threads only
+ * - Muxer: packets written directly (single stream) or interleaved within `interleave_delta` seconds,
+ *   io flushed after each packet, fragmented mp4/mov
+ */
+struct LiveProfile {
+    bool enabled;
+    int probesize;              // bytes
+    double analyze_duration;    // seconds
+    double interleave_delta;    // seconds
+};
+
+void setLiveProfile(LiveProfile profile);
+LiveProfile getLiveProfile();
+inline bool liveEnabled() { return getLiveProfile().enabled; }
+
+// only for c++ (no-op when not enabled)
+void applyLiveDemuxer(AVFormatContext* format_ctx);
+void applyLiveDecoder(AVCodecContext* codec_ctx);
+void applyLiveEncoder(AVCodecContext* codec_ctx, AVDictionary** options);
+void applyLiveMuxer(AVFormatContext* format_ctx, AVDictionary** options);
+
+
+#endif
@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include "log.h"
+#include "stats.h"
+
+
+static LogRing ring;
+// read by log_callback on any thread without locking: replaced as a whole (copy on write), never modified
+static shared_ptr<const map<string, int>> category_levels;
+static int rate_limit = 10;
+// FFmpeg logs from any thread (Pipeline stages, codec threads), the ring has one producer at a time
+static std::mutex log_mutex;
+
+
+/* per format string counter in current 1 second window */
+struct RateSlot {
+    const char* fmt;
+    double window_start;
+    int count;
+    int suppressed;
+};
+static const int rate_slots_size = 64;
+static RateSlot rate_slots[rate_slots_size];
+
+/* return false if suppressed, otherwise set number of suppressed messages before it */
+static bool rate_check(const char* fmt, int& repeats) {
+    repeats = 0;
+    if (rate_limit <= 0) return true;
+    auto& slot = rate_slots[((uintptr_t)fmt >> 3) % rate_slots_size];
+    auto now = stats_now();
+    if (slot.fmt != fmt || now - slot.window_start >= 1000) {
+        repeats = slot.fmt == fmt ? slot.suppressed : 0;
+        slot = {.fmt = fmt, .window_start = now, .count = 0, .suppressed = 0};
+    }
+    if (slot.count >= rate_limit) {
+        slot.suppressed++;
+        return false;
+    }
+    slot.count++;
+    return true;
+}
+
+
+static const char* category_name(void* ptr) {
+    auto avc = ptr ? *(AVClass**)ptr : NULL;
+    return avc ? avc->item_name(ptr) : "";
+}
+
+
+static void log_callback(void *ptr, int level, const char *fmt, va_list vl) {
+    // filter before any formatting
+    auto category = category_name(ptr);
+    auto max_level = av_log_get_level();
+    auto levels = atomic_load(&category_levels);
+    if (levels != NULL) {
+        auto it = levels->find(category);
+        if (it != levels->end()) max_level = it->second;
+    }
+    if (level > max_level) return;
+    std::lock_guard<std::mutex> lock(log_mutex);
+    int repeats;
+    if (!rate_check(fmt, repeats)) return;
+
+    static int print_prefix = 1;
+#ifdef __EMSCRIPTEN__
+    auto slot = ring.acquire();
+    if (slot == NULL) return;
+    slot->level = level;
+    slot->repeats = repeats;
+    strncpy(slot->category, category, sizeof(slot->category) - 1);
+    slot->category[sizeof(slot->category) - 1] = '\0';
+    av_log_format_line(ptr, level, fmt, vl, slot->line, sizeof(slot->line), &print_prefix);
+    ring.commit();
+#else
+    char line[1024];
+    av_log_format_line(ptr, level, fmt, vl, line, sizeof(line), &print_prefix);
+    if (repeats > 0) fprintf(stderr, "(last message repeated %d times)\n", repeats);
+    fputs(line, stderr);
+#endif
+}
+
+
+void LogRing::drain(vector<LogEntry>& entries) {
+    auto t = tail.load(memory_order_relaxed);
+    auto h = head.load(memory_order_acquire);
+    for (; t != h; t++) {
+        auto& slot = slots[t % capacity];
+        entries.push_back({
+            .level = slot.level, 
+            .category = slot.category, 
+            .message = slot.line, 
+            .repeats = slot.repeats});
+    }
+    tail.store(t, memory_order_release);
+}
+
+
+void setConsoleLogger(bool verbose) {
+    av_log_set_level(verbose ? AV_LOG_VERBOSE : AV_LOG_INFO);
+    av_log_set_callback(log_callback);
+}
+
+void setLogLevel(string category, int level) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    auto levels = make_shared<map<string, int>>();
+    if (category_levels != NULL) *levels = *category_levels;
+    (*levels)[category] = level;
+    atomic_store(&category_levels, shared_ptr<const map<string, int>>(levels));
+}
+
+void setLogRateLimit(int per_second) {
+    rate_limit = per_second;
+}
+
+vector<LogEntry> drainLogs() {
+    vector<LogEntry> entries;
+    ring.drain(entries);
+    auto dropped = ring.takeDropped();
+    if (dropped > 0)
+        entries.push_back({
+            .level = AV_LOG_WARNING, 
+            .category = "log", 
+            .message = to_string(dropped) + " log messages dropped (buffer full)\n", 
+            .repeats = 0});
+    
+    return entries;
+}
@@ -0,0 +1,71 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+extern "C" {
+    #include <libavutil/log.h>
+}
+using namespace std;
+
+
+struct LogEntry {
+    int level;
+    string category; // AVClass name (e.g. h264, mov,mp4,m4a,3gp,3g2,mj2)
+    string message;
+    int repeats;     // number of same messages suppressed before this one
+};
+
+
+/**
+ * Fixed-size single producer (av_log) / single consumer (drainLogs) ring.
+ * FFmpeg logs from any thread, so producers are serialised by a mutex (taken after level filtering);
+ * only the consumer side is lock-free.
+ * Messages are filtered by level before formatting, and repeated messages
+ * (same format string) are rate limited per second.
+ */
+class LogRing {
+    static const int capacity = 256;
+    static const int line_size = 256;
+    static const int category_size = 32;
+    struct Slot {
+        int level;
+        int repeats;
+        char category[category_size];
+        char line[line_size];
+    };
+    Slot slots[capacity];
+    atomic<uint32_t> head {0}; // next write
+    atomic<uint32_t> tail {0}; // next read
+    atomic<uint32_t> dropped {0};
+
+public:
+    /* reserve a slot to write, NULL if full */
+    Slot* acquire() {
+        auto h = head.load(memory_order_relaxed);
+        if (h - tail.load(memory_order_acquire) >= capacity) {
+            dropped.fetch_add(1, memory_order_relaxed);
+            return NULL;
+        }
+        return &slots[h % capacity];
+    }
+    void commit() { head.fetch_add(1, memory_order_release); }
+    void drain(vector<LogEntry>& entries);
+    /* number of messages dropped since last drain because ring is full */
+    uint32_t takeDropped() { return dropped.exchange(0, memory_order_relaxed); }
+};
+
+
+/* buffer FFmpeg logs into the ring (drained by JS), level of `verbose` or info */
+void setConsoleLogger(bool verbose);
+/* level of a category (AVClass name), overrides global level */
+void setLogLevel(string category, int level);
+/* max messages of the same format string per second (0 is unlimited) */
+void setLogRateLimit(int per_second);
+/* take all buffered messages */
+vector<LogEntry> drainLogs();
+
+
+#endif
@@ -0,0 +1,170 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten/heap.h>
+#endif
+#include "memory.h"
+
+
+static MemoryAccount total;
+static thread_local MemoryAccount* current_account = NULL;
+static MemoryBudget budget = {.heap = 0, .io_buffer = 32*1024, .interleave_delta = 0};
+
+
+void MemoryAccount::add(int64_t size) {
+    refs.fetch_add(1, std::memory_order_relaxed);
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    resize(size);
+}
+
+void MemoryAccount::resize(int64_t delta) {
+    auto now = current.fetch_add(delta, std::memory_order_relaxed) + delta;
+    auto high = high_water.load(std::memory_order_relaxed);
+    while (now > high && !high_water.compare_exchange_weak(high, now, std::memory_order_relaxed));
+}
+
+void MemoryAccount::sub(int64_t size) {
+    current.fetch_sub(size, std::memory_order_relaxed);
+    release();
+}
+
+/* owner and frees may run on different threads (pipeline stages), a single count decides who deletes */
+void MemoryAccount::release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
+void MemoryAccount::detach() { release(); }
+
+MemoryInfo MemoryAccount::info() const {
+    return {
+        .current = (double)current.load(), 
+        .high_water = (double)high_water.load(), 
+        .allocs = (double)allocs.load(), 
+        .heap_size = 0};
+}
+
+
+MemoryScope::MemoryScope(MemoryAccount* account) {
+    prev = current_account;
+    current_account = account;
+}
+
+MemoryScope::~MemoryScope() {
+    current_account = prev;
+}
+
+
+void setMemoryBudget(MemoryBudget _budget) { budget = _budget; }
+
+MemoryBudget getMemoryBudget() { return budget; }
+
+bool overMemoryBudget() {
+    return budget.heap > 0 && total.info().current > budget.heap;
+}
+
+MemoryInfo getMemoryInfo() {
+    auto info = total.info();
+#ifdef __EMSCRIPTEN__
+    info.heap_size = emscripten_get_heap_size();
+#endif
+    return info;
+}
+
+
+/**
+ * Replace the allocator (emscripten exports it as weak symbols), forward to the builtin dlmalloc.
+ * Each block has a header before the returned pointer, recording its size and account.
+ * Not used in native build, which keeps the system allocator.
+ */
+#if defined(__EMSCRIPTEN__) && !defined(NO_MEMORY_HOOKS)
+
+struct BlockHeader {
+    void* base;
+    MemoryAccount* account;
+    size_t size;
+};
+static const size_t min_align = 16;
+static_assert(sizeof(BlockHeader) <= min_align, "header should fit in minimal alignment");
+
+static inline BlockHeader* header_of(void* ptr) {
+    return reinterpret_cast<BlockHeader*>((uint8_t*)ptr - sizeof(BlockHeader));
+}
+
+static void* tracked_alloc(size_t align, size_t size) {
+    align = align < min_align ? min_align : align;
+    auto base = emscripten_builtin_memalign(align, size + align);
+    if (base == NULL) return NULL;
+    auto ptr = (uint8_t*)base + align;
+    *header_of(ptr) = {.base = base, .account = current_account, .size = size};
+    total.add(size);
+    if (current_account != NULL)
+        current_account->add(size);
+    return ptr;
+}
+
+static void tracked_free(void* ptr) {
+    if (ptr == NULL) return;
+    auto header = *header_of(ptr);
+    total.sub(header.size);
+    if (header.account != NULL)
+        header.account->sub(header.size);
+    emscripten_builtin_free(header.base);
+}
+
+extern "C" {
+
+void* malloc(size_t size) { return tracked_alloc(min_align, size); }
+
+void free(void* ptr) { tracked_free(ptr); }
+
+void* calloc(size_t n, size_t size) {
+    if (size > 0 && n > SIZE_MAX / size) return NULL;
+    auto ptr = tracked_alloc(min_align, n * size);
+    if (ptr != NULL) memset(ptr, 0, n * size);
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (ptr == NULL) return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    auto header = *header_of(ptr);
+    // blocks of minimal alignment are resized by dlmalloc (in place when it can, which aligns to 16),
+    // keeping their account
+    if ((uint8_t*)ptr - (uint8_t*)header.base == min_align) {
+        auto base = emscripten_builtin_realloc(header.base, size + min_align);
+        if (base == NULL) return NULL;
+        auto new_ptr = (uint8_t*)base + min_align;
+        *header_of(new_ptr) = {.base = base, .account = header.account, .size = size};
+        auto delta = (int64_t)size - (int64_t)header.size;
+        total.resize(delta);
+        if (header.account != NULL)
+            header.account->resize(delta);
+        return new_ptr;
+    }
+    auto new_ptr = tracked_alloc(min_align, size);
+    if (new_ptr == NULL) return NULL;
+    memcpy(new_ptr, ptr, header.size < size ? header.size : size);
+    tracked_free(ptr);
+    return new_ptr;
+}
+
+void* memalign(size_t align, size_t size) { return tracked_alloc(align, size); }
+
+void* aligned_alloc(size_t align, size_t size) { return tracked_alloc(align, size); }
+
+int posix_memalign(void** ptr, size_t align, size_t size) {
+    *ptr = tracked_alloc(align, size);
+    return *ptr != NULL ? 0 : ENOMEM;
+}
+
+size_t malloc_usable_size(void* ptr) { return ptr != NULL ? header_of(ptr)->size : 0; }
+
+}
+
+#endif
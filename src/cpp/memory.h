@@ -0,0 +1,70 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+
+/* bytes use double (otherwise int64_t will become int32) */
+struct MemoryInfo {
+    double current;     // bytes allocated and not freed yet
+    double high_water;  // max of current
+    double allocs;      // number of allocations
+    double heap_size;   // size of wasm memory (never shrinks), only for global info
+};
+
+
+/**
+ * Allocations (malloc/av_malloc...) made inside a MemoryScope are attributed to its account,
+ * until freed (wherever they are freed).
+ * Account of an object is detached when the object is deleted, 
+ * and released when all its allocations are freed.
+ */
+class MemoryAccount {
+    std::atomic<int64_t> current {0};
+    std::atomic<int64_t> high_water {0};
+    std::atomic<int64_t> allocs {0};
+    std::atomic<int64_t> refs {1};     // owner (until detach) + live allocations, released by the one dropping the last
+    void release();
+public:
+    void add(int64_t size);
+    void sub(int64_t size);
+    /* size of an allocation changed (realloc in place) */
+    void resize(int64_t delta);
+    void detach();
+    MemoryInfo info() const;
+};
+
+
+class MemoryScope {
+    MemoryAccount* prev;
+public:
+    MemoryScope(MemoryAccount* account);
+    ~MemoryScope();
+};
+
+
+/**
+ * Limits of memory usage. 
+ * Pipeline/Remuxer stop reading more packets in a call when over `heap`,
+ * after flushing muxers interleaving queues.
+ * There is no budget of audio FIFOs: Encoder drains its AudioFrameFIFO in each encode call, leaving
+ * less than one encoder frame, so it holds at most one input frame more (counted in `heap` as the
+ * encoder's allocations).
+ */
+struct MemoryBudget {
+    double heap;                // bytes of all allocations (0 is unlimited)
+    int io_buffer;              // AVIO buffer size of Demuxer/Muxer created afterwards
+    double interleave_delta;    // seconds buffered by muxer interleaving (0 is FFmpeg default)
+};
+
+void setMemoryBudget(MemoryBudget budget);
+MemoryBudget getMemoryBudget();
+bool overMemoryBudget();
+
+/* all allocations (attributed or not) */
+MemoryInfo getMemoryInfo();
+
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef METADATA_H
 #define METADATA_H
 
+#ifdef __EMSCRIPTEN__
 #include <emscripten/val.h>
+#endif
 #include <cstdio>
 #include <string>
 #include <vector>
@@ -30,7 +32,9 @@ struct StreamInfo {
     string codec_type;
     string codec_name;
     string format;
+#ifdef __EMSCRIPTEN__
     emscripten::val extraData;
+#endif
     // video
     int width;
     int height;
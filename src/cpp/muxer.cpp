@@ -4,22 +4,25 @@
 
 // Custom writing avio https://ffmpeg.org/pipermail/ffmpeg-devel/2014-November/165014.html
 static int write_packet(void* opaque, uint8_t* buf, int buf_size) {
-    auto writer = *reinterpret_cast<val*>(opaque);
-    auto data = val(typed_memory_view(buf_size, buf));
-    writer.call<void>("write", data);
+    auto muxer = reinterpret_cast<Muxer*>(opaque);
+    StatsTimer timer(muxer->mutableStats().io_time);
+    muxer->outputIO()->write(buf, buf_size);
+    muxer->mutableStats().bytes += buf_size;
     return buf_size;
     
 }
 
 static int64_t seek_for_write(void* opaque, int64_t pos, int whence) {
-    auto writer = *reinterpret_cast<val*>(opaque);
+    auto muxer = reinterpret_cast<Muxer*>(opaque);
+    StatsTimer timer(muxer->mutableStats().io_time);
+    auto io = muxer->outputIO();
 
     switch (whence) {
         case SEEK_SET:
-            writer.call<val>("seek", (double)pos); break;
+            io->seek(pos); break;
         case SEEK_CUR:
-            pos += (int64_t)writer["offset"].as<double>();
-            writer.call<val>("seek", (double)pos); break;
+            pos += io->offset();
+            io->seek(pos); break;
         default:
             CHECK(false, "cannot process seek_for_read");
     }
@@ -28,16 +31,23 @@ static int64_t seek_for_write(void* opaque, int64_t pos, int whence) {
 }
 
 
-Muxer::Muxer(string format, val _writer) {
-    writer = std::move(_writer); // writer will be destroyed at end of this function 
-    auto writerPtr = reinterpret_cast<void*>(&writer);
+Muxer::Muxer(string format, OutputIO* _io) {
+    MemoryScope scope(memory);
+    io = _io;
+    auto ioPtr = reinterpret_cast<void*>(this);
     // create buffer for writing
+    auto budget = getMemoryBudget();
+    auto buf_size = budget.io_buffer;
     auto buffer = (uint8_t*)av_malloc(buf_size);
-    io_ctx = avio_alloc_context(buffer, buf_size, 1, writerPtr, NULL, write_packet, seek_for_write);
+    io_ctx = avio_alloc_context(buffer, buf_size, 1, ioPtr, NULL, write_packet, seek_for_write);
     avformat_alloc_output_context2(&format_ctx, NULL, format.c_str(), NULL);
     CHECK(format_ctx != NULL, "Could not create output format context");
     format_ctx->pb = io_ctx;
     format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    if (budget.interleave_delta > 0)
+        format_ctx->max_interleave_delta = (int64_t)(budget.interleave_delta * AV_TIME_BASE);
+    live = liveEnabled();
+    applyLiveMuxer(format_ctx, &header_options);
 }
 
 
@@ -66,6 +76,7 @@ InferredFormatInfo Muxer::inferFormatInfo(string format_name, string filename) {
 
 
 void Muxer::writeFrame(Packet* packet, int stream_i) {
+    MemoryScope scope(memory);
     auto av_pkt = packet->av_packet();
     CHECK(stream_i >= 0 && stream_i < streams.size(), "stream_index of packet not in valid streams");
     auto av_stream = streams[stream_i]->av_stream_ptr();
@@ -73,6 +84,17 @@ void Muxer::writeFrame(Packet* packet, int stream_i) {
     av_packet_rescale_ts(av_pkt, AV_TIME_BASE_Q, av_stream->time_base);
     av_pkt->stream_index = stream_i;
     
-    int ret = av_interleaved_write_frame(format_ctx, av_pkt);
+    StatsTimer timer(stats.process_time);
+    LatencyTimer latency(stats);
+    int ret;
+    if (live && format_ctx->nb_streams == 1) {
+        // nothing to interleave, write (and flush) right away
+        ret = av_write_frame(format_ctx, av_pkt);
+        av_packet_unref(av_pkt);
+    }
+    else
+        ret = av_interleaved_write_frame(format_ctx, av_pkt);
     CHECK(ret >= 0, "interleave write frame error");
+    stats.calls++;
+    stats.packets++;
 }
\ No newline at end of file
@@ -1,7 +1,6 @@
 #ifndef MUXER_H
 #define MUXER_H
 
-#include <emscripten/val.h>
 #include <string>
 #include <vector>
 #include "stream.h"
@@ -15,7 +14,10 @@ extern "C" {
 
 #include "encode.h"
 #include "utils.h"
-using namespace emscripten;
+#include "io.h"
+#include "stats.h"
+#include "memory.h"
+#include "live.h"
 
 
 struct InferredStreamInfo {
@@ -35,11 +37,20 @@ class Muxer {
     AVFormatContext* format_ctx;
     AVIOContext* io_ctx;
     std::vector<Stream*> streams;
-    int buf_size = 32*1024;
-    val writer;
+    OutputIO* io;
+    bool live = false;
+    AVDictionary* header_options = NULL;
+    Stats stats = {};
+    MemoryAccount* memory = new MemoryAccount();
 
 public:
-    Muxer(string format, val _writer);
+#ifdef __EMSCRIPTEN__
+    Muxer(string format, emscripten::val _writer) : Muxer(format, new ValWriter(std::move(_writer))) {}
+#endif
+    /* take ownership of io */
+    Muxer(string format, OutputIO* _io);
+    /* host file written directly (native or Node build) */
+    static Muxer* toFile(string format, string path) { return new Muxer(format, new FileWriter(path)); }
     ~Muxer() {
         for (const auto& s : streams)
             delete s;
@@ -47,6 +58,9 @@ public:
         if (io_ctx)
             av_freep(&io_ctx->buffer);
         avio_context_free(&io_ctx);
+        delete io;
+        av_dict_free(&header_options);
+        memory->detach();
     }
 
     static InferredFormatInfo inferFormatInfo(string format_name, string filename);
@@ -57,6 +71,7 @@ public:
 
     // transmux
     void newStream(Demuxer* demuxer, int streamIndex) {
+        MemoryScope scope(memory);
         auto stream = demuxer->av_stream(streamIndex);
         streams.push_back(new Stream(format_ctx, stream));
     }
@@ -67,25 +82,55 @@ public:
         if (format_ctx->oformat->flags & AVFMT_GLOBALHEADER)
             encoder->setFlags(AV_CODEC_FLAG_GLOBAL_HEADER);
 
+        MemoryScope scope(memory);
         streams.push_back(new Stream(format_ctx, encoder));
     }
 
     // for not FF.encoder (e.g. WebCodecs encoder)
     void newStream(StreamInfo streamInfo) {
+        MemoryScope scope(memory);
         streams.push_back(new Stream(format_ctx, streamInfo));
     }
 
     void writeHeader() {
-        auto ret = avformat_write_header(format_ctx, NULL);
+        MemoryScope scope(memory);
+        StatsTimer timer(stats.process_time);
+        auto ret = avformat_write_header(format_ctx, &header_options);
         CHECK(ret >= 0, "Error occurred when opening output file");
     }
     void writeTrailer() { 
+        MemoryScope scope(memory);
+        StatsTimer timer(stats.process_time);
         auto ret = av_write_trailer(format_ctx); 
         CHECK(ret == 0, "Error when writing trailer");
     }
     void writeFrame(Packet* packet, int stream_i);
+    /* write packets of an encoder output ring in one call (no wrapper per packet in JS), return number written */
+    int writeRing(PacketRing* ring, int stream_i) {
+        auto n = 0;
+        for (int i = 0; i < ring->size(); i++) {
+            auto pkt = ring->at(i);
+            if (pkt == NULL || pkt->size() <= 0) continue;
+            writeFrame(pkt, stream_i);
+            n++;
+        }
+        return n;
+    }
+
+    /* write out packets buffered for interleaving (e.g. when over memory budget) */
+    void flushInterleave() {
+        MemoryScope scope(memory);
+        auto ret = av_interleaved_write_frame(format_ctx, NULL);
+        CHECK(ret >= 0, "Error when flushing interleaved packets");
+    }
+
+    Stats getStats() const { return stats; }
+    MemoryInfo getMemory() const { return memory->info(); }
 
     // only for C++
+    int nb_streams() { return format_ctx->nb_streams; }
+    OutputIO* outputIO() { return io; }
+    Stats& mutableStats() { return stats; }
     AVStream* av_stream(int index) { 
         CHECK(index >= 0 && index < format_ctx->nb_streams, "index out of range");
         return format_ctx->streams[index]; 
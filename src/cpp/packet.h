@@ -2,12 +2,16 @@
 #define PACKET_H
 
 #include <cstdio>
+#ifdef __EMSCRIPTEN__
 #include <emscripten/val.h>
+#endif
 extern "C" {
     #include <libavcodec/avcodec.h>
     #include <libavutil/timestamp.h>
 }
 
+#include "buffer_pool.h"
+
 
 /**
  * all int64_t should be converted double (otherwise will become int32)
@@ -25,7 +29,7 @@ public:
     Packet() { packet = av_packet_alloc(); }
     Packet(int bufSize, TimeInfo info) {
         packet = av_packet_alloc();
-        av_new_packet(packet, bufSize);
+        poolPacketBuffer(packet, bufSize);
         packet->pts = info.pts;
         packet->dts = info.dts;
         packet->duration = info.duration;
@@ -39,9 +43,11 @@ public:
     
     int stream_index() const { return packet->stream_index; }
     
+#ifdef __EMSCRIPTEN__
     emscripten::val getData() { 
         return emscripten::val(emscripten::typed_memory_view(packet->size, packet->data)); // check length of data
     }
+#endif
 
     TimeInfo getTimeInfo() {
         return {.pts = (double)packet->pts, .dts = (double)packet->dts, .duration = (double)packet->duration};
@@ -0,0 +1,153 @@
+#include "peaks.h"
+#include <cmath>
+#include <type_traits>
+
+
+static const int LANES = 8;
+
+
+AudioPeaks::AudioPeaks(int samples_per_bucket, int nb_levels) {
+    CHECK(samples_per_bucket > 0 && nb_levels > 0, "AudioPeaks: bucket size and levels should be positive");
+    this->samples_per_bucket = samples_per_bucket;
+    levels.resize(nb_levels);
+    pending.assign(nb_levels, emptyAccumulator());
+}
+
+
+AudioPeaks::AudioPeaks(Demuxer* demuxer, int stream_index, int samples_per_bucket, int nb_levels) 
+    : AudioPeaks(samples_per_bucket, nb_levels) {
+    CHECK(demuxer->av_stream(stream_index)->codecpar->codec_type == AVMEDIA_TYPE_AUDIO, 
+        "AudioPeaks: only audio stream");
+    this->demuxer = demuxer;
+    this->stream_index = stream_index;
+    decoder = new Decoder(demuxer, stream_index, "peaks");
+}
+
+
+/* push a full (or last) bucket to level, and merge into next level */
+void AudioPeaks::emit(int level, Accumulator& acc) {
+    if (acc.count <= 0) return;
+    auto& out = levels[level];
+    out.push_back(acc.min);
+    out.push_back(acc.max);
+    out.push_back(sqrt(acc.sumsq / acc.count));
+    if (level + 1 < levels.size()) {
+        auto& next = pending[level + 1];
+        next.min = FFMIN(next.min, acc.min);
+        next.max = FFMAX(next.max, acc.max);
+        next.sumsq += acc.sumsq;
+        next.count += acc.count;
+        if (++next.samples == 2) {
+            emit(level + 1, next);
+            next = emptyAccumulator();
+        }
+    }
+    acc = emptyAccumulator();
+}
+
+
+/**
+ * Reduce contiguous values (samples of packed channels, or of one planar channel) into level 0 buckets
+ * of `bucket_values` values (samples_per_bucket * channels).
+ * Per-lane accumulators have no dependency between lanes, so the loop is auto-vectorized (SIMD build).
+ */
+template<typename T>
+void AudioPeaks::addValues(const T* data, int nb_values, int64_t bucket_values, float scale, float offset) {
+    auto& acc = pending[0];
+    int i = 0;
+    while (i < nb_values) {
+        int n = (int)FFMIN((int64_t)(nb_values - i), bucket_values - acc.count);
+        float lo[LANES], hi[LANES], sq[LANES];
+        for (int k = 0; k < LANES; k++) { lo[k] = FLT_MAX; hi[k] = -FLT_MAX; sq[k] = 0; }
+        const T* p = data + i;
+        int j = 0;
+        for (; j + LANES <= n; j += LANES)
+            for (int k = 0; k < LANES; k++) {
+                float v = ((float)p[j + k] - offset) * scale;
+                lo[k] = v < lo[k] ? v : lo[k];
+                hi[k] = v > hi[k] ? v : hi[k];
+                sq[k] += v * v;
+            }
+        for (; j < n; j++) {
+            float v = ((float)p[j] - offset) * scale;
+            lo[0] = v < lo[0] ? v : lo[0];
+            hi[0] = v > hi[0] ? v : hi[0];
+            sq[0] += v * v;
+        }
+        for (int k = 0; k < LANES; k++) {
+            acc.min = FFMIN(acc.min, lo[k]);
+            acc.max = FFMAX(acc.max, hi[k]);
+            acc.sumsq += sq[k];
+        }
+        acc.count += n;
+        i += n;
+        if (acc.count == bucket_values) emit(0, acc);
+    }
+}
+
+
+void AudioPeaks::addFrame(Frame* frame) {
+    auto f = frame->av_ptr();
+    auto format = (AVSampleFormat)f->format;
+    auto channels = f->channels;
+    auto planar = av_sample_fmt_is_planar(format);
+    auto packed = av_get_packed_sample_fmt(format);
+    auto bucket_values = (int64_t)samples_per_bucket * channels;
+    auto add = [&](auto* type, float scale, float offset) {
+        using T = std::remove_pointer_t<decltype(type)>;
+        // packed channels are reduced at once
+        if (!planar) {
+            addValues((const T*)f->extended_data[0], f->nb_samples * channels, bucket_values, scale, offset);
+            return;
+        }
+        // planar channels one after another, over the samples left in current bucket
+        for (int s = 0; s < f->nb_samples; ) {
+            auto left = (int)(samples_per_bucket - pending[0].count / channels);
+            auto n = FFMIN(left, f->nb_samples - s);
+            for (int c = 0; c < channels; c++)
+                addValues((const T*)f->extended_data[c] + s, n, bucket_values, scale, offset);
+            s += n;
+        }
+    };
+    switch (packed) {
+        case AV_SAMPLE_FMT_U8: add((uint8_t*)NULL, 1.0f / 128, 128); break;
+        case AV_SAMPLE_FMT_S16: add((int16_t*)NULL, 1.0f / 32768, 0); break;
+        case AV_SAMPLE_FMT_S32: add((int32_t*)NULL, 1.0f / 2147483648.0f, 0); break;
+        case AV_SAMPLE_FMT_FLT: add((float*)NULL, 1.0f, 0); break;
+        case AV_SAMPLE_FMT_DBL: add((double*)NULL, 1.0f, 0); break;
+        default: CHECK(false, "AudioPeaks: unsupported sample format");
+    }
+}
+
+
+void AudioPeaks::flush() {
+    for (int level = 0; level < levels.size(); level++)
+        emit(level, pending[level]);
+}
+
+
+RemuxStatus AudioPeaks::process(int max_packets) {
+    RemuxStatus status = {.packets = 0, .bytes = 0, .end = end, .throttled = false};
+    CHECK(decoder != NULL, "AudioPeaks: no demuxer to process");
+    while (!end && status.packets < max_packets) {
+        if (!demuxer->readInto(&packet)) {
+            for (auto frame : decoder->flush()) {
+                addFrame(frame);
+                delete frame;
+            }
+            flush();
+            end = true;
+            break;
+        }
+        status.packets++;
+        status.bytes += packet.size();
+        if (packet.stream_index() != stream_index) continue;
+        for (auto frame : decoder->decode(&packet)) {
+            addFrame(frame);
+            delete frame;
+        }
+    }
+    status.end = end;
+
+    return status;
+}
@@ -0,0 +1,80 @@
+#ifndef PEAKS_H
+#define PEAKS_H
+
+#include <cfloat>
+#include <vector>
+extern "C" {
+    #include <libavutil/samplefmt.h>
+}
+
+#include "packet.h"
+#include "frame.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "remuxer.h"
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * Waveform peaks of an audio stream: for each bucket of `samples_per_bucket` samples (per channel),
+ * min, max and rms over all channels (samples normalized to [-1, 1]).
+ * Level k has buckets of samples_per_bucket * 2^k samples, built from level k-1 (zoom out).
+ * 
+ * Decoded frames are reduced right away, only peaks are kept (no PCM), 
+ * frames can be given by `addFrame` or decoded from a Demuxer by `process`.
+ */
+class AudioPeaks {
+    /* bucket being filled */
+    struct Accumulator {
+        float min;
+        float max;
+        double sumsq;
+        int64_t count;      // values (samples * channels)
+        int64_t samples;    // samples per channel (level 0) or buckets merged (other levels)
+    };
+    int samples_per_bucket;
+    vector<vector<float>> levels;   // [min, max, rms] of each bucket
+    vector<Accumulator> pending;    // per level
+    Demuxer* demuxer = NULL;
+    int stream_index = -1;
+    Decoder* decoder = NULL;
+    Packet packet;
+    bool end = false;
+
+    static Accumulator emptyAccumulator() { return { FLT_MAX, -FLT_MAX, 0, 0, 0 }; }
+    void emit(int level, Accumulator& acc);
+    template<typename T>
+    void addValues(const T* data, int nb_values, int64_t bucket_values, float scale, float offset);
+
+public:
+    AudioPeaks(int samples_per_bucket, int nb_levels);
+    /* decode audio stream of demuxer (owned by caller) */
+    AudioPeaks(Demuxer* demuxer, int stream_index, int samples_per_bucket, int nb_levels);
+    ~AudioPeaks() { delete decoder; }
+
+    /* reduce a decoded audio frame (any sample format), frame is not deleted */
+    void addFrame(Frame* frame);
+    /* emit last (partial) buckets of each level */
+    void flush();
+
+    /* async, read at most max_packets packets, flush at end of stream */
+    RemuxStatus process(int max_packets);
+
+    int nbLevels() const { return levels.size(); }
+    int nbBuckets(int level) const { return levels[level].size() / 3; }
+    int samplesPerBucket(int level) const { return samples_per_bucket << level; }
+#ifdef __EMSCRIPTEN__
+    /* Float32Array view [min, max, rms, ...] of current buckets, valid until next call */
+    emscripten::val peaks(int level) {
+        CHECK(level >= 0 && level < levels.size(), "AudioPeaks: level out of range");
+        return emscripten::val(emscripten::typed_memory_view(levels[level].size(), levels[level].data()));
+    }
+#endif
+
+// only for c++
+    const vector<float>& levelData(int level) const { return levels[level]; }
+};
+
+
+#endif
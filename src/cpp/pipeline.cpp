@@ -0,0 +1,502 @@
+#include "pipeline.h"
+
+
+#ifdef __EMSCRIPTEN__
+using namespace emscripten;
+
+vector<Packet*> ValEncoder::toPackets(val result) {
+    vector<Packet*> pkts;
+    auto length = result["length"].as<int>();
+    for (int i = 0; i < length; i++)
+        pkts.push_back(result[i].as<Packet*>(allow_raw_pointers()));
+    return pkts;
+}
+
+vector<Packet*> ValEncoder::encode(Frame* frame) {
+    auto planes = val::array();
+    for (auto& p : frame->getPlanes())
+        planes.call<void>("push", p);
+    return toPackets(encoder.call<val>("encode", frame->getFrameInfo(), frame->doublePTS(), planes).await());
+}
+#endif
+
+
+Pipeline::~Pipeline() {
+    stopThreads();
+    for (auto& s : sources)
+        for (auto& [_, decoder] : s.decoders)
+            delete decoder;
+    for (auto& [_, outs] : outputs)
+        for (auto& out : outs) {
+            if (out.encoder != NULL) delete out.encoder;
+            if (out.external != NULL) delete out.external;
+            if (out.converter != NULL) delete out.converter;
+        }
+    for (auto f : filter_pending)
+        delete f;
+    if (filterer != NULL)
+        delete filterer;
+}
+
+
+void Pipeline::addDecoder(Demuxer* demuxer, int stream_index, string name) {
+    auto source = std::find_if(sources.begin(), sources.end(), [&](auto& s) { return s.demuxer == demuxer; });
+    if (source == sources.end()) {
+        sources.push_back({.demuxer = demuxer, .decoders = {}, .end = false});
+        source = sources.end() - 1;
+    }
+    CHECK(source->decoders.count(stream_index) == 0, "Pipeline: stream already has a decoder");
+    source->decoders[stream_index] = new Decoder(demuxer, stream_index, name);
+}
+
+
+void Pipeline::setFilter(map<string, string> inTypes, map<string, string> outTypes, string filterSpec) {
+    filter_spec = filterSpec;
+    for (auto const& [id, type] : inTypes) {
+        filter_in_args[id] = "";
+        filter_media_types[id] = type;
+    }
+    for (auto const& [id, type] : outTypes) {
+        filter_out_args[id] = "";
+        filter_media_types[id] = type;
+    }
+}
+
+
+void Pipeline::addMuxer(Muxer* muxer) {
+    if (std::find(muxers.begin(), muxers.end(), muxer) == muxers.end())
+        muxers.push_back(muxer);
+}
+
+
+void Pipeline::addEncoder(string name, Muxer* muxer, StreamInfo info) {
+    auto encoder = new Encoder(info);
+    auto stream_index = muxer->nb_streams();
+    muxer->newStream(encoder);
+    addMuxer(muxer);
+    outputs[name].push_back({
+        .muxer = muxer, .stream_index = stream_index, .encoder = encoder, .external = NULL, 
+        .format = encoder->dataFormat(), .converter = NULL, .checked = false, .lane = NULL});
+}
+
+
+void Pipeline::addExternalEncoder(string name, Muxer* muxer, StreamInfo info, string format, ExternalEncoder* encoder) {
+    auto stream_index = muxer->nb_streams();
+    muxer->newStream(info);
+    addMuxer(muxer);
+    DataFormat dataFormat = {.format = format, .channelLayout = "", .channels = 0, .sampleRate = 0};
+    outputs[name].push_back({
+        .muxer = muxer, .stream_index = stream_index, .encoder = NULL, .external = encoder, 
+        .format = dataFormat, .converter = NULL, .checked = false, .lane = NULL});
+}
+
+
+/**
+ * Same as worker `dataFormatFilter`: only compare fields both sides have.
+ * Frames are in AV_TIME_BASE (microseconds).
+ */
+Filterer* Pipeline::createConverter(Output& out, Frame* frame) {
+    auto info = frame->getFrameInfo();
+    auto& fmt = out.format;
+    auto isVideo = info.height > 0 && info.width > 0;
+    auto diff = [](const string& a, const string& b) { return a.length() > 0 && b.length() > 0 && a != b; };
+    auto isDiff = diff(info.format, fmt.format) || 
+        (!isVideo && diff(info.channel_layout, fmt.channelLayout)) ||
+        (!isVideo && fmt.sampleRate > 0 && info.sample_rate != fmt.sampleRate);
+    if (!isDiff) return NULL;
+
+    auto id = frame->name();
+    auto srcArgs = isVideo ?
+        "video_size=" + to_string(info.width) + "x" + to_string(info.height) + 
+            ":pix_fmt=" + info.format + ":time_base=1/" + to_string(AV_TIME_BASE) :
+        "sample_rate=" + to_string(info.sample_rate) + ":sample_fmt=" + info.format + 
+            ":channel_layout=" + info.channel_layout + ":time_base=1/" + to_string(AV_TIME_BASE);
+    auto spec = isVideo ?
+        "format=pix_fmts=" + fmt.format :
+        "aformat=sample_fmts=" + fmt.format + 
+            (fmt.sampleRate > 0 ? ":sample_rates=" + to_string(fmt.sampleRate) : "") +
+            (fmt.channelLayout.length() > 0 ? ":channel_layouts=" + fmt.channelLayout : "");
+    
+    return new Filterer(
+        {{id, srcArgs}}, {{id, ""}}, {{id, isVideo ? "video" : "audio"}}, "[" + id + "]" + spec + "[" + id + "]");
+}
+
+
+/* encode frame (NULL to flush) and write packets into muxer */
+void Pipeline::encode(Output& out, Frame* frame) {
+#ifdef PIPELINE_THREADS
+    // encoder thread gets its own reference
+    if (out.lane != NULL) {
+        Frame* ref = NULL;
+        if (frame != NULL) {
+            ref = new Frame(frame->name());
+            av_frame_ref(ref->av_ptr(), frame->av_ptr());
+        }
+        if (!push(out.lane->frames, {.decoder = NULL, .packet = NULL, .frame = ref, .end = false}))
+            delete ref;
+        return;
+    }
+#endif
+    vector<Packet*> pkts;
+    if (out.encoder != NULL) {
+        // encoder rescales pts in place, keep it for other outputs
+        auto pts = frame != NULL ? frame->pts() : 0;
+        pkts = frame != NULL ? out.encoder->encode(frame) : out.encoder->flush();
+        if (frame != NULL) frame->set_pts(pts);
+    }
+    else
+        pkts = frame != NULL ? out.external->encode(frame) : out.external->flush();
+    for (auto p : pkts) {
+        if (p->size() > 0)
+            out.muxer->writeFrame(p, out.stream_index);
+        delete p;
+    }
+}
+
+
+void Pipeline::writeFrame(Output& out, Frame* frame) {
+    if (!out.checked) {
+        out.converter = createConverter(out, frame);
+        out.checked = true;
+    }
+    if (out.converter == NULL) {
+        encode(out, frame);
+        return;
+    }
+    vector<Frame*> frames = {frame};
+    for (auto f : out.converter->filter(frames)) {
+        encode(out, f);
+        delete f;
+    }
+}
+
+
+/* feed frames into filter graph, return filtered frames */
+vector<Frame*> Pipeline::filter(vector<Frame*>& frames) {
+    if (filter_spec.length() == 0) return {};
+    if (filterer == NULL) {
+        for (auto f : frames) {
+            auto id = f->name();
+            if (filter_in_args.count(id) == 0) continue;
+            // keep a reference until filterer created
+            auto pending = new Frame(id);
+            av_frame_ref(pending->av_ptr(), f->av_ptr());
+            filter_pending.push_back(pending);
+            if (filter_in_args[id] != "") continue;
+            auto info = f->getFrameInfo();
+            filter_in_args[id] = filter_media_types[id] == "video" ?
+                "video_size=" + to_string(info.width) + "x" + to_string(info.height) + 
+                    ":pix_fmt=" + info.format + ":time_base=1/" + to_string(AV_TIME_BASE) :
+                "sample_rate=" + to_string(info.sample_rate) + ":sample_fmt=" + info.format + 
+                    ":channel_layout=" + info.channel_layout + ":time_base=1/" + to_string(AV_TIME_BASE);
+        }
+        for (auto const& [_, args] : filter_in_args)
+            if (args == "") return {};
+        filterer = new Filterer(filter_in_args, filter_out_args, filter_media_types, filter_spec);
+        auto outs = filterer->filter(filter_pending);
+        for (auto f : filter_pending)
+            delete f;
+        filter_pending.clear();
+        return outs;
+    }
+
+    return filterer->filter(frames);
+}
+
+
+void Pipeline::writeFrames(vector<Frame*>& frames) {
+    auto filtered = filter(frames);
+    frames.insert(frames.end(), filtered.begin(), filtered.end());
+    for (auto f : frames) {
+        if (outputs.count(f->name()) > 0)
+            for (auto& out : outputs[f->name()])
+                writeFrame(out, f);
+        delete f;
+    }
+}
+
+
+/* flush filterer and encoders */
+void Pipeline::flushStages() {
+    vector<Frame*> frames;
+    if (filterer != NULL)
+        frames = filterer->flush();
+    for (auto f : frames) {
+        if (outputs.count(f->name()) > 0)
+            for (auto& out : outputs[f->name()])
+                writeFrame(out, f);
+        delete f;
+    }
+    for (auto& [_, outs] : outputs)
+        for (auto& out : outs) {
+            if (out.converter != NULL)
+                for (auto f : out.converter->flush()) {
+                    encode(out, f);
+                    delete f;
+                }
+            encode(out, NULL);
+        }
+}
+
+
+/* flush all stages (wait for stage threads) and write trailers */
+void Pipeline::finish() {
+#ifdef PIPELINE_THREADS
+    if (threaded) {
+        queuePacket(NULL, NULL);
+        QueueWait wait;
+        while (!writeOutputs()) wait();
+        stopThreads();
+    }
+    else
+#endif
+        flushStages();
+    for (auto muxer : muxers)
+        muxer->writeTrailer();
+    end = true;
+}
+
+
+/* one step: read a packet from the source with smallest current time */
+bool Pipeline::stepOnce() {
+    Source* source = NULL;
+    double min_time = INFINITY;
+    for (auto& s : sources) {
+        if (s.end) continue;
+        for (auto const& [index, _] : s.decoders) {
+            auto t = s.demuxer->currentTime(index);
+            if (t < min_time || source == NULL) {
+                min_time = t;
+                source = &s;
+            }
+        }
+    }
+    if (source == NULL) {
+        finish();
+        return false;
+    }
+
+    vector<Frame*> frames;
+    if (!source->demuxer->readInto(&packet)) {
+        source->end = true;
+        for (auto& [_, decoder] : source->decoders) {
+            if (threaded) {
+                queuePacket(decoder, NULL);
+                continue;
+            }
+            auto flushed = decoder->flush();
+            frames.insert(frames.end(), flushed.begin(), flushed.end());
+        }
+    }
+    else if (source->decoders.count(packet.stream_index()) > 0) {
+        auto decoder = source->decoders[packet.stream_index()];
+        if (threaded)
+            queuePacket(decoder, &packet);
+        else
+            frames = decoder->decode(&packet);
+    }
+    writeFrames(frames);
+
+    return true;
+}
+
+
+PipelineStatus Pipeline::step(int max_steps) {
+    PipelineStatus status = {.steps = 0, .end = end, .throttled = false};
+    if (!started) {
+        for (auto muxer : muxers)
+            muxer->writeHeader();
+        started = true;
+        if (threaded) startThreads();
+    }
+    // packets encoded by stage threads since last call
+    if (threaded && !end) writeOutputs();
+    while (!end && status.steps < max_steps) {
+        // backpressure: at least one step each call, so that caller can drain outputs
+        if (status.steps > 0 && overMemoryBudget()) {
+            for (auto muxer : muxers)
+                muxer->flushInterleave();
+            if (overMemoryBudget()) {
+                status.throttled = true;
+                break;
+            }
+        }
+        if (!stepOnce()) break;
+        status.steps++;
+    }
+    status.end = end;
+
+    return status;
+}
+
+
+#ifdef PIPELINE_THREADS
+/* packets/frames buffered between two stages */
+static const int STAGE_QUEUE_SIZE = 8;
+
+
+bool Pipeline::setThreaded(bool enable) {
+    CHECK(!started, "Pipeline: setThreaded after first step");
+    threaded = enable;
+    // JS encoders only run on the caller thread
+    for (auto& [_, outs] : outputs)
+        for (auto& out : outs)
+            if (out.external != NULL) threaded = false;
+    return threaded;
+}
+
+
+/* wait for room, false when stopping (item not pushed) */
+bool Pipeline::push(SPSCQueue<StageItem>& queue, StageItem item) {
+    QueueWait wait;
+    while (!queue.push(item)) {
+        if (stopping.load(memory_order_relaxed)) return false;
+        wait();
+    }
+    return true;
+}
+
+
+/* wait for an item, false when stopping */
+bool Pipeline::pop(SPSCQueue<StageItem>& queue, StageItem& item) {
+    QueueWait wait;
+    while (!queue.pop(item)) {
+        if (stopping.load(memory_order_relaxed)) return false;
+        wait();
+    }
+    return true;
+}
+
+
+void Pipeline::startThreads() {
+    packets_in = new SPSCQueue<StageItem>(STAGE_QUEUE_SIZE * 4);
+    frames_in = new SPSCQueue<StageItem>(STAGE_QUEUE_SIZE);
+    for (auto& [_, outs] : outputs)
+        for (auto& out : outs) {
+            out.lane = new StageLane(STAGE_QUEUE_SIZE);
+            out.lane->worker = thread(&Pipeline::encodeLoop, this, &out);
+        }
+    filter_thread = thread(&Pipeline::filterLoop, this);
+    decode_thread = thread(&Pipeline::decodeLoop, this);
+}
+
+
+/* join stage threads (interrupted if not ended), and delete items left in queues */
+void Pipeline::stopThreads() {
+    if (packets_in == NULL) return;
+    auto deleteItems = [](SPSCQueue<StageItem>* queue) {
+        StageItem item;
+        while (queue->pop(item)) {
+            if (item.packet != NULL) delete item.packet;
+            if (item.frame != NULL) delete item.frame;
+        }
+    };
+    stopping = true;
+    if (decode_thread.joinable()) decode_thread.join();
+    if (filter_thread.joinable()) filter_thread.join();
+    for (auto& [_, outs] : outputs)
+        for (auto& out : outs) {
+            if (out.lane == NULL) continue;
+            if (out.lane->worker.joinable()) out.lane->worker.join();
+            deleteItems(&out.lane->frames);
+            deleteItems(&out.lane->packets);
+            delete out.lane;
+            out.lane = NULL;
+        }
+    deleteItems(packets_in);
+    deleteItems(frames_in);
+    delete packets_in;
+    delete frames_in;
+    packets_in = NULL;
+    frames_in = NULL;
+}
+
+
+/* caller thread: a reference of packet (NULL to flush decoder, both NULL for end), waiting while queue is full */
+void Pipeline::queuePacket(Decoder* decoder, Packet* pkt) {
+    Packet* ref = NULL;
+    if (pkt != NULL) {
+        ref = new Packet();
+        av_packet_move_ref(ref->av_packet(), pkt->av_packet());
+    }
+    StageItem item = {.decoder = decoder, .packet = ref, .frame = NULL, .end = decoder == NULL};
+    QueueWait wait;
+    // keep writing outputs, so that stages behind never stay blocked
+    while (!packets_in->push(item)) {
+        writeOutputs();
+        wait();
+    }
+}
+
+
+/* caller thread: write packets of encoder threads into muxers, return true when all of them ended */
+bool Pipeline::writeOutputs() {
+    auto ended = true;
+    for (auto& [_, outs] : outputs)
+        for (auto& out : outs) {
+            StageItem item;
+            while (!out.lane->end && out.lane->packets.pop(item)) {
+                if (item.end) {
+                    out.lane->end = true;
+                    break;
+                }
+                if (item.packet->size() > 0)
+                    out.muxer->writeFrame(item.packet, out.stream_index);
+                delete item.packet;
+            }
+            ended = ended && out.lane->end;
+        }
+    return ended;
+}
+
+
+void Pipeline::decodeLoop() {
+    StageItem item = {};
+    while (pop(*packets_in, item) && !item.end) {
+        auto frames = item.packet != NULL ? item.decoder->decode(item.packet) : item.decoder->flush();
+        if (item.packet != NULL) delete item.packet;
+        for (auto f : frames)
+            if (!push(*frames_in, {.decoder = NULL, .packet = NULL, .frame = f, .end = false}))
+                delete f;
+    }
+    if (item.end)
+        push(*frames_in, {.decoder = NULL, .packet = NULL, .frame = NULL, .end = true});
+}
+
+
+void Pipeline::filterLoop() {
+    StageItem item = {};
+    while (pop(*frames_in, item) && !item.end) {
+        vector<Frame*> frames = {item.frame};
+        writeFrames(frames);
+    }
+    if (!item.end) return;
+    flushStages();
+    for (auto& [_, outs] : outputs)
+        for (auto& out : outs)
+            push(out.lane->frames, {.decoder = NULL, .packet = NULL, .frame = NULL, .end = true});
+}
+
+
+void Pipeline::encodeLoop(Output* out) {
+    StageItem item = {};
+    while (pop(out->lane->frames, item) && !item.end) {
+        auto pkts = item.frame != NULL ? out->encoder->encode(item.frame) : out->encoder->flush();
+        if (item.frame != NULL) delete item.frame;
+        for (auto p : pkts)
+            if (!push(out->lane->packets, {.decoder = NULL, .packet = p, .frame = NULL, .end = false}))
+                delete p;
+    }
+    if (item.end)
+        push(out->lane->packets, {.decoder = NULL, .packet = NULL, .frame = NULL, .end = true});
+}
+
+#else
+
+bool Pipeline::setThreaded(bool enable) { return false; }
+void Pipeline::startThreads() {}
+void Pipeline::stopThreads() {}
+void Pipeline::queuePacket(Decoder* decoder, Packet* pkt) {}
+bool Pipeline::writeOutputs() { return true; }
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#ifdef __EMSCRIPTEN__
+#include <emscripten/val.h>
+#endif
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+#include "packet.h"
+#include "frame.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "filter.h"
+#include "encode.h"
+#include "muxer.h"
+#include "utils.h"
+using namespace std;
+
+// stage threads need pthreads (wasm built with -pthread, or native)
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define PIPELINE_THREADS
+#include <thread>
+#include "spsc_queue.h"
+#endif
+
+
+/* encoder stage implemented outside of FFmpeg (e.g. WebCodecs), returned packets are owned by caller */
+class ExternalEncoder {
+public:
+    virtual ~ExternalEncoder() {}
+    /* async */
+    virtual vector<Packet*> encode(Frame* frame) = 0;
+    /* async */
+    virtual vector<Packet*> flush() = 0;
+};
+
+
+#ifdef __EMSCRIPTEN__
+/* JS encoder: { encode(info: FrameInfo, pts, planes: Uint8Array[]) => Promise<Packet[]>, flush() => Promise<Packet[]> } */
+class ValEncoder : public ExternalEncoder {
+    emscripten::val encoder;
+    vector<Packet*> toPackets(emscripten::val result);
+public:
+    ValEncoder(emscripten::val _encoder) { encoder = std::move(_encoder); }
+    vector<Packet*> encode(Frame* frame) override;
+    vector<Packet*> flush() override { return toPackets(encoder.call<emscripten::val>("flush").await()); }
+};
+#endif
+
+
+struct PipelineStatus {
+    int steps;
+    bool end;
+    bool throttled; // stopped early because over memory budget
+};
+
+
+/**
+ * Demuxer -> Decoders -> Filterer -> Encoders -> Muxer, wired by stream ids (frame names),
+ * advancing several steps per call without crossing into JS for every frame.
+ * Demuxers and Muxers are owned by the caller (built with JS reader/writer),
+ * Decoders, Filterers and Encoders are created and owned by the Pipeline.
+ * 
+ * Threaded (pthread builds): decoders, filters (with converters) and each encoder run on their own thread,
+ * connected by bounded SPSC queues of refcounted packets/frames. The caller thread only reads and writes
+ * (JS reader/writer), and waits (writing outputs) while the first queue is full.
+ * End of sources flows through the queues: each stage flushes, then passes `end` on.
+ */
+class Pipeline {
+#ifdef PIPELINE_THREADS
+    /* packet/frame between stages, NULL one to flush (decoder/encoder), `end` after last one */
+    struct StageItem {
+        Decoder* decoder;
+        Packet* packet;
+        Frame* frame;
+        bool end;
+    };
+    /* filter thread -> encoder thread -> caller, of an output */
+    struct StageLane {
+        SPSCQueue<StageItem> frames;
+        SPSCQueue<StageItem> packets;
+        thread worker;
+        bool end = false;
+        StageLane(size_t capacity) : frames(capacity), packets(capacity) {}
+    };
+#else
+    struct StageLane;
+#endif
+    struct Source {
+        Demuxer* demuxer;
+        map<int, Decoder*> decoders; // stream index -> decoder
+        bool end;
+    };
+    struct Output {
+        Muxer* muxer;
+        int stream_index;
+        Encoder* encoder;       // NULL when using external encoder
+        ExternalEncoder* external;
+        DataFormat format;      // data format required by encoder
+        Filterer* converter;    // convert frames to required data format, NULL if not needed
+        bool checked;           // whether converter has been checked
+        StageLane* lane;        // when threaded
+    };
+    vector<Source> sources;
+    map<string, vector<Output>> outputs; // frame name (streamId) -> encoders
+    vector<Muxer*> muxers;
+    // filter graph, created once every input has got its first frame
+    Filterer* filterer = NULL;
+    string filter_spec;
+    map<string, string> filter_in_args;
+    map<string, string> filter_out_args;
+    map<string, string> filter_media_types;
+    vector<Frame*> filter_pending;
+    Packet packet;
+    bool started = false;
+    bool end = false;
+    bool threaded = false;
+#ifdef PIPELINE_THREADS
+    SPSCQueue<StageItem>* packets_in = NULL;   // caller -> decode thread
+    SPSCQueue<StageItem>* frames_in = NULL;    // decode thread -> filter thread
+    thread decode_thread;
+    thread filter_thread;
+    atomic<bool> stopping {false};
+
+    bool push(SPSCQueue<StageItem>& queue, StageItem item);
+    bool pop(SPSCQueue<StageItem>& queue, StageItem& item);
+    void decodeLoop();
+    void filterLoop();
+    void encodeLoop(Output* out);
+#endif
+    void startThreads();
+    void stopThreads();
+    void queuePacket(Decoder* decoder, Packet* pkt);
+    bool writeOutputs();
+
+    bool stepOnce();
+    void flushStages();
+    void finish();
+    vector<Frame*> filter(vector<Frame*>& frames);
+    void writeFrames(vector<Frame*>& frames);
+    void writeFrame(Output& out, Frame* frame);
+    void encode(Output& out, Frame* frame);
+    Filterer* createConverter(Output& out, Frame* frame);
+    void addMuxer(Muxer* muxer);
+
+public:
+    Pipeline() {}
+    ~Pipeline();
+
+    void addDecoder(Demuxer* demuxer, int stream_index, string name);
+
+    /**
+     * @param inTypes map <id (stream), audio/video> of buffersrc
+     * @param outTypes map <id (stream), audio/video> of buffersink
+     */
+    void setFilter(map<string, string> inTypes, map<string, string> outTypes, string filterSpec);
+
+    /* frames named `name` are encoded and written into a new stream of muxer */
+    void addEncoder(string name, Muxer* muxer, StreamInfo info);
+
+    /**
+     * @brief plug an encoder stage outside of FFmpeg, only used when requested (e.g. WebCodecs).
+     * 
+     * @param format pixel/sample format the encoder accepts, empty for any
+     * @param encoder take ownership
+     */
+    void addExternalEncoder(string name, Muxer* muxer, StreamInfo info, string format, ExternalEncoder* encoder);
+#ifdef __EMSCRIPTEN__
+    void addExternalEncoder(string name, Muxer* muxer, StreamInfo info, string format, emscripten::val encoder) {
+        addExternalEncoder(name, muxer, info, format, new ValEncoder(std::move(encoder)));
+    }
+#endif
+
+    /* run stages on threads (before first step), return false if not supported (no pthreads, external encoders) */
+    bool setThreaded(bool enable);
+
+    /* async, run at most max_steps steps (one packet read each) */
+    PipelineStatus step(int max_steps);
+};
+
+
+#endif
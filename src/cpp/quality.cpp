@@ -0,0 +1,241 @@
+#include "quality.h"
+#include <cmath>
+#include <algorithm>
+extern "C" {
+    #include <libavutil/pixdesc.h>
+}
+
+
+QualityMeter::QualityMeter(Demuxer* ref_demuxer, int ref_stream_index, Demuxer* dist_demuxer, int dist_stream_index, QualityOptions options) {
+    CHECK(ref_demuxer->av_stream(ref_stream_index)->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+        dist_demuxer->av_stream(dist_stream_index)->codecpar->codec_type == AVMEDIA_TYPE_VIDEO, 
+        "QualityMeter: only video streams");
+    for (auto side : {&ref, &dist}) {
+        auto is_ref = side == &ref;
+        side->demuxer = is_ref ? ref_demuxer : dist_demuxer;
+        side->stream_index = is_ref ? ref_stream_index : dist_stream_index;
+        side->decoder = new Decoder(side->demuxer, side->stream_index, is_ref ? "quality_ref" : "quality_dist");
+        side->end = false;
+        side->sws_ctx = NULL;
+        side->converted = NULL;
+    }
+    this->options = options;
+    // half of reference frame interval (25 fps when unknown)
+    auto rate = ref_demuxer->av_stream(ref_stream_index)->avg_frame_rate;
+    auto interval = rate.num > 0 && rate.den > 0 ? av_rescale_q(1, av_inv_q(rate), AV_TIME_BASE_Q) : AV_TIME_BASE / 25;
+    tolerance = interval / 2;
+}
+
+
+QualityMeter::~QualityMeter() {
+    for (auto side : {&ref, &dist}) {
+        for (auto frame : side->frames) delete frame;
+        delete side->decoder;
+        if (side->sws_ctx) sws_freeContext(side->sws_ctx);
+        if (side->converted) av_frame_free(&side->converted);
+    }
+}
+
+
+/* read one packet of side, and queue its decoded frames. Return false at end of input */
+bool QualityMeter::read(Side& side) {
+    if (!side.demuxer->readInto(&side.packet)) {
+        for (auto frame : side.decoder->flush())
+            side.frames.push_back(frame);
+        side.end = true;
+        return false;
+    }
+    if (side.packet.stream_index() == side.stream_index) {
+        for (auto frame : side.decoder->decode(&side.packet))
+            side.frames.push_back(frame);
+    }
+    return true;
+}
+
+
+/* match queued frames by pts, unmatched frames (dropped/duplicated by the encoder) are skipped */
+void QualityMeter::align() {
+    while (ref.frames.size() > 0 && dist.frames.size() > 0) {
+        auto r = ref.frames.front();
+        auto d = dist.frames.front();
+        auto diff = d->pts() - r->pts();
+        if (diff < -tolerance) {
+            dist.frames.pop_front();
+            delete d;
+            continue;
+        }
+        if (diff > tolerance) {
+            ref.frames.pop_front();
+            delete r;
+            continue;
+        }
+        if (options.every_nth <= 1 || aligned % options.every_nth == 0) {
+            auto rf = r->av_ptr();
+            // common 8-bit planar YUV format: reference one if it is, otherwise yuv420p
+            auto format = (AVPixelFormat)rf->format;
+            auto desc = av_pix_fmt_desc_get(format);
+            if (!desc || desc->comp[0].depth != 8 || !(desc->flags & AV_PIX_FMT_FLAG_PLANAR) || 
+                (desc->flags & AV_PIX_FMT_FLAG_RGB) || desc->nb_components < 3 || desc->comp[2].plane != 2)
+                format = AV_PIX_FMT_YUV420P;
+            auto a = prepare(ref, rf, rf->width, rf->height, format);
+            auto b = prepare(dist, d->av_ptr(), rf->width, rf->height, format);
+            measure(a, b, r->pts() / (double)AV_TIME_BASE);
+        }
+        aligned++;
+        ref.frames.pop_front();
+        dist.frames.pop_front();
+        delete r;
+        delete d;
+    }
+}
+
+
+/* frame itself when already in size/format, otherwise converted into side's reused frame */
+AVFrame* QualityMeter::prepare(Side& side, AVFrame* frame, int width, int height, AVPixelFormat format) {
+    if (frame->width == width && frame->height == height && frame->format == format)
+        return frame;
+    side.sws_ctx = sws_getCachedContext(side.sws_ctx, frame->width, frame->height, (AVPixelFormat)frame->format,
+        width, height, format, SWS_BICUBIC, NULL, NULL, NULL);
+    CHECK(side.sws_ctx != NULL, "QualityMeter: cannot create scaler");
+    auto out = side.converted;
+    if (!out || out->width != width || out->height != height || out->format != format) {
+        if (out) av_frame_free(&out);
+        out = av_frame_alloc();
+        out->width = width;
+        out->height = height;
+        out->format = format;
+        CHECK(av_frame_get_buffer(out, 0) >= 0, "QualityMeter: cannot allocate frame");
+        side.converted = out;
+    }
+    sws_scale(side.sws_ctx, frame->data, frame->linesize, 0, frame->height, out->data, out->linesize);
+    return out;
+}
+
+
+/* sum of squared errors, per row integer reduction is auto-vectorized (SIMD build) */
+static uint64_t sse(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride, int width, int height) {
+    uint64_t sum = 0;
+    for (int y = 0; y < height; y++, a += a_stride, b += b_stride) {
+        uint32_t row = 0; // < 2^32 for width < 66051
+        for (int x = 0; x < width; x++) {
+            int d = (int)a[x] - (int)b[x];
+            row += d * d;
+        }
+        sum += row;
+    }
+    return sum;
+}
+
+
+/**
+ * Mean SSIM of 8x8 windows with step 4 (as x264/FFmpeg ssim, without gaussian weighting).
+ * Window sums are integer and vectorizable, the SSIM formula is per window only.
+ */
+static double ssim(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride, int width, int height) {
+    const int N = 8;
+    const double C1 = (0.01 * 255) * (0.01 * 255);
+    const double C2 = (0.03 * 255) * (0.03 * 255);
+    double total = 0;
+    int count = 0;
+    for (int y = 0; y + N <= height; y += 4) {
+        for (int x = 0; x + N <= width; x += 4) {
+            uint32_t s1 = 0, s2 = 0, ss = 0, s12 = 0;
+            for (int j = 0; j < N; j++) {
+                auto pa = a + (y + j) * a_stride + x;
+                auto pb = b + (y + j) * b_stride + x;
+                for (int i = 0; i < N; i++) {
+                    uint32_t va = pa[i], vb = pb[i];
+                    s1 += va;
+                    s2 += vb;
+                    ss += va * va + vb * vb;
+                    s12 += va * vb;
+                }
+            }
+            double m1 = s1 / (double)(N * N), m2 = s2 / (double)(N * N);
+            double vars = ss / (double)(N * N) - m1 * m1 - m2 * m2;
+            double cov = s12 / (double)(N * N) - m1 * m2;
+            total += (2 * m1 * m2 + C1) * (2 * cov + C2) / ((m1 * m1 + m2 * m2 + C1) * (vars + C2));
+            count++;
+        }
+    }
+    return count > 0 ? total / count : 1;
+}
+
+
+static double psnr(double sse, double pixels) {
+    if (sse <= 0) return 100;
+    return std::min(100.0, 10 * log10(255.0 * 255.0 * pixels / sse));
+}
+
+
+void QualityMeter::measure(AVFrame* a, AVFrame* b, double time) {
+    auto desc = av_pix_fmt_desc_get((AVPixelFormat)a->format);
+    double plane_psnr[3], plane_ssim[3] = {1, 1, 1};
+    for (int p = 0; p < 3; p++) {
+        int width = p == 0 ? a->width : AV_CEIL_RSHIFT(a->width, desc->log2_chroma_w);
+        int height = p == 0 ? a->height : AV_CEIL_RSHIFT(a->height, desc->log2_chroma_h);
+        double plane_sse = sse(a->data[p], a->linesize[p], b->data[p], b->linesize[p], width, height);
+        plane_psnr[p] = psnr(plane_sse, (double)width * height);
+        sse_sum[p] += plane_sse;
+        pixels_sum[p] += (double)width * height;
+        if (options.ssim) {
+            plane_ssim[p] = ssim(a->data[p], a->linesize[p], b->data[p], b->linesize[p], width, height);
+            ssim_sum[p] += plane_ssim[p];
+        }
+    }
+    FrameQuality q = {
+        .time = time,
+        .psnr_y = plane_psnr[0],
+        .psnr_u = plane_psnr[1],
+        .psnr_v = plane_psnr[2],
+        .psnr = (4 * plane_psnr[0] + plane_psnr[1] + plane_psnr[2]) / 6,
+        .ssim_y = plane_ssim[0],
+        .ssim = (4 * plane_ssim[0] + plane_ssim[1] + plane_ssim[2]) / 6,
+    };
+    min_psnr = std::min(min_psnr, q.psnr);
+    min_ssim = std::min(min_ssim, q.ssim);
+    results.push_back(q);
+}
+
+
+RemuxStatus QualityMeter::process(int max_packets) {
+    RemuxStatus status = {.packets = 0, .bytes = 0, .end = end, .throttled = false};
+    while (!end && status.packets < max_packets) {
+        // read the side behind, to keep both queues short
+        auto side = &ref;
+        if (ref.end || (!dist.end && dist.frames.size() < ref.frames.size()))
+            side = &dist;
+        if (read(*side)) {
+            status.packets++;
+            status.bytes += side->packet.size();
+        }
+        align();
+        if (ref.end && dist.end) {
+            // remaining frames have no match
+            for (auto s : {&ref, &dist}) {
+                for (auto frame : s->frames) delete frame;
+                s->frames.clear();
+            }
+            end = true;
+        }
+    }
+    status.end = end;
+
+    return status;
+}
+
+
+QualitySummary QualityMeter::getSummary() const {
+    int n = results.size();
+    auto mean_psnr = [&](int p) { return psnr(sse_sum[p], pixels_sum[p]); };
+    auto mean_ssim = [&](int p) { return n > 0 && options.ssim ? ssim_sum[p] / n : 1; };
+    return {
+        .frames = n,
+        .psnr = n > 0 ? (4 * mean_psnr(0) + mean_psnr(1) + mean_psnr(2)) / 6 : 0,
+        .psnr_y = n > 0 ? mean_psnr(0) : 0,
+        .ssim = (4 * mean_ssim(0) + mean_ssim(1) + mean_ssim(2)) / 6,
+        .ssim_y = mean_ssim(0),
+        .min_psnr = n > 0 ? min_psnr : 0,
+        .min_ssim = n > 0 ? min_ssim : 0,
+    };
+}
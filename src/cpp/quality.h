@@ -0,0 +1,98 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <deque>
+#include <vector>
+extern "C" {
+    #include <libswscale/swscale.h>
+}
+
+#include "packet.h"
+#include "frame.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "remuxer.h"
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * every_nth: measure only every Nth aligned frame (0/1 measures all), for quick checks
+ * ssim: also compute SSIM (PSNR always)
+ */
+struct QualityOptions {
+    int every_nth;
+    bool ssim;
+};
+
+/* PSNR in dB (100 for identical planes), SSIM in 0~1, weighted Y:U:V = 4:1:1 */
+struct FrameQuality {
+    double time;    // seconds, pts of reference frame
+    double psnr_y;
+    double psnr_u;
+    double psnr_v;
+    double psnr;
+    double ssim_y;
+    double ssim;
+};
+
+struct QualitySummary {
+    int frames;
+    double psnr;    // of mean squared error of all measured frames
+    double psnr_y;
+    double ssim;    // mean
+    double ssim_y;
+    double min_psnr;
+    double min_ssim;
+};
+
+
+/**
+ * Full-reference quality (PSNR/SSIM) of a distorted video stream against a reference one,
+ * frames aligned by pts (unmatched frames skipped). Distorted frames are scaled to reference size
+ * and both converted to a common 8-bit planar YUV format when needed.
+ * Demuxers are owned by caller.
+ */
+class QualityMeter {
+    struct Side {
+        Demuxer* demuxer;
+        int stream_index;
+        Decoder* decoder;
+        deque<Frame*> frames;
+        Packet packet;
+        bool end;
+        SwsContext* sws_ctx;
+        AVFrame* converted;
+    };
+    Side ref;
+    Side dist;
+    QualityOptions options;
+    int64_t tolerance; // max pts difference of aligned frames
+    int64_t aligned = 0;
+    vector<FrameQuality> results;
+    double sse_sum[3] = {0, 0, 0};
+    double pixels_sum[3] = {0, 0, 0};
+    double ssim_sum[3] = {0, 0, 0};
+    double min_psnr = 100;
+    double min_ssim = 1;
+    bool end = false;
+
+    bool read(Side& side);
+    void align();
+    AVFrame* prepare(Side& side, AVFrame* frame, int width, int height, AVPixelFormat format);
+    void measure(AVFrame* a, AVFrame* b, double time);
+
+public:
+    QualityMeter(Demuxer* ref_demuxer, int ref_stream_index, Demuxer* dist_demuxer, int dist_stream_index, QualityOptions options);
+    ~QualityMeter();
+
+    /* async, read at most max_packets packets (of both inputs) */
+    RemuxStatus process(int max_packets);
+
+    /* per measured frame */
+    vector<FrameQuality> getFrames() const { return results; }
+    QualitySummary getSummary() const;
+};
+
+
+#endif
@@ -0,0 +1,98 @@
+#include "remuxer.h"
+
+
+Remuxer::~Remuxer() {
+    for (auto& [_, outs] : routes)
+        for (auto& route : outs)
+            av_bsf_free(&route.bsf_ctx);
+}
+
+
+void Remuxer::addStream(int in_stream_index, Muxer* muxer, int out_stream_index, string bsf_name) {
+    Route route = {.muxer = muxer, .out_stream_index = out_stream_index, .bsf_ctx = NULL};
+    if (bsf_name.length() > 0) {
+        const AVBitStreamFilter* bsf = av_bsf_get_by_name(bsf_name.c_str());
+        CHECK(bsf != NULL, "Could not find bitstream filter");
+        av_bsf_alloc(bsf, &route.bsf_ctx);
+        auto ret = avcodec_parameters_copy(route.bsf_ctx->par_in, demuxer->av_stream(in_stream_index)->codecpar);
+        CHECK(ret >= 0, "Failed to copy codec parameters to bitstream filter");
+        // packets from Demuxer::readInto are in microseconds
+        route.bsf_ctx->time_base_in = AV_TIME_BASE_Q;
+        ret = av_bsf_init(route.bsf_ctx);
+        CHECK(ret >= 0, "Failed to initialize bitstream filter");
+        // output stream should describe filtered bitstream
+        ret = avcodec_parameters_copy(muxer->av_stream(out_stream_index)->codecpar, route.bsf_ctx->par_out);
+        CHECK(ret >= 0, "Failed to copy bitstream filter parameters to output stream");
+    }
+    routes[in_stream_index].push_back(route);
+}
+
+
+/* pkt will be unreferenced after writing */
+void Remuxer::writeRoute(Route& route, Packet* pkt) {
+    if (route.bsf_ctx == NULL) {
+        route.muxer->writeFrame(pkt, route.out_stream_index);
+        return;
+    }
+    // send NULL packet to flush
+    auto ret = av_bsf_send_packet(route.bsf_ctx, pkt != NULL ? pkt->av_packet() : NULL);
+    CHECK(ret >= 0, "Error sending packet to bitstream filter");
+    while (1) {
+        ret = av_bsf_receive_packet(route.bsf_ctx, bsf_packet.av_packet());
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            break;
+        CHECK(ret >= 0, "Error receiving packet from bitstream filter");
+        route.muxer->writeFrame(&bsf_packet, route.out_stream_index);
+    }
+}
+
+
+void Remuxer::flushRoutes() {
+    for (auto& [_, outs] : routes)
+        for (auto& route : outs)
+            if (route.bsf_ctx != NULL)
+                writeRoute(route, NULL);
+}
+
+
+RemuxStatus Remuxer::process(int max_packets, int max_bytes) {
+    RemuxStatus status = {.packets = 0, .bytes = 0, .end = end, .throttled = false};
+
+    while (!end && status.packets < max_packets && status.bytes < max_bytes) {
+        // backpressure: at least one packet each call, so that caller can drain outputs
+        if (status.packets > 0 && overMemoryBudget()) {
+            for (auto& [_, outs] : routes)
+                for (auto& route : outs)
+                    route.muxer->flushInterleave();
+            if (overMemoryBudget()) {
+                status.throttled = true;
+                break;
+            }
+        }
+        if (!demuxer->readInto(&packet)) {
+            end = true;
+            flushRoutes();
+            break;
+        }
+        auto av_pkt = packet.av_packet();
+        status.packets++;
+        status.bytes += av_pkt->size;
+        if (routes.count(av_pkt->stream_index) == 0) {
+            av_packet_unref(av_pkt);
+            continue;
+        }
+        if (av_pkt->pts != AV_NOPTS_VALUE) av_pkt->pts += time_offset;
+        if (av_pkt->dts != AV_NOPTS_VALUE) av_pkt->dts += time_offset;
+        // muxer takes ownership of packet data, so only the last output reuses it.
+        auto& outs = routes[av_pkt->stream_index];
+        for (size_t i = 0; i + 1 < outs.size(); i++) {
+            auto ret = av_packet_ref(ref_packet.av_packet(), av_pkt);
+            CHECK(ret >= 0, "Could not reference packet");
+            writeRoute(outs[i], &ref_packet);
+        }
+        writeRoute(outs.back(), &packet);
+    }
+    status.end = end;
+
+    return status;
+}
@@ -0,0 +1,71 @@
+#ifndef REMUXER_H
+#define REMUXER_H
+
+#include <map>
+#include <string>
+#include <vector>
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavcodec/bsf.h>
+}
+
+#include "packet.h"
+#include "demuxer.h"
+#include "muxer.h"
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * Result of one Remuxer::process call.
+ * bytes use double (otherwise int64_t will become int32)
+ */
+struct RemuxStatus {
+    int packets;
+    double bytes;
+    bool end;
+    bool throttled; // stopped early because over memory budget
+};
+
+
+/**
+ * Packet copy loop (transmux) running inside wasm: Demuxer -> (optional bsf) -> Muxer(s).
+ * Demuxer and Muxers are owned by the caller, Remuxer only owns the stream mapping.
+ */
+class Remuxer {
+    struct Route {
+        Muxer* muxer;
+        int out_stream_index;
+        AVBSFContext* bsf_ctx;
+    };
+    Demuxer* demuxer;
+    map<int, vector<Route>> routes; // input stream index -> outputs
+    Packet packet;      // packet read from demuxer
+    Packet ref_packet;  // extra reference when one input goes to several outputs
+    Packet bsf_packet;  // output of bitstream filter
+    int64_t time_offset = 0; // in AV_TIME_BASE
+    bool end = false;
+
+    void writeRoute(Route& route, Packet* pkt);
+    void flushRoutes();
+
+public:
+    Remuxer(Demuxer* demuxer) { this->demuxer = demuxer; }
+    ~Remuxer();
+
+    /**
+     * @brief map an input stream to an output stream, should be called before Muxer::writeHeader.
+     * 
+     * @param bsf_name bitstream filter applied on the way (e.g. h264_mp4toannexb), empty for none
+     */
+    void addStream(int in_stream_index, Muxer* muxer, int out_stream_index, string bsf_name);
+
+    /* offset (seconds) added to all timestamps of output packets */
+    void setTimeOffset(double seconds) { time_offset = (int64_t)(seconds * AV_TIME_BASE); }
+
+    /* async, process until max_packets or max_bytes reached, or end of input */
+    RemuxStatus process(int max_packets, int max_bytes);
+};
+
+
+#endif
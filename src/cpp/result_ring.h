@@ -0,0 +1,150 @@
+#ifndef RESULT_RING_H
+#define RESULT_RING_H
+
+#include <cstdint>
+#include <vector>
+#ifdef __EMSCRIPTEN__
+#include <emscripten/val.h>
+#endif
+
+#include "frame.h"
+#include "packet.h"
+#include "utils.h"
+
+
+/**
+ * Caller-owned output buffer of Decoder/Encoder/Filterer, as struct-of-arrays,
+ * so that JS reads a whole batch through typed array views instead of embind vectors.
+ * Items (Frame/Packet) are owned by the ring until `take`n, remaining ones are deleted by `clear`.
+ * 
+ * With a sink (JS callback `sink(ring)`), a full ring is passed to the sink and then cleared,
+ * otherwise the ring grows (views should be taken again after each call).
+ * 
+ * Arrays: handles (pointer of item), pts/dts/duration (AV_TIME_BASE), 
+ *  sizes (packet bytes or audio nb_samples), keys (0/1), data (pointer of packet data or first plane).
+ */
+template<typename T>
+class ResultRing {
+    int capacity;
+    std::vector<T*> items;
+    std::vector<uint32_t> handles;
+    std::vector<double> pts;
+    std::vector<double> dts;
+    std::vector<double> durations;
+    std::vector<int32_t> sizes;
+    std::vector<int32_t> keys;
+    std::vector<uint32_t> data;
+#ifdef __EMSCRIPTEN__
+    emscripten::val sink = emscripten::val::undefined();
+#endif
+
+    void reserve(int n) {
+        items.reserve(n);
+        handles.reserve(n);
+        pts.reserve(n);
+        dts.reserve(n);
+        durations.reserve(n);
+        sizes.reserve(n);
+        keys.reserve(n);
+        data.reserve(n);
+    }
+
+    void pushFields(Frame* f) {
+        auto av_frame = f->av_ptr();
+        pts.push_back(av_frame->pts);
+        dts.push_back(av_frame->pkt_dts);
+        durations.push_back(av_frame->pkt_duration);
+        sizes.push_back(av_frame->nb_samples);
+        keys.push_back(av_frame->key_frame);
+        data.push_back((uint32_t)(uintptr_t)av_frame->data[0]);
+    }
+
+    void pushFields(Packet* p) {
+        auto av_pkt = p->av_packet();
+        pts.push_back(av_pkt->pts);
+        dts.push_back(av_pkt->dts);
+        durations.push_back(av_pkt->duration);
+        sizes.push_back(av_pkt->size);
+        keys.push_back((av_pkt->flags & AV_PKT_FLAG_KEY) ? 1 : 0);
+        data.push_back((uint32_t)(uintptr_t)av_pkt->data);
+    }
+
+public:
+    ResultRing(int capacity) {
+        this->capacity = capacity > 0 ? capacity : 1;
+        reserve(this->capacity);
+    }
+    ~ResultRing() { clear(); }
+
+    int size() const { return items.size(); }
+
+    void push(T* item) {
+#ifdef __EMSCRIPTEN__
+        if ((int)items.size() >= capacity && !sink.isUndefined()) {
+            sink(emscripten::val(this, emscripten::allow_raw_pointers()));
+            clear();
+        }
+#endif
+        items.push_back(item);
+        handles.push_back((uint32_t)(uintptr_t)item);
+        pushFields(item);
+    }
+
+    void push(const std::vector<T*>& vec) {
+        for (auto item : vec) push(item);
+    }
+
+    /* item i, still owned by the ring (NULL if taken) */
+    T* at(int i) const {
+        CHECK(i >= 0 && i < (int)items.size(), "ResultRing: index out of range");
+        return items[i];
+    }
+
+    /* release ownership of item i to caller */
+    T* take(int i) {
+        CHECK(i >= 0 && i < (int)items.size(), "ResultRing: index out of range");
+        auto item = items[i];
+        items[i] = NULL;
+        handles[i] = 0;
+        return item;
+    }
+
+    void clear() {
+        for (auto item : items)
+            if (item != NULL) delete item;
+        items.clear();
+        handles.clear();
+        pts.clear();
+        dts.clear();
+        durations.clear();
+        sizes.clear();
+        keys.clear();
+        data.clear();
+    }
+
+#ifdef __EMSCRIPTEN__
+    void setSink(emscripten::val _sink) { sink = std::move(_sink); }
+
+    /* pass remaining items to sink */
+    void flushSink() {
+        if (items.size() > 0 && !sink.isUndefined()) {
+            sink(emscripten::val(this, emscripten::allow_raw_pointers()));
+            clear();
+        }
+    }
+
+    emscripten::val handlesView() { return emscripten::val(emscripten::typed_memory_view(handles.size(), handles.data())); }
+    emscripten::val ptsView() { return emscripten::val(emscripten::typed_memory_view(pts.size(), pts.data())); }
+    emscripten::val dtsView() { return emscripten::val(emscripten::typed_memory_view(dts.size(), dts.data())); }
+    emscripten::val durationsView() { return emscripten::val(emscripten::typed_memory_view(durations.size(), durations.data())); }
+    emscripten::val sizesView() { return emscripten::val(emscripten::typed_memory_view(sizes.size(), sizes.data())); }
+    emscripten::val keysView() { return emscripten::val(emscripten::typed_memory_view(keys.size(), keys.data())); }
+    emscripten::val dataView() { return emscripten::val(emscripten::typed_memory_view(data.size(), data.data())); }
+#endif
+};
+
+typedef ResultRing<Frame> FrameRing;
+typedef ResultRing<Packet> PacketRing;
+
+
+#endif
@@ -0,0 +1,95 @@
+#include "scene.h"
+#include <cstdlib>
+
+
+SceneDetector::SceneDetector(Demuxer* demuxer, int stream_index, SceneOptions options) {
+    CHECK(demuxer->av_stream(stream_index)->codecpar->codec_type == AVMEDIA_TYPE_VIDEO, 
+        "SceneDetector: only video stream");
+    this->demuxer = demuxer;
+    this->stream_index = stream_index;
+    this->options = options;
+    decoder = new Decoder(demuxer, stream_index, "scene");
+    if (options.keyframes_only || options.lowres > 0) {
+        DecodeMode mode = {};
+        mode.lowres = options.lowres;
+        mode.skip_frame = options.keyframes_only ? "nonkey" : "";
+        decoder->setDecodeMode(mode);
+    }
+    thumb.resize(THUMB_WIDTH * THUMB_HEIGHT);
+    prev_thumb.resize(THUMB_WIDTH * THUMB_HEIGHT);
+}
+
+
+/* sum of absolute differences, integer reduction is auto-vectorized (SIMD build) */
+static uint32_t sad(const uint8_t* a, const uint8_t* b, int n) {
+    uint32_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += abs((int)a[i] - (int)b[i]);
+    return sum;
+}
+
+
+template<int BINS>
+static void histogram(const uint8_t* data, int n, uint32_t* hist) {
+    for (int i = 0; i < BINS; i++) hist[i] = 0;
+    for (int i = 0; i < n; i++)
+        hist[data[i] * BINS / 256]++;
+}
+
+
+void SceneDetector::analyze(Frame* frame) {
+    auto f = frame->av_ptr();
+    // any size/format (e.g. lowres, format change) to small gray thumbnail
+    sws_ctx = sws_getCachedContext(sws_ctx, f->width, f->height, (AVPixelFormat)f->format, 
+        THUMB_WIDTH, THUMB_HEIGHT, AV_PIX_FMT_GRAY8, SWS_AREA, NULL, NULL, NULL);
+    CHECK(sws_ctx != NULL, "SceneDetector: cannot create scaler");
+    uint8_t* dst[4] = {thumb.data(), NULL, NULL, NULL};
+    int dst_linesize[4] = {THUMB_WIDTH, 0, 0, 0};
+    sws_scale(sws_ctx, f->data, f->linesize, 0, f->height, dst, dst_linesize);
+
+    auto time = frame->pts() / (double)AV_TIME_BASE;
+    if (has_prev) {
+        const int n = THUMB_WIDTH * THUMB_HEIGHT;
+        auto sad_score = sad(thumb.data(), prev_thumb.data(), n) / (255.0 * n);
+        uint32_t hist[BINS], prev_hist[BINS];
+        histogram<BINS>(thumb.data(), n, hist);
+        histogram<BINS>(prev_thumb.data(), n, prev_hist);
+        // half of L1 distance of normalized histograms is in 0~1
+        uint32_t diff = 0;
+        for (int i = 0; i < BINS; i++)
+            diff += abs((int)hist[i] - (int)prev_hist[i]);
+        auto hist_score = diff / (2.0 * n);
+        auto score = (sad_score + hist_score) / 2;
+        if (score >= options.threshold && time - last_cut >= options.min_duration) {
+            cuts.push_back({ .time = time, .score = score });
+            last_cut = time;
+        }
+    }
+    std::swap(thumb, prev_thumb);
+    has_prev = true;
+}
+
+
+RemuxStatus SceneDetector::process(int max_packets) {
+    RemuxStatus status = {.packets = 0, .bytes = 0, .end = end, .throttled = false};
+    while (!end && status.packets < max_packets) {
+        if (!demuxer->readInto(&packet)) {
+            for (auto frame : decoder->flush()) {
+                analyze(frame);
+                delete frame;
+            }
+            end = true;
+            break;
+        }
+        status.packets++;
+        status.bytes += packet.size();
+        if (packet.stream_index() != stream_index) continue;
+        for (auto frame : decoder->decode(&packet)) {
+            analyze(frame);
+            delete frame;
+        }
+    }
+    status.end = end;
+
+    return status;
+}
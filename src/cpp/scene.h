@@ -0,0 +1,76 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <vector>
+extern "C" {
+    #include <libswscale/swscale.h>
+}
+
+#include "packet.h"
+#include "frame.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "remuxer.h"
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * threshold: score (0~1) above which a frame starts a new scene
+ * min_duration: seconds, cuts closer to the previous one are ignored
+ * keyframes_only: decode only key frames (skip_frame=nonkey), cuts are then at key frames
+ * lowres: decode at 1/2^lowres size (codecs supporting it)
+ */
+struct SceneOptions {
+    double threshold;
+    double min_duration;
+    bool keyframes_only;
+    int lowres;
+};
+
+struct SceneCut {
+    double time;    // seconds, first frame of the new scene
+    double score;
+};
+
+
+/**
+ * Scene change (shot boundary) detection of a video stream, inside wasm (no frame exported).
+ * Each frame is reduced to a small luma thumbnail, score to previous frame is the mean of
+ * normalized sum of absolute differences (motion, cuts) and luma histogram difference (robust to motion).
+ */
+class SceneDetector {
+    static const int THUMB_WIDTH = 64;
+    static const int THUMB_HEIGHT = 36;
+    static const int BINS = 32;
+    SceneOptions options;
+    Demuxer* demuxer;
+    int stream_index;
+    Decoder* decoder;
+    SwsContext* sws_ctx = NULL;
+    vector<uint8_t> thumb;
+    vector<uint8_t> prev_thumb;
+    bool has_prev = false;
+    vector<SceneCut> cuts;
+    double last_cut = -1e9;
+    Packet packet;
+    bool end = false;
+
+    void analyze(Frame* frame);
+
+public:
+    SceneDetector(Demuxer* demuxer, int stream_index, SceneOptions options);
+    ~SceneDetector() {
+        sws_freeContext(sws_ctx);
+        delete decoder;
+    }
+
+    /* async, read at most max_packets packets */
+    RemuxStatus process(int max_packets);
+
+    /* cuts found so far */
+    vector<SceneCut> getCuts() const { return cuts; }
+};
+
+
+#endif
@@ -0,0 +1,249 @@
+#include "smart_cut.h"
+
+
+SmartCutter::~SmartCutter() {
+    for (auto& [_, s] : streams) {
+        for (auto pkt : s.gop)
+            delete pkt;
+        for (auto pkt : s.prev)
+            delete pkt;
+    }
+}
+
+
+void SmartCutter::addStream(int in_stream_index, Muxer* muxer, int out_stream_index) {
+    auto codecpar = demuxer->av_stream(in_stream_index)->codecpar;
+    CHECK(streams.count(in_stream_index) == 0, "SmartCutter: input stream already added");
+    streams[in_stream_index] = {
+        .in_stream_index = in_stream_index,
+        .muxer = muxer,
+        .out_stream_index = out_stream_index,
+        .video = codecpar->codec_type == AVMEDIA_TYPE_VIDEO,
+        .done = false,
+        .gop = {},
+        .gop_end = AV_NOPTS_VALUE,
+        .prev = {},
+        .prev_mode = GOP_SKIPPED,
+        .tail = false,
+        .delay = -1,
+        .last_dts = AV_NOPTS_VALUE,
+        .extradata = ExtradataKeeper(codecpar),
+    };
+}
+
+
+/* rebase to start, and keep dts increasing across copied and re-encoded parts */
+void SmartCutter::writePacket(CutStream& s, Packet* pkt, bool reencoded) {
+    auto av_pkt = pkt->av_packet();
+    if (reencoded) s.extradata.reencoded(av_pkt);
+    else s.extradata.copied(av_pkt);
+    // re-encoded packets have no reordering (dts == pts), shift dts as source does
+    if (reencoded && av_pkt->pts != AV_NOPTS_VALUE)
+        av_pkt->dts = av_pkt->pts - FFMAX(s.delay, 0);
+    if (av_pkt->pts != AV_NOPTS_VALUE) av_pkt->pts -= start;
+    if (av_pkt->dts != AV_NOPTS_VALUE) {
+        av_pkt->dts -= start;
+        // compare in output time base (muxer rescales), and step by one tick of it
+        auto tb = s.muxer->av_stream(s.out_stream_index)->time_base;
+        if (s.last_dts != AV_NOPTS_VALUE && 
+            av_rescale_q(av_pkt->dts, AV_TIME_BASE_Q, tb) <= av_rescale_q(s.last_dts, AV_TIME_BASE_Q, tb))
+            av_pkt->dts = s.last_dts + av_rescale_q_rnd(1, tb, AV_TIME_BASE_Q, AV_ROUND_UP);
+        if (av_pkt->pts != AV_NOPTS_VALUE && av_pkt->dts > av_pkt->pts)
+            av_pkt->pts = av_pkt->dts;
+        s.last_dts = av_pkt->dts;
+    }
+    s.muxer->writeFrame(pkt, s.out_stream_index);
+}
+
+
+/* new reference of a buffered packet (decoder and muxer change/take packets, buffered ones may be used again) */
+static Packet* refPacket(Packet* pkt) {
+    auto ref = new Packet();
+    auto ret = av_packet_ref(ref->av_packet(), pkt->av_packet());
+    CHECK(ret >= 0, "SmartCutter: cannot reference packet");
+    return ref;
+}
+
+
+/* decode packets, and re-encode frames in [from, to) of range */
+void SmartCutter::reencode(CutStream& s, const vector<Packet*>& pkts, int64_t from, int64_t to) {
+    auto decoder = new Decoder(demuxer, s.in_stream_index, "");
+    auto encoder = new Encoder(demuxer->av_stream(s.in_stream_index));
+    auto writeAll = [&](vector<Packet*> pkts) {
+        for (auto pkt : pkts) {
+            writePacket(s, pkt, true);
+            delete pkt;
+        }
+    };
+    auto encodeInRange = [&](vector<Frame*> frames) {
+        for (auto frame : frames) {
+            if (frame->pts() >= start && frame->pts() >= from && frame->pts() < end && frame->pts() < to)
+                writeAll(encoder->encode(frame));
+            delete frame;
+        }
+    };
+    for (auto pkt : pkts) {
+        auto ref = refPacket(pkt);
+        encodeInRange(decoder->decode(ref));
+        delete ref;
+    }
+    encodeInRange(decoder->flush());
+    writeAll(encoder->flush());
+    delete encoder;
+    delete decoder;
+}
+
+
+/**
+ * Decide how the buffered GOP [key pts, gop_end) goes to output (last: no GOP follows).
+ * Leading pictures (pts < key pts) reference the previous GOP: they are copied after a copied GOP,
+ * otherwise decoded from the previous GOP packets (kept until the next flush) and re-encoded.
+ * A GOP crossing start waits for the next one, to be re-encoded together with its leading pictures.
+ */
+void SmartCutter::flushGop(CutStream& s, int64_t gop_end, bool last) {
+    if (s.gop.empty()) return;
+    auto key_pts = s.gop[0]->av_packet()->pts;
+    auto isLeading = [&](Packet* pkt) { return pkt->av_packet()->pts < key_pts; };
+    vector<Packet*> leading_refs = s.prev;  // previous GOP + key frame + leading pictures
+    auto has_leading = false;
+    auto leading_in_range = false;
+    for (auto pkt : s.gop) {
+        if (pkt != s.gop[0] && !isLeading(pkt)) continue;
+        leading_refs.push_back(pkt);
+        has_leading = has_leading || pkt != s.gop[0];
+        leading_in_range = leading_in_range || (pkt != s.gop[0] && pkt->av_packet()->pts >= start && pkt->av_packet()->pts < end);
+    }
+    // frames of a copied previous GOP are already in output
+    int64_t prev_max = INT64_MIN;
+    for (auto pkt : s.prev)
+        prev_max = FFMAX(prev_max, pkt->av_packet()->pts);
+    
+    if (s.prev_mode == GOP_PENDING) {
+        reencode(s, leading_refs, INT64_MIN, key_pts);
+        s.prev_mode = GOP_REENCODED;
+    }
+    auto mode = GOP_REENCODED;
+    if (gop_end <= start) {
+        // before range (demuxer seeks to a previous key frame)
+        mode = GOP_SKIPPED;
+    }
+    else if (key_pts >= start && gop_end <= end) {
+        // leading pictures in range after a skipped GOP (lost if it has not been read)
+        if (s.prev_mode == GOP_SKIPPED && leading_in_range)
+            reencode(s, leading_refs, INT64_MIN, key_pts);
+        for (auto pkt : s.gop) {
+            if (s.prev_mode != GOP_COPIED && isLeading(pkt))
+                continue;
+            auto ref = refPacket(pkt);
+            writePacket(s, ref, false);
+            delete ref;
+        }
+        mode = GOP_COPIED;
+    }
+    else if (key_pts < start && gop_end <= end && !last) {
+        mode = GOP_PENDING;
+    }
+    else {
+        // leading pictures are already re-encoded after a re-encoded GOP
+        auto from = s.prev_mode == GOP_REENCODED ? key_pts : s.prev_mode == GOP_COPIED ? prev_max + 1 : INT64_MIN;
+        auto in_range = false;
+        for (auto pkt : s.gop) {
+            auto pts = pkt->av_packet()->pts;
+            in_range = in_range || (pts >= start && pts >= from && pts < end);
+        }
+        if (in_range) {
+            vector<Packet*> pkts = s.prev_mode == GOP_REENCODED || !has_leading ? vector<Packet*>() : s.prev;
+            pkts.insert(pkts.end(), s.gop.begin(), s.gop.end());
+            reencode(s, pkts, from, INT64_MAX);
+        }
+    }
+    for (auto pkt : s.prev)
+        delete pkt;
+    s.prev = s.gop;
+    s.prev_mode = mode;
+    s.gop.clear();
+    s.gop_end = AV_NOPTS_VALUE;
+}
+
+
+void SmartCutter::onVideoPacket(CutStream& s) {
+    auto av_pkt = packet.av_packet();
+    auto key = (av_pkt->flags & AV_PKT_FLAG_KEY) != 0;
+    if (s.tail) {
+        // no leading picture after a packet decoded later than the key frame is displayed
+        auto t = av_pkt->dts != AV_NOPTS_VALUE ? av_pkt->dts : av_pkt->pts;
+        if (key || t > s.gop[0]->av_packet()->pts) {
+            flushGop(s, s.gop_end, true);
+            s.done = true;
+            return;
+        }
+    }
+    else if (key) {
+        if (s.delay < 0 && av_pkt->pts != AV_NOPTS_VALUE && av_pkt->dts != AV_NOPTS_VALUE)
+            s.delay = FFMAX(av_pkt->pts - av_pkt->dts, 0);
+        flushGop(s, av_pkt->pts, false);
+        // leading pictures of the GOP at end may still be in range
+        s.tail = av_pkt->pts >= end;
+    }
+    // wait for the first key frame
+    if (s.gop.empty() && !key) return;
+    auto pkt = new Packet();
+    av_packet_move_ref(pkt->av_packet(), av_pkt);
+    auto pkt_end = pkt->av_packet()->pts + pkt->av_packet()->duration;
+    s.gop_end = s.gop_end == AV_NOPTS_VALUE ? pkt_end : FFMAX(s.gop_end, pkt_end);
+    s.gop.push_back(pkt);
+}
+
+
+RemuxStatus SmartCutter::process(int max_packets, int max_bytes) {
+    RemuxStatus status = {.packets = 0, .bytes = 0, .end = finished, .throttled = false};
+    if (!started) {
+        demuxer->seek(start, -1);
+        started = true;
+    }
+
+    while (!finished && status.packets < max_packets && status.bytes < max_bytes) {
+        // backpressure: at least one packet each call, so that caller can drain outputs
+        if (status.packets > 0 && overMemoryBudget()) {
+            for (auto& [_, s] : streams)
+                s.muxer->flushInterleave();
+            if (overMemoryBudget()) {
+                status.throttled = true;
+                break;
+            }
+        }
+        auto all_done = true;
+        for (auto& [_, s] : streams)
+            all_done = all_done && s.done;
+        if (all_done) {
+            finished = true;
+            break;
+        }
+        if (!demuxer->readInto(&packet)) {
+            // last GOPs end at end of file
+            for (auto& [_, s] : streams)
+                flushGop(s, s.gop_end, true);
+            finished = true;
+            break;
+        }
+        auto av_pkt = packet.av_packet();
+        status.packets++;
+        status.bytes += av_pkt->size;
+        auto it = streams.find(av_pkt->stream_index);
+        if (it == streams.end() || it->second.done || av_pkt->pts == AV_NOPTS_VALUE) {
+            av_packet_unref(av_pkt);
+            continue;
+        }
+        auto& s = it->second;
+        if (s.video)
+            onVideoPacket(s);
+        else if (av_pkt->pts >= end)
+            s.done = true;
+        else if (av_pkt->pts >= start)
+            writePacket(s, &packet, false);
+        av_packet_unref(av_pkt);
+    }
+    status.end = finished;
+
+    return status;
+}
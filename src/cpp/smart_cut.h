@@ -0,0 +1,88 @@
+#ifndef SMART_CUT_H
+#define SMART_CUT_H
+
+#include <map>
+#include <vector>
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+#include "packet.h"
+#include "demuxer.h"
+#include "decode.h"
+#include "encode.h"
+#include "muxer.h"
+#include "remuxer.h"
+#include "bitstream.h"
+#include "utils.h"
+using namespace std;
+
+
+/**
+ * Trim [start, end) of a Demuxer into Muxer(s), re-encoding only at the cut boundaries.
+ * 
+ * Video packets are buffered per GOP (key frame to key frame). A GOP fully inside the range
+ * is stream-copied, a GOP crossing start/end is decoded and only its frames in range are
+ * re-encoded (Encoder matched to source stream, no B-frames). Leading pictures of open GOPs
+ * (pts before their key frame, e.g. HEVC CRA, x264 open-gop) are copied after a copied GOP,
+ * otherwise decoded with the previous GOP and re-encoded. Other streams are copied
+ * packet by packet. All output timestamps are rebased to start at 0.
+ * H.264/HEVC in avcC/hvcC keep the source extradata: re-encoded parts carry their own
+ * parameter sets in-band, and source ones are repeated when copying resumes.
+ * Output streams should be created from the source streams (Muxer::newStream(demuxer, index)).
+ * Demuxer and Muxers are owned by the caller.
+ */
+class SmartCutter {
+    /* how a GOP went to output */
+    enum GopMode {
+        GOP_SKIPPED,    // before range
+        GOP_COPIED,
+        GOP_PENDING,    // crossing start, re-encoded with leading pictures of the next GOP
+        GOP_REENCODED,
+    };
+    struct CutStream {
+        int in_stream_index;
+        Muxer* muxer;
+        int out_stream_index;
+        bool video;
+        bool done;
+        vector<Packet*> gop;    // packets since last key frame (video)
+        int64_t gop_end;        // max pts + duration in gop
+        vector<Packet*> prev;   // packets of previous GOP (references of leading pictures of open GOPs)
+        GopMode prev_mode;
+        bool tail;              // buffering leading pictures of the GOP at end
+        int64_t delay;          // pts - dts of source key frames (B-frames reorder delay)
+        int64_t last_dts;
+        ExtradataKeeper extradata;
+    };
+    Demuxer* demuxer;
+    map<int, CutStream> streams; // input stream index -> output
+    Packet packet;
+    int64_t start;  // in AV_TIME_BASE
+    int64_t end;
+    bool started = false;
+    bool finished = false;
+
+    void writePacket(CutStream& s, Packet* pkt, bool reencoded);
+    void onVideoPacket(CutStream& s);
+    void flushGop(CutStream& s, int64_t gop_end, bool last);
+    void reencode(CutStream& s, const vector<Packet*>& pkts, int64_t from, int64_t to);
+
+public:
+    /* start/end in seconds */
+    SmartCutter(Demuxer* demuxer, double start, double end) {
+        this->demuxer = demuxer;
+        this->start = (int64_t)(start * AV_TIME_BASE);
+        this->end = (int64_t)(end * AV_TIME_BASE);
+    }
+    ~SmartCutter();
+
+    /* map an input stream to an output stream, should be called before Muxer::writeHeader */
+    void addStream(int in_stream_index, Muxer* muxer, int out_stream_index);
+
+    /* async, process until max_packets or max_bytes read, or end of range */
+    RemuxStatus process(int max_packets, int max_bytes);
+};
+
+
+#endif
@@ -0,0 +1,120 @@
+#include "speed.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+
+static SpeedTarget default_target = {
+    .speed = 0,
+    .headroom = 0.3,
+    .window = 2,
+    .level = -1,
+};
+
+void setDefaultSpeedTarget(SpeedTarget target) { default_target = target; }
+
+SpeedTarget getDefaultSpeedTarget() { return default_target; }
+
+
+static const int NB_LEVELS = 9;
+static const char* x264_presets[NB_LEVELS] = {
+    "veryslow", "slower", "slow", "medium", "fast", "faster", "veryfast", "superfast", "ultrafast"};
+static const struct { const char* deadline; int cpu_used; } vpx_speeds[NB_LEVELS] = {
+    {"good", 0}, {"good", 1}, {"good", 2}, {"good", 3}, {"good", 4}, {"good", 5}, 
+    {"realtime", 6}, {"realtime", 7}, {"realtime", 8}};
+
+
+bool SpeedController::supported(const AVCodec* codec) {
+    return strcmp(codec->name, "libx264") == 0 || strcmp(codec->name, "libvpx") == 0 || 
+        strcmp(codec->name, "libvpx-vp9") == 0;
+}
+
+
+SpeedController::SpeedController(const AVCodec* codec, SpeedTarget target) {
+    this->target = target;
+    x264 = strcmp(codec->name, "libx264") == 0;
+    level = target.level >= 0 ? std::min(target.level, NB_LEVELS - 1) : (x264 ? 3 : 1);
+    prev_level = level;
+}
+
+
+bool SpeedController::setTarget(SpeedTarget target) {
+    this->target = target;
+    window_start = AV_NOPTS_VALUE;
+    window_time = 0;
+    if (locked || target.level < 0 || std::min(target.level, NB_LEVELS - 1) == level) return false;
+    prev_level = level;
+    prev_history = history.size();
+    level = std::min(target.level, NB_LEVELS - 1);
+    return true;
+}
+
+
+void SpeedController::apply(AVCodecContext* codec_ctx, AVDictionary** options) const {
+    if (x264) {
+        av_dict_set(options, "preset", x264_presets[level], 0);
+        /* Stream headers (SPS/PPS) are written once by muxer, and DTS must keep going across reopens,
+         * so what presets change of them (references, B-frames, entropy coding...) is pinned to medium's. */
+        auto bframes = codec_ctx->max_b_frames >= 0 ? codec_ctx->max_b_frames : 3;
+        auto params = "ref=3:bframes=" + to_string(bframes) + 
+            ":b-pyramid=normal:cabac=1:8x8dct=1:weightp=2:weightb=1";
+        /* psy-rd lowers chroma_qp_index_offset by 2, but is only used with subme >= 6 (up to preset fast) */
+        if (level > 4)
+            params += ":chroma-qp-offset=-2";
+        av_dict_set(options, "x264-params", params.c_str(), 0);
+    }
+    else {
+        av_dict_set(options, "deadline", vpx_speeds[level].deadline, 0);
+        av_dict_set_int(options, "cpu-used", vpx_speeds[level].cpu_used, 0);
+    }
+}
+
+
+string SpeedController::setting() const {
+    if (x264) return string("preset=") + x264_presets[level];
+    return string("deadline=") + vpx_speeds[level].deadline + ":cpu-used=" + to_string(vpx_speeds[level].cpu_used);
+}
+
+
+void SpeedController::record(int64_t pts, double speed) {
+    history.push_back({ .time = pts / (double)AV_TIME_BASE, .level = level, .setting = setting(), .speed = speed });
+}
+
+
+bool SpeedController::next(int64_t pts) {
+    if (window_start == AV_NOPTS_VALUE) {
+        window_start = pts;
+        record(pts, 0);
+        return false;
+    }
+    if (target.speed <= 0 || locked) return false;
+    // restart window when pts goes back (e.g. concat)
+    if (pts < window_start) {
+        window_start = pts;
+        window_time = 0;
+        return false;
+    }
+    auto media_time = (pts - window_start) / 1000.0;
+    if (media_time < target.window * 1000) return false;
+    auto speed = window_time > 0 ? media_time / window_time : INFINITY;
+    window_start = pts;
+    window_time = 0;
+    auto next_level = level;
+    if (speed < target.speed)
+        next_level = std::min(level + 1, NB_LEVELS - 1);
+    else if (speed > target.speed * (1 + target.headroom))
+        next_level = std::max(level - 1, 0);
+    if (next_level == level) return false;
+    prev_level = level;
+    prev_history = history.size();
+    level = next_level;
+    record(pts, std::isinf(speed) ? 0 : speed);
+    return true;
+}
+
+
+void SpeedController::reject() {
+    history.resize(prev_history);
+    level = prev_level;
+    locked = true;
+}
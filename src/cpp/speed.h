@@ -0,0 +1,76 @@
+#ifndef SPEED_H
+#define SPEED_H
+
+#include <string>
+#include <vector>
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/dict.h>
+}
+using namespace std;
+
+
+/**
+ * Throughput target of video encoders (libx264, libvpx), for encoders created afterwards
+ * (default) or set to an Encoder.
+ * Encode time is measured over windows of `window` seconds of media. At the end of a window, the
+ * speed level is stepped up (faster) when slower than `speed` x realtime, or down when faster
+ * than `speed * (1 + headroom)`. Encoder is reopened at the new level, starting a new GOP.
+ * Levels 0~8, slowest to fastest:
+ * - libx264: preset veryslow ~ ultrafast, with what goes in SPS/PPS pinned to medium's (references,
+ *   B-frames, CABAC, 8x8 transform, weighted prediction, chroma QP offset), so levels only change
+ *   analysis (motion search, subpel, trellis, lookahead...) and span much less than the presets do.
+ * - libvpx: deadline good with cpu-used 0~5, then realtime with cpu-used 6~8
+ * A level whose stream headers (extradata) differ from the ones the muxer wrote is refused, and
+ * the encoder stops adapting.
+ */
+struct SpeedTarget {
+    double speed;       // x realtime, 0 disables
+    double headroom;    // e.g. 0.3
+    double window;      // seconds
+    int level;          // initial, -1 for codec default (x264 medium, vpx good/1)
+};
+
+struct SpeedChange {
+    double time;        // seconds, pts of first frame encoded at this level
+    int level;
+    string setting;     // e.g. "preset=veryfast", "deadline=good:cpu-used=4"
+    double speed;       // measured over the window before the change (x realtime), 0 for the initial level
+};
+
+void setDefaultSpeedTarget(SpeedTarget target);
+SpeedTarget getDefaultSpeedTarget();
+
+
+// only for c++
+class SpeedController {
+    SpeedTarget target;
+    bool x264;
+    int level;
+    int prev_level;
+    size_t prev_history = 0;
+    bool locked = false;    // a level was refused, keep the current one
+    int64_t window_start = AV_NOPTS_VALUE;
+    double window_time = 0; // milliseconds of encoding in current window
+    vector<SpeedChange> history;
+
+    void record(int64_t pts, double speed);
+
+public:
+    SpeedController(const AVCodec* codec, SpeedTarget target);
+    /* new target from next frame, return true when level changed (encoder must be reopened) */
+    bool setTarget(SpeedTarget target);
+    static bool supported(const AVCodec* codec);
+    /* options of current level, before opening encoder */
+    void apply(AVCodecContext* codec_ctx, AVDictionary** options) const;
+    /* before encoding frame (pts in AV_TIME_BASE), return true when level changed (encoder must be reopened) */
+    bool next(int64_t pts);
+    /* last level change could not be applied (stream headers changed): back to previous level and stop adapting */
+    void reject();
+    void addTime(double ms) { window_time += ms; }
+    string setting() const;
+    vector<SpeedChange> getHistory() const { return history; }
+};
+
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Bounded lock-free queue between one producer thread and one consumer thread (Pipeline stages).
+ * Capacity is rounded up to a power of 2. push/pop never block, callers wait with `QueueWait`.
+ */
+template<typename T>
+class SPSCQueue {
+    std::vector<T> items;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head {0}; // next write, by producer
+    alignas(64) std::atomic<size_t> tail {0}; // next read, by consumer
+
+public:
+    SPSCQueue(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        items.resize(n);
+        mask = n - 1;
+    }
+
+    /* false if full */
+    bool push(const T& item) {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) return false;
+        items[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* false if empty */
+    bool pop(T& item) {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = items[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const { 
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); 
+    }
+};
+
+
+/* back off while a queue is full/empty: spin first, then yield, then sleep (idle stage) */
+class QueueWait {
+    int spins = 0;
+public:
+    void operator()() {
+        spins++;
+        if (spins < 64) return;
+        if (spins < 1024) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+};
+
+
+#endif
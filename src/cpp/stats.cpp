@@ -0,0 +1,8 @@
+#include "stats.h"
+
+
+bool stats_enabled = false;
+
+void enableStats(bool enable) {
+    stats_enabled = enable;
+}
@@ -0,0 +1,97 @@
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#include <chrono>
+#endif
+#include <cstdint>
+#include <map>
+
+
+/**
+ * Cumulative counters of a stage (Demuxer, Decoder, Filterer, Encoder, Muxer).
+ * Use double to be plain number in JS. Times (and latencies) are in milliseconds.
+ */
+struct Stats {
+    double packets;
+    double frames;
+    double bytes;
+    double calls;       // calls into FFmpeg (read_frame, send/receive, buffersrc/sink, write_frame)
+    double process_time; // time inside those calls (including io_time)
+    double io_time;     // time awaiting reader/writer (read_packet/write_packet)
+    double allocs;      // Packet/Frame allocated by the stage
+    double latency;     // of the last output (see LatencyTracker/LatencyTimer)
+    double max_latency;
+};
+
+
+/* timers are disabled by default, counters always accumulate */
+extern bool stats_enabled;
+void enableStats(bool enable);
+inline bool statsEnabled() { return stats_enabled; }
+
+inline double stats_now() {
+#ifdef __EMSCRIPTEN__
+    return emscripten_get_now();
+#else
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/* add elapsed time of current scope to target (only when enabled) */
+class StatsTimer {
+    double* target;
+    double start = 0;
+public:
+    StatsTimer(double& _target) : target(statsEnabled() ? &_target : NULL) {
+        if (target != NULL) start = stats_now();
+    }
+    ~StatsTimer() {
+        if (target != NULL) *target += stats_now() - start;
+    }
+};
+
+inline void recordLatency(Stats& stats, double latency) {
+    stats.latency = latency;
+    if (latency > stats.max_latency) stats.max_latency = latency;
+}
+
+/* latency of a call (Demuxer read, Muxer write): time of current scope (only when enabled) */
+class LatencyTimer {
+    Stats* stats;
+    double start = 0;
+public:
+    LatencyTimer(Stats& _stats) : stats(statsEnabled() ? &_stats : NULL) {
+        if (stats != NULL) start = stats_now();
+    }
+    ~LatencyTimer() {
+        if (stats != NULL) recordLatency(*stats, stats_now() - start);
+    }
+};
+
+/**
+ * Latency of a codec (Decoder, Encoder): time from input to output of the same timestamp,
+ * including frames buffered for reordering/lookahead.
+ * Inputs without output (e.g. discarded frames) are dropped when too many are pending.
+ */
+class LatencyTracker {
+    std::map<int64_t, double> pending;
+public:
+    void in(int64_t ts) {
+        if (!statsEnabled() || ts == INT64_MIN) return; // AV_NOPTS_VALUE
+        pending[ts] = stats_now();
+        if (pending.size() > 256) pending.erase(pending.begin());
+    }
+    void out(int64_t ts, Stats& stats) {
+        auto it = pending.find(ts);
+        if (it == pending.end()) return;
+        recordLatency(stats, stats_now() - it->second);
+        pending.erase(it);
+    }
+};
+
+
+#endif
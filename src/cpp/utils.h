@@ -3,8 +3,9 @@
 
 #define CHECK(cond, msg) assert(cond && msg)
 
+#include <cassert>
+#include <string>
 #include <vector>
-#include <emscripten/val.h>
 #include <map>
 extern "C" {
     #include <libavutil/log.h>
@@ -24,10 +25,6 @@ map<T1, T2> createMap() {
     return map<T1, T2>();
 }
 
-/* set custom (console) Logger */
-void setConsoleLogger(bool verbose);
-
-
 /* get description of channel_layout */
 string get_channel_layout_name(int channels, uint64_t channel_layout);
 
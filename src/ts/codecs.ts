@@ -4,8 +4,8 @@
  * TODO...
  */
 import { dataFormatMap, formatFF2Web, formatWeb2FF } from './metadata'
-import { getFFmpeg, vec2Array } from './transcoder.worker'
-import { ModuleType as FF, FrameInfo, StreamInfo, StdVector, DataFormat } from './types/ffmpeg'
+import { getFFmpeg, ring2Array, vec2Array } from './transcoder.worker'
+import { ModuleType as FF, FrameInfo, StreamInfo, DataFormat } from './types/ffmpeg'
 import { Log } from './utils'
 
 
@@ -178,38 +178,56 @@ export class Frame {
         return this.FFFrame
     }
 
+    /* create WebFrame (copied) from planes data of AVFrame */
+    static webFrameFromPlanes(planes: Uint8Array[], frameInfo: FrameInfo, pts: number, frameRate: number): WebFrame {
+        const data = new Uint8Array(planes.reduce((l, d) => l + d.byteLength, 0))
+        planes.reduce((offset, d) => {
+            data.set(d, offset)
+            return offset + d.byteLength
+        }, 0)
+        return Frame.webFrameFromData(data, frameInfo, pts, frameRate)
+    }
+
+    /* create WebFrame (copied) from tightly packed data (planes are contiguous) */
+    static webFrameFromData(data: Uint8Array, frameInfo: FrameInfo, pts: number, frameRate: number): WebFrame {
+        const isVideo = frameInfo.height > 0 && frameInfo.width > 0
+        if (isVideo) {
+            const init: VideoFrameBufferInit = {
+                timestamp: pts,
+                codedHeight: frameInfo.height,
+                codedWidth: frameInfo.width,
+                format: formatFF2Web('pixel', frameInfo.format),
+                duration: 1 / frameRate * 1e6
+            }
+            return new VideoFrame(data, init)
+        }
+        else {
+            const init: AudioDataInit = {
+                data,
+                timestamp: pts,
+                numberOfChannels: frameInfo.channels,
+                numberOfFrames: frameInfo.nbSamples, // todo...
+                format: formatFF2Web('sample', frameInfo.format),
+                sampleRate: frameInfo.sampleRate,
+            }
+            return new AudioData(init)
+        }
+    }
+
     toWeb(frameRate: number) {
         if (!this.WebFrame && this.FFFrame) {
-            // get planes data from AVFrame
-            const planes = vec2Array(this.FFFrame.getPlanes())
-            const data = new Uint8Array(planes.reduce((l, d) => l + d.byteLength, 0))
-            const frameInfo = this.FFFrame.getFrameInfo()
-            const isVideo = frameInfo.height > 0 && frameInfo.width > 0
-            
-            if (isVideo) {
-                const init: VideoFrameBufferInit = {
-                    timestamp: this.FFFrame.pts,
-                    codedHeight: frameInfo.height,
-                    codedWidth: frameInfo.width,
-                    format: formatFF2Web('pixel', frameInfo.format),
-                    duration: 1 / frameRate * 1e6
-                }
-                planes.reduce((offset, d) => {
-                    data.set(d, offset)
-                    return offset + d.byteLength
-                }, 0)
-                this.WebFrame = new VideoFrame(data, init)
+            // pack planes of AVFrame into wasm heap in one pass, WebCodecs copies it
+            const ffmpeg = getFFmpeg()
+            const size = this.FFFrame.copySize('', 0)
+            const ptr = ffmpeg._malloc(size)
+            try {
+                this.FFFrame.copyTo(ptr, '', 0)
+                // view after copy (heap may grow)
+                const data = ffmpeg.HEAPU8.subarray(ptr, ptr + size)
+                this.WebFrame = Frame.webFrameFromData(data, this.FFFrame.getFrameInfo(), this.FFFrame.pts, frameRate)
             }
-            else {
-                const init: AudioDataInit = {
-                    data,
-                    timestamp: this.FFFrame.pts,
-                    numberOfChannels: frameInfo.channels,
-                    numberOfFrames: frameInfo.nbSamples, // todo...
-                    format: formatFF2Web('sample', frameInfo.format),
-                    sampleRate: frameInfo.sampleRate,
-                }
-                this.WebFrame = new AudioData(init)
+            finally {
+                ffmpeg._free(ptr)
             }
         }
         if (!this.WebFrame) throw `Frame.toWeb failed`
@@ -262,6 +280,7 @@ export class Encoder {
     encoder: FF['Encoder'] | WebEncoder
     streamInfo: StreamInfo
     outputs: WebPacket[] = []
+    #ring?: FF['PacketRing']
     #dts = 0
     #frameCount = 0
     /**
@@ -290,6 +309,7 @@ export class Encoder {
             const info = getFFmpeg().Muxer.inferFormatInfo(muxFormat, '')
             const newStreamInfo = {...streamInfo, ...info[streamInfo.mediaType ?? 'audio']}
             this.encoder = new (getFFmpeg()).Encoder(newStreamInfo)
+            this.#ring = new (getFFmpeg()).PacketRing(16)
         }
     }
 
@@ -343,17 +363,43 @@ export class Encoder {
         return this.encoder instanceof getFFmpeg().Encoder ? this.encoder : undefined
     }
 
-    #getPackets(pktVec?: StdVector<FF['Packet']>) { 
-        const pkts1 = pktVec ? vec2Array(pktVec) : []
-        const pkts2 = this.outputs.splice(0, this.outputs.length)
+    #getPackets() { 
         const mediaType = this.streamInfo.mediaType
         if (!mediaType) throw `Encoder.#getPackets mediaType is undefined`
-        return [...pkts1, ...pkts2].map(p => {
-            // todo... packet pts, dts
+        const pkts: Packet[] = []
+        // todo... packet pts, dts
+        if (this.#ring) {
+            // durations of the batch from the ring view (copied, views are invalid after take/clear)
+            const durations = this.#ring.durations().slice()
+            ring2Array(this.#ring).forEach((p, i) => {
+                pkts.push(new Packet(p, this.#dts, mediaType))
+                this.#dts += durations[i]
+            })
+        }
+        for (const p of this.outputs.splice(0, this.outputs.length)) {
             const pkt = new Packet(p, this.#dts, mediaType)
             this.#dts += pkt.duration
-            return pkt
-        })
+            pkts.push(pkt)
+        }
+        return pkts
+    }
+
+    /**
+     * FFmpeg encoder only (undefined otherwise): encode a frame (flush without frame) into the output ring,
+     * for consumers of the whole batch (Muxer.writeRing, ring views), without a Packet wrapper per output.
+     * The caller clears the ring.
+     */
+    async encodeToRing(frame?: Frame) {
+        const ring = this.#ring
+        if (!(this.encoder instanceof getFFmpeg().Encoder) || !ring) return undefined
+        if (frame) {
+            this.#frameCount++
+            this.encoder.encodeInto(await frame.toFF(), ring)
+        }
+        else
+            this.encoder.flushInto(ring)
+        for (const d of ring.durations()) this.#dts += d
+        return ring
     }
 
     async encode(frame: Frame): Promise<Packet[]> {
@@ -361,8 +407,9 @@ export class Encoder {
         if (!mediaType) throw `Encoder: streamInfo.mediaType is undefined`
         this.#frameCount++
         // FFmpeg
-        if (this.encoder instanceof getFFmpeg().Encoder) {
-            return this.#getPackets(this.encoder.encode(await frame.toFF()))
+        if (this.encoder instanceof getFFmpeg().Encoder && this.#ring) {
+            this.encoder.encodeInto(await frame.toFF(), this.#ring)
+            return this.#getPackets()
         }
         // WebCodecs
         const encoder = this.encoder
@@ -387,8 +434,9 @@ export class Encoder {
     }
 
     async flush() {
-        if (this.encoder instanceof getFFmpeg().Encoder) {
-            return this.#getPackets(this.encoder.flush())
+        if (this.encoder instanceof getFFmpeg().Encoder && this.#ring) {
+            this.encoder.flushInto(this.#ring)
+            return this.#getPackets()
         }
         else {
             await this.encoder.flush()
@@ -397,6 +445,7 @@ export class Encoder {
     }
 
     close() {
+        this.#ring?.delete()
         if (this.encoder instanceof getFFmpeg().Encoder)
             this.encoder.delete()
         else
@@ -423,6 +472,7 @@ export class Decoder {
     #name: string
     decoder: FF['Decoder'] | WebDecoder
     outputs: WebFrame[] = []
+    #ring?: FF['FrameRing']
     streamInfo: StreamInfo
 
     /**
@@ -455,6 +505,7 @@ export class Decoder {
             this.decoder = demuxer ?
                 new (getFFmpeg()).Decoder(demuxer, streamInfo.index, name) :
                 new (getFFmpeg()).Decoder(streamInfo, name)
+            this.#ring = new (getFFmpeg()).FrameRing(16)
         }
     }
 
@@ -490,15 +541,16 @@ export class Decoder {
     }
 
     /* get frames from inputs or this.outputs */
-    #getFrames(frameVec?: StdVector<FF['Frame']>) {
-        const frames1 = frameVec ? vec2Array(frameVec) : []
+    #getFrames() {
+        const frames1 = this.#ring ? ring2Array(this.#ring) : []
         const frames2 = this.outputs.splice(0, this.outputs.length)
         return [...frames1, ...frames2].map(f => new Frame(f, this.#name))
     }
 
     async decode(pkt: Packet) {
-        if (this.decoder instanceof getFFmpeg().Decoder) {
-            return this.#getFrames(this.decoder.decode(pkt.toFF()))
+        if (this.decoder instanceof getFFmpeg().Decoder && this.#ring) {
+            this.decoder.decodeInto(pkt.toFF(), this.#ring)
+            return this.#getFrames()
         }
         else {
             const decoder = this.decoder
@@ -515,8 +567,9 @@ export class Decoder {
     }
 
     async flush() {
-        if (this.decoder instanceof getFFmpeg().Decoder) {
-            return this.#getFrames(this.decoder.flush())
+        if (this.decoder instanceof getFFmpeg().Decoder && this.#ring) {
+            this.decoder.flushInto(this.#ring)
+            return this.#getFrames()
         }
         else {
             await this.decoder.flush()
@@ -525,6 +578,7 @@ export class Decoder {
     }
 
     close() {
+        this.#ring?.delete()
         if (this.decoder instanceof getFFmpeg().Decoder)
             this.decoder.delete()
         else
@@ -5,7 +5,8 @@
 import Worker from 'worker-loader?inline=no-fallback!./transcoder.worker.ts'
 // @ts-ignore
 import pkgJSON from '../../package.json'
-import { FFWorker } from './message'
+import { FFWorker, WasmURL } from './message'
+import { BuildProfile } from './types/ffmpeg'
 
 // Warning: webpack 5 only support pattern: new Worker(new URL('', import.meta.url))
 // const createWorker = () => new Worker(new URL('./transcoder.worker.ts', import.meta.url))
@@ -14,6 +15,7 @@ export const createWorker = () => new Worker()
 
 
 const wasmFileName = `ffmpeg_built.wasm`
+const simdWasmFileName = `ffmpeg_built.simd.wasm`
 // production wasm from remote CDN
 let DefaultURL = `https://unpkg.com/frameflow@${pkgJSON.version}/dist/${wasmFileName}`
 
@@ -22,38 +24,88 @@ if (process.env.NODE_ENV !== 'production') {
     DefaultURL = new URL(`../wasm/ffmpeg_built.wasm`, import.meta.url).href
     console.assert(DefaultURL.includes(wasmFileName)) // keep same wasm name with prod one
 }
+// SIMD variant (built by `SIMD=1 ./build_wasm.sh`) is placed next to the default one, with its JS glue
+const SimdURL = DefaultURL.replace(wasmFileName, simdWasmFileName)
+// slim builds (built by `PROFILE=<name> ./build_wasm.sh`), e.g. ffmpeg_built.audio.wasm, ffmpeg_built.audio.simd.wasm, with their JS glue
+const profileURL = (url: string, profile: BuildProfile) =>
+    profile == 'full' ? url : url.replace(/ffmpeg_built\./, `ffmpeg_built.${profile}.`)
+/**
+ * JS glue of a wasm url, undefined for the glue bundled in the worker (default build).
+ * Each link minifies its import/export names (-O3), so a variant can only be instantiated by its own glue.
+ */
+const glueURL = (url: string) => url == DefaultURL ? undefined : url.replace(/\.wasm$/, '.js')
+const wasmURL = (url: string): WasmURL => ({ wasm: url, glue: glueURL(url) })
+
+/* smallest module using a v128 instruction, only valid when runtime supports WebAssembly SIMD */
+const simdProbe = new Uint8Array([0,97,115,109,1,0,0,0,1,5,1,96,0,1,123,3,2,1,0,10,10,1,8,0,65,0,253,15,253,98,11])
+export function simdSupported() {
+    try {
+        return WebAssembly.validate(simdProbe)
+    } catch {
+        return false
+    }
+}
 
 // store default global things here
 const defaults = {
-    wasm: undefined as Promise<ArrayBuffer> | undefined,
+    wasm: {} as {[k in BuildProfile]?: Promise<{wasm: ArrayBuffer, glue?: string}>},
     worker: undefined as Promise<FFWorker> | undefined
 }
 
-function loadWASM(url: RequestInfo = DefaultURL) {
-    if (defaults.wasm) return defaults.wasm    
+async function fetchWASM(url: RequestInfo) {
+    const res = await fetch(url)
+    if (!res.ok) throw `WASM binary fetch failed.`
+    return res.arrayBuffer()
+}
+
+/* urls of full build, SIMD one first if supported */
+function fullURLs(simd = simdSupported()) {
+    return simd ? [SimdURL, DefaultURL] : [DefaultURL]
+}
+
+/**
+ * Without given url, pick SIMD build if supported (fallback to default one if not found),
+ * and slim build of profile (fallback to full one if not found).
+ */
+function loadWASM(url?: RequestInfo, simd = simdSupported(), profile: BuildProfile = 'full') {
+    const cached = defaults.wasm[profile]
+    if (cached) return cached
     console.log('Fetch WASM start...')
+    const urls = url ? [url] : [
+        ...fullURLs(simd).map(u => profileURL(u, profile)), 
+        ...(profile != 'full' ? fullURLs(simd) : [])]
     // assign to global variable
-    defaults.wasm = fetch(url).then(async res => {
-        if (!res.ok) throw `WASM binary fetch failed.`
-        const wasm = await res.arrayBuffer()
-        console.log(`Fetch WASM (${wasm.byteLength}) done.`)
-        return wasm
-    })
+    const wasm = (async () => {
+        for (const [i, u] of urls.entries()) {
+            const wasm = await fetchWASM(u).catch(e => { if (i == urls.length - 1) throw e })
+            if (!wasm) continue
+            console.log(`Fetch WASM (${wasm.byteLength}) done.`)
+            // given url is loaded with the bundled glue
+            return { wasm, glue: url ? undefined : glueURL(u as string) }
+        }
+        throw `WASM binary fetch failed.`
+    })()
+    defaults.wasm[profile] = wasm
     
-    return defaults.wasm
+    return wasm
 }
 
-export interface LoadArgs { newWorker?: boolean, url?: string }
+/**
+ * simd: use SIMD build (default: detected from runtime)
+ * profile: slim build with fewer components, faster to start (default: full). 
+ *   The worker loads the full build on first use of a missing codec/format.
+ */
+export interface LoadArgs { newWorker?: boolean, url?: string, simd?: boolean, profile?: BuildProfile }
 
 export function loadWorker(args?: LoadArgs) {
-    const {newWorker, url} = args ?? {}
+    const {newWorker, url, simd, profile} = args ?? {}
     if (!newWorker && defaults.worker) return defaults.worker
     // assign to global variable
-    const ffWorker = loadWASM(url).then(async wasm => {
+    const ffWorker = loadWASM(url, simd, profile).then(async ({wasm, glue}) => {
         const ffWorker = new FFWorker(createWorker())
         // pass wasm to used and must return for future uses
-        const loadResult = ffWorker.send('load', {wasm}, [wasm])
-        defaults.wasm = loadResult.then(({wasm}) => wasm)
+        const loadResult = ffWorker.send('load', {wasm, glue, fullURLs: fullURLs(simd).map(wasmURL)}, [wasm])
+        defaults.wasm[profile ?? 'full'] = loadResult.then(({wasm}) => ({wasm, glue}))
         await loadResult
         return ffWorker
     })
@@ -1,14 +1,17 @@
 // import { Worker } from 'worker_threads'
 
-import { InferredFormatInfo } from "./types/ffmpeg"
+import { InferredFormatInfo, MemoryInfo } from "./types/ffmpeg"
 import { Flags } from "./types/flags"
 import { ChunkData, FormatMetadata, GraphInstance, StreamMetadata, WriteChunkData } from "./types/graph"
 
 
+/* wasm binary url and its JS glue url (undefined for the default build bundled in the worker) */
+export interface WasmURL { wasm: string, glue?: string }
+
 type MessageType = keyof Messages
 interface Messages {
     load: {
-        send: { wasm: ArrayBuffer },
+        send: { wasm: ArrayBuffer, glue?: string, fullURLs?: WasmURL[] },
         reply: {wasm: ArrayBuffer},
     }
     getMetadata: {
@@ -35,6 +38,10 @@ interface Messages {
         send: { buffer: Uint8Array }
         reply: void
     }
+    getMemoryInfo: {
+        send: void
+        reply: MemoryInfo
+    }
 }
 
 type BackMessageType = keyof BackMessages
@@ -1,11 +1,11 @@
 import createModule from '../wasm/ffmpeg_built.js'
 import { Decoder, Encoder, Frame, Packet } from './codecs'
-import { WorkerHandlers } from "./message"
-import { ModuleType as FF, FFmpegModule, StdVector, StreamInfo } from './types/ffmpeg'
+import { WasmURL, WorkerHandlers } from "./message"
+import { ModuleType as FF, FFmpegModule, FrameInfo, ResultRing, StdVector, StreamInfo } from './types/ffmpeg'
 import { Flags } from './types/flags'
 import {
     AudioStreamMetadata,
-    BufferData, ChunkData, GraphInstance, SourceInstance, StreamMetadata, TargetInstance,
+    BufferData, ChunkData, GraphInstance, SourceInstance, StreamInstanceRef, StreamMetadata, TargetInstance,
     VideoStreamMetadata,
     WriteChunkData
 } from "./types/graph"
@@ -21,6 +21,16 @@ export const vec2Array = <T>(vec: StdVector<T>) => {
     // vec delete ??
     return arr
 }
+/* take all outputs of a result ring (ownership moves to JS) */
+export const ring2Array = <T>(ring: ResultRing<T>) => {
+    const arr: T[] = []
+    const size = ring.size
+    for (let i = 0; i < size; i++) {
+        arr.push(ring.take(i))
+    }
+    ring.clear()
+    return arr
+}
 
 function streamMetadataToInfo(s: StreamMetadata): StreamInfo {
     const format = s.mediaType == 'audio' ? s.sampleFormat : s.pixelFormat
@@ -53,6 +63,7 @@ type TargetRuntime =
 
 interface Runtime {
     ffmpeg?: FFmpegModule
+    fullURLs: WasmURL[] // to load full build when current one (slim) misses components
     graphs: { [k in string]?: GraphRuntime }
 }
 
@@ -63,17 +74,20 @@ interface GraphRuntime {
     targets: TargetRuntime[]
     flags: Flags
     canTransmux: boolean
+    pipeline?: FF['Pipeline']
+    concatenator?: FF['Concatenator']
 }
-const runtime: Runtime = { graphs: {} }
+const runtime: Runtime = { graphs: {}, fullURLs: [] }
 
 export function getFFmpeg() {
     if (!runtime.ffmpeg) throw `GraphRuntime hasn't built, cannot get FFmpegModule`
     return runtime.ffmpeg
 }
 
-// initiantate wasm module
-async function loadModule(wasmBinary: ArrayBuffer) {
-    const ffmpeg: FFmpegModule = await createModule({
+// initiantate wasm module, with its own JS glue when not the default build (import names differ between links)
+async function loadModule(wasmBinary: ArrayBuffer, glue?: string) {
+    const create: typeof createModule = glue ? (await import(/* webpackIgnore: true */ glue)).default : createModule
+    const ffmpeg: FFmpegModule = await create({
         // Module callback functions: https://emscripten.org/docs/api_reference/module.html
         wasmBinary
     })
@@ -82,13 +96,34 @@ async function loadModule(wasmBinary: ArrayBuffer) {
     return ffmpeg
 }
 
+/* FFmpeg logs are buffered in wasm, print them in batch (after each request) */
+const AV_LOG_ERROR = 16
+const AV_LOG_WARNING = 24
+function printLogs() {
+    if (!runtime.ffmpeg) return
+    const vec = runtime.ffmpeg.drainLogs()
+    const entries = vec2Array(vec)
+    vec.delete()
+    if (entries.length == 0) return
+    const lines: {[k in 'error' | 'warn' | 'log']: string[]} = { error: [], warn: [], log: [] }
+    for (const { level, category, message, repeats } of entries) {
+        const kind = level <= AV_LOG_ERROR ? 'error' : level <= AV_LOG_WARNING ? 'warn' : 'log'
+        if (repeats > 0) lines[kind].push(`[${category}] (suppressed ${repeats} same messages)\n`)
+        lines[kind].push(message)
+    }
+    for (const [kind, msgs] of Object.entries(lines)) {
+        if (msgs.length > 0) console[kind as keyof typeof lines](msgs.join(''))
+    }
+}
+
 const bufferPool = new BufferPool()
 
 
 const handler = new WorkerHandlers()
 
-handler.reply('load', async ({ wasm }, _, transferArr) => {
-    runtime.ffmpeg = await loadModule(wasm)
+handler.reply('load', async ({ wasm, glue, fullURLs }, _, transferArr) => {
+    runtime.ffmpeg = await loadModule(wasm, glue)
+    runtime.fullURLs = fullURLs ?? []
     transferArr.push(wasm)
     return { wasm }
 })
@@ -101,6 +136,7 @@ handler.reply('getMetadata', async ({ fileSize }, id) => {
     const { formatName, duration, bitRate, streamInfos } = demuxer.getMetadata()
     const streams = vec2Array(streamInfos).map(s => streamInfoToMetadata(s))
     demuxer.delete()
+    printLogs()
     return { container: { duration, bitRate, formatName }, streams }
 })
 
@@ -111,14 +147,28 @@ handler.reply('inferFormatInfo', async ({ format, url }) => {
 
 // three stages should send in order: buildGraph -> nextFrame -> deleteGraph
 handler.reply('buildGraph', async ({ graphInstance, flags }, id) => {
-    const graph = await buildGraph(graphInstance)
+    if (flags.memoryBudget !== undefined) {
+        const ffmpeg = getFFmpeg()
+        ffmpeg.setMemoryBudget({ ...ffmpeg.getMemoryBudget(), heap: flags.memoryBudget })
+    }
+    if (flags.live !== undefined) {
+        const ffmpeg = getFFmpeg()
+        ffmpeg.setLiveProfile({ ...ffmpeg.getLiveProfile(), enabled: flags.live })
+    }
+    if (flags.encoderSpeed !== undefined) {
+        const ffmpeg = getFFmpeg()
+        ffmpeg.setDefaultSpeedTarget({ ...ffmpeg.getDefaultSpeedTarget(), speed: flags.encoderSpeed })
+    }
+    const graph = await buildGraph(graphInstance, flags)
     runtime.graphs[id] = { ...graph, flags }
+    printLogs()
 })
 
 handler.reply('nextFrame', async (_, id, transferArr) => {
     const graph = runtime.graphs[id]
     if (!graph) throw new Error("haven't built graph.")
     const result = await executeStep(graph)    
+    printLogs()
 
     transferArr.push(
         ...Object.values(result.outputs).map(outs =>
@@ -130,16 +180,24 @@ handler.reply('nextFrame', async (_, id, transferArr) => {
 handler.reply('deleteGraph', (_, id) => {
     const graph = runtime.graphs[id]
     if (!graph) return
+    graph.pipeline?.delete()
+    graph.concatenator?.delete()
     graph.sources.forEach(source => source.reader.close())
     graph.filterer?.close()
     graph.targets.forEach(target => target.writer.close())
     delete runtime.graphs[id]
+    // release pooled buffers when worker is idle
+    if (Object.keys(runtime.graphs).length == 0)
+        runtime.ffmpeg?.trimBufferPools()
+    printLogs()
 })
 
 handler.reply('releaseWorkerBuffer', ({ buffer }) => {
     bufferPool.delete(buffer)
 })
 
+handler.reply('getMemoryInfo', () => getFFmpeg().getMemoryInfo())
+
 /* direct connect to main thread, to retrieve input data */
 class InputIO {
     #id: string
@@ -242,23 +300,120 @@ class OutputIO {
 }
 
 
-async function buildGraph(graphInstance: GraphInstance) {
+/**
+ * codecs/muxers needed by graph but not in current build (see build_profiles/),
+ * copyOnly: all packets are copied (no decoder/encoder).
+ */
+function missingComponents({ nodes }: GraphInstance, copyOnly: boolean) {
+    const ffmpeg = getFFmpeg()
+    const missing: string[] = []
+    for (const node of Object.values(nodes)) {
+        if (node?.type == 'source' && !copyOnly) {
+            if (node.data.type == 'stream' && node.data.elementType == 'frame') continue
+            node.outStreams.forEach(s => ffmpeg.hasDecoder(s.codecName) || missing.push(`decoder ${s.codecName}`))
+        }
+        else if (node?.type == 'target' && node.format.type == 'video') {
+            const format = node.format.container.formatName
+            if (!ffmpeg.hasMuxer(format)) missing.push(`muxer ${format}`)
+            if (!copyOnly)
+                node.outStreams.forEach(s => ffmpeg.hasEncoder(s.codecName) || missing.push(`encoder ${s.codecName}`))
+        }
+    }
+    return missing
+}
+
+/* replace slim module by the full one (only when no other graph uses the current module) */
+async function loadFullModule(missing: string[]) {
+    const profile = getFFmpeg().buildProfile()
+    if (profile == 'full') return // unsupported anyway, fail later as before
+    if (Object.keys(runtime.graphs).length > 0)
+        throw `'${profile}' build misses ${missing.join(', ')}, and is in use by another export (load with profile 'full')`
+    Log('Load full build for', missing.join(', '))
+    for (const { wasm, glue } of runtime.fullURLs) {
+        const res = await fetch(wasm).catch(() => undefined)
+        if (!res?.ok) continue
+        printLogs()
+        runtime.ffmpeg = await loadModule(await res.arrayBuffer(), glue)
+        return
+    }
+    throw `'${profile}' build misses ${missing.join(', ')}, and full build cannot be fetched`
+}
+
+async function buildGraph(graphInstance: GraphInstance, flags: Flags) {
     const sources: GraphRuntime['sources'] = []
     const targets: GraphRuntime['targets'] = []
     const { filterInstance, nodes } = graphInstance
 
+    // check transmux compatibility (target streams may be trimmed sources, by smart cut)
+    let canTransmux = true
+    let smartCut: { start: number, duration: number } | undefined
+    let uncut = false
+    // concat of sources by packets (segment -> streams), only one target
+    let concat: { target: string, segments: StreamInstanceRef[][] } | undefined
+    const muxRefs: { [targetId: string]: StreamInstanceRef[] } = {}
+    for (const id of graphInstance.targets) {
+        const target = nodes[id]
+        if (target?.type != 'target') continue
+        const segments = flags.concatCopy !== false ? traceConcat(nodes, target.inStreams) : undefined
+        if (target.format.type == 'video' && segments) {
+            if (concat) canTransmux = false
+            concat = { target: id, segments }
+            muxRefs[id] = segments[0]
+            // later segments not matching are re-encoded natively
+            canTransmux = canTransmux && segments[0].every(({ from, index }, i) =>
+                areStreamsCompatibleForTransmux(nodes[from]?.outStreams[index] as StreamMetadata, target.outStreams[i]))
+        }
+        else if (target.format.type == 'video') {
+            const cuts = target.inStreams.map(ref => flags.smartCut !== false ? traceTrim(nodes, ref) : undefined)
+            const cut = cuts[0]
+            const sameCut = cuts.every(c => c && cut && c.start == cut.start && c.duration == cut.duration)
+            if (sameCut && cut) {
+                // one SmartCutter per source, so all targets need the same range
+                if (smartCut && (smartCut.start != cut.start || smartCut.duration != cut.duration))
+                    canTransmux = false
+                smartCut = { start: cut.start, duration: cut.duration }
+            }
+            else if (cuts.some(c => c)) canTransmux = false
+            else uncut = true
+            muxRefs[id] = target.inStreams.map((ref, i) => cuts[i]?.ref ?? ref)
+            canTransmux = canTransmux && muxRefs[id].every(({ from, index }, i) => {
+                const source = nodes[from]
+                if (source?.type != 'source') return false
+                if (source.data.type == 'stream' && source.data.elementType == 'frame') return false
+                const sourceStream = source.outStreams[index]
+                const targetStream = target.outStreams[i]
+                return areStreamsCompatibleForTransmux(sourceStream, targetStream)
+            })
+        }
+        else if (target.format.type == 'frame') {
+            canTransmux = false
+        }
+    }
+    if (smartCut && uncut) canTransmux = false
+    if (concat && (smartCut || uncut)) canTransmux = false
+    Log('Transmux', canTransmux, smartCut ? 'smart cut' : concat ? 'concat' : '')
+
+    // slim build: switch to the full one before creating anything from the module
+    const missing = missingComponents(graphInstance, canTransmux && !smartCut && !concat)
+    if (missing.length > 0) await loadFullModule(missing)
+
+    // decode -> filter -> encode -> mux runs inside wasm when no stage needs JS
+    const pipeline = !canTransmux && await canRunPipeline(graphInstance, flags) ?
+        new (getFFmpeg()).Pipeline() : undefined
+    Log('Pipeline', !!pipeline)
+
     // build input nodes
     for (const id of graphInstance.sources) {
         const source = nodes[id]
         if (source?.type !== 'source') continue
         // file source
         if (source.data.type == 'file') {
-            const reader = await newVideoSourceReader(source)
+            const reader = await newVideoSourceReader(source, pipeline)
             sources.push({ type: 'file', reader, instance: source })
         }
         // chunks stream stream (like hls stream)
         else if (source.data.type == 'stream' && source.data.elementType == 'chunk') {
-            const reader = await newVideoSourceReader(source)
+            const reader = await newVideoSourceReader(source, pipeline)
             sources.push({ type: 'file', reader, instance: source })
         }
         // stream of frames
@@ -271,28 +426,16 @@ async function buildGraph(graphInstance: GraphInstance) {
         }
     }
 
-    // build filter graph
-    const filterer = filterInstance && buildFiltersGraph(filterInstance, nodes)
-
-    // check transmux compatibility
-    let canTransmux = true
-    for (const id of graphInstance.targets) {
-        const target = nodes[id]
-        if (target?.type != 'target') continue
-        if (target.format.type == 'video') {
-            canTransmux = canTransmux && target.inStreams.every(({ from, index }, i) => {
-                const source = sources.find(s => s.instance.id == from)
-                if (!source) return false
-                const sourceStream = source.instance.outStreams[index]
-                const targetStream = target.outStreams[i]
-                return areStreamsCompatibleForTransmux(sourceStream, targetStream)
-            })
-        }
-        else if (target.format.type == 'frame') {
-            canTransmux = false
-        }
+    // build filter graph (trim is done by SmartCutter when transmuxing)
+    const filterer = filterInstance && !canTransmux ? buildFiltersGraph(filterInstance, nodes) : undefined
+    if (pipeline && filterer) {
+        const [inTypes, outTypes] = [filterer.src2args, filterer.sink2args].map(args => {
+            const types = getFFmpeg().createStringStringMap()
+            Object.keys(args).forEach(id => types.set(id, filterer.mediaTypes[id] ?? ''))
+            return types
+        })
+        pipeline.setFilter(inTypes, outTypes, filterer.spec)
     }
-    Log('Transmux', canTransmux)
 
     // build output node
     for (const id of graphInstance.targets) {
@@ -300,7 +443,7 @@ async function buildGraph(graphInstance: GraphInstance) {
         if (target?.type != 'target') continue
         if (target.format.type == 'video') {
             if (canTransmux) {
-                const muxFrom = target.inStreams.map(({ from, index }) => {
+                const muxFrom = (muxRefs[id] ?? target.inStreams).map(({ from, index }) => {
                     const source = sources.find(s => s.instance.id == from)
                     if (!source) throw `findSource: no source for ${from}`
                     return { from: source.reader, index }
@@ -309,7 +452,7 @@ async function buildGraph(graphInstance: GraphInstance) {
                 targets.push({ type: 'file', instance: target, writer })
             }
             else {
-                const writer = await newVideoTargetWriter(target)
+                const writer = await newVideoTargetWriter(target, undefined, pipeline, flags)
                 targets.push({ type: 'file', instance: target, writer })
             }
         }
@@ -318,8 +461,72 @@ async function buildGraph(graphInstance: GraphInstance) {
             targets.push({ type: 'frame', instance: target, writer })
         }
     }
+    // stages on threads (pthread build only)
+    if (pipeline && flags.threads !== false)
+        Log('Pipeline threads', pipeline.setThreaded(true))
+
+    // concat loop runs inside wasm: sources are read one after another into the target muxer
+    let concatenator: FF['Concatenator'] | undefined
+    if (canTransmux && concat) {
+        const target = targets.find(t => t.instance.id == concat?.target)
+        if (!(target?.writer instanceof VideoTargetWriter)) throw `Concat: no video target`
+        concatenator = new (getFFmpeg()).Concatenator()
+        for (const refs of concat.segments) {
+            const reader = sources.find(s => s.instance.id == refs[0]?.from)?.reader
+            if (!(reader instanceof VideoSourceReader)) throw `Concat: no video source for ${refs[0]?.from}`
+            const segment = concatenator.addSegment(reader.demuxer)
+            refs.forEach(({ index }, i) => {
+                const copied = concatenator?.addStream(segment, index, (target.writer as VideoTargetWriter).muxer, i)
+                if (!copied) Log(`Concat: segment ${segment} stream ${index} is re-encoded`)
+            })
+        }
+    }
+    // transmux loop runs inside wasm: one Remuxer (or SmartCutter) per source, mapping its streams to target muxers
+    else if (canTransmux) {
+        const ffmpeg = getFFmpeg()
+        for (const target of targets) {
+            if (!(target.writer instanceof VideoTargetWriter)) continue
+            const muxer = target.writer.muxer
+            const refs = muxRefs[target.instance.id] ?? target.instance.inStreams
+            refs.forEach(({ from, index }, i) => {
+                const reader = sources.find(s => s.instance.id == from)?.reader
+                if (!(reader instanceof VideoSourceReader)) throw `Transmux: no video source for ${from}`
+                reader.remuxer ??= smartCut ?
+                    new ffmpeg.SmartCutter(reader.demuxer, smartCut.start, smartCut.start + smartCut.duration) :
+                    new ffmpeg.Remuxer(reader.demuxer)
+                if (reader.remuxer instanceof ffmpeg.SmartCutter)
+                    reader.remuxer.addStream(index, muxer, i)
+                else
+                    reader.remuxer.addStream(index, muxer, i, '')
+            })
+        }
+    }
+
+    return { sources, targets, filterer: pipeline ? undefined : filterer, canTransmux, pipeline, concatenator }
+}
+
 
-    return { sources, targets, filterer, canTransmux }
+/**
+ * Native Pipeline only handles demuxed sources and muxed targets with FFmpeg decoders.
+ * WebCodecs (hardware) decoders are preferred when supported, unless `flags.webCodecs` is false.
+ */
+async function canRunPipeline(graphInstance: GraphInstance, flags: Flags) {
+    const { nodes } = graphInstance
+    for (const id of graphInstance.targets) {
+        const target = nodes[id]
+        if (target?.type == 'target' && target.format.type != 'video') return false
+    }
+    for (const id of graphInstance.sources) {
+        const source = nodes[id]
+        if (source?.type != 'source') continue
+        const demuxed = source.data.type == 'file' || source.data.elementType == 'chunk'
+        if (!demuxed) return false
+        if (flags.webCodecs === false) continue
+        for (const s of source.outStreams) {
+            if (await Decoder.isWebCodecsSupported(streamMetadataToInfo(s))) return false
+        }
+    }
+    return true
 }
 
 
@@ -436,6 +643,45 @@ function buildFiltersGraph(graphInstance: FilterGraph, nodes: GraphInstance['nod
 /**
  * processing one frame as a step
  */
+/**
+ * Target stream made by `.trim()` (source -> trim -> setpts), which SmartCutter can do on packets.
+ * return the source stream and trim range (seconds)
+ */
+function traceTrim(nodes: GraphInstance['nodes'], ref: StreamInstanceRef) {
+    const setpts = nodes[ref.from]
+    if (setpts?.type != 'filter' || !['setpts', 'asetpts'].includes(setpts.filter.name)) return
+    const trimRef = setpts.inStreams[0]
+    const trim = trimRef && nodes[trimRef.from]
+    if (trim?.type != 'filter' || !['trim', 'atrim'].includes(trim.filter.name)) return
+    const args = trim.filter.ffmpegArgs
+    const sourceRef = trim.inStreams[0]
+    if (typeof args == 'string' || !sourceRef || nodes[sourceRef.from]?.type != 'source') return
+
+    return { ref: sourceRef, start: Number(args.start ?? 0), duration: Number(args.duration ?? 0) }
+}
+
+/**
+ * Target streams all from one `concat` of source streams (segments of the same tracks).
+ * return source streams of each segment, in target stream order
+ */
+function traceConcat(nodes: GraphInstance['nodes'], refs: StreamInstanceRef[]) {
+    const concat = refs[0] && nodes[refs[0].from]
+    if (concat?.type != 'filter' || concat.filter.name != 'concat') return
+    if (refs.some(ref => ref.from != concat.id)) return
+    const k = concat.outStreams.length
+    const n = concat.inStreams.length / k
+    const segments: StreamInstanceRef[][] = []
+    for (let s = 0; s < n; s++) {
+        const segment = refs.map(ref => concat.inStreams[s * k + ref.index])
+        const source = nodes[segment[0].from]
+        if (source?.type != 'source' || segment.some(r => r.from != source.id)) return
+        if (source.data.type == 'stream' && source.data.elementType == 'frame') return
+        segments.push(segment)
+    }
+
+    return segments
+}
+
 function areStreamsCompatibleForTransmux(source: StreamMetadata, target: StreamMetadata): boolean {
     // Check if media types match
     if (source.mediaType !== target.mediaType) return false
@@ -467,6 +713,11 @@ function areStreamsCompatibleForTransmux(source: StreamMetadata, target: StreamM
 }
 
 async function executeStep(graph: GraphRuntime) {
+    if (graph.pipeline)
+        return executePipelineSteps(graph, graph.pipeline)
+    if (graph.concatenator)
+        return executeConcatSteps(graph, graph.concatenator)
+
     // find the smallest timestamp source stream and read packet
     const { reader } = graph.sources.reduce((acc, { reader }) => {
         if (reader.inputEnd) return acc
@@ -478,27 +729,15 @@ async function executeStep(graph: GraphRuntime) {
     const outputs: { [nodeId: string]: WriteChunkData[] } = {}
     let endWriting = sourcesEnd && (!reader || reader.inputEnd)
 
-    if (graph.canTransmux && reader instanceof VideoSourceReader) {
-        // Use packet-level operations for transmuxing
-        const packet = await reader.readPacket()
-        if (packet) {
-            for (const target of graph.targets) {
-                if (target.type === 'file') {
-                    const ffPkt = packet.FFPacket;
-                    if (!ffPkt) {
-                        console.warn('Transmux: No FFPacket found')
-                        continue;
-                    };
-                    const inStream = target.instance.inStreams.find(s => s.index == ffPkt.streamIndex);
-                    // skip if no inStream found
-                    if (!inStream) {
-                        ffPkt.delete()
-                        continue;
-                    }
-                    (target.writer as VideoTargetWriter).writePacket(packet, streamId(inStream.from, inStream.index))
-                    outputs[target.instance.id] = target.writer.pullOutputs()
-                }
-            }
+    if (graph.canTransmux && reader instanceof VideoSourceReader && reader.remuxer) {
+        // Use packet-level operations for transmuxing, a batch of packets per step
+        for (const target of graph.targets) {
+            if (target.writer instanceof VideoTargetWriter)
+                target.writer.writeHeader()
+        }
+        await reader.remux(TransmuxBatch.packets, TransmuxBatch.bytes)
+        for (const target of graph.targets) {
+            outputs[target.instance.id] = target.writer.pullOutputs()
         }
     } else {
         // Normal decode-encode path
@@ -534,6 +773,42 @@ async function executeStep(graph: GraphRuntime) {
 }
 
 
+/* max packets / bytes copied by Remuxer in one step */
+const TransmuxBatch = { packets: 256, bytes: 4 * 1024 * 1024 }
+
+/* max packets processed by native Pipeline in one step */
+const PipelineBatch = 32
+
+async function executePipelineSteps(graph: GraphRuntime, pipeline: FF['Pipeline']) {
+    const { end } = await pipeline.step(PipelineBatch)
+    const outputs: { [nodeId: string]: WriteChunkData[] } = {}
+    for (const target of graph.targets) {
+        outputs[target.instance.id] = target.writer.pullOutputs()
+    }
+    const progress = graph.sources.reduce((pg, s) => s.reader.progress ? Math.min(s.reader.progress, pg) : pg, 1)
+
+    return { outputs, progress, endWriting: end }
+}
+
+
+async function executeConcatSteps(graph: GraphRuntime, concatenator: FF['Concatenator']) {
+    for (const target of graph.targets) {
+        if (target.writer instanceof VideoTargetWriter)
+            target.writer.writeHeader()
+    }
+    const { end } = await concatenator.process(TransmuxBatch.packets, TransmuxBatch.bytes)
+    const outputs: { [nodeId: string]: WriteChunkData[] } = {}
+    for (const target of graph.targets) {
+        if (end) await target.writer.writeEnd()
+        outputs[target.instance.id] = target.writer.pullOutputs()
+    }
+    // sources are read in sequence
+    const progress = end ? 1 : graph.sources.reduce((pg, s) => pg + (s.reader.progress ?? 0), 0) / graph.sources.length
+
+    return { outputs, progress, endWriting: end }
+}
+
+
 /**
  * pushInputs (nodeId) -> Reader -> frames (streamId) -> Writer -> pullOutputs (nodeId)
  */
@@ -543,7 +818,7 @@ export type TargetWriter = VideoTargetWriter | FrameTargetWriter
 
 
 /* demuxer need async build */
-async function newVideoSourceReader(node: SourceInstance) {
+async function newVideoSourceReader(node: SourceInstance, pipeline?: FF['Pipeline']) {
     const ffmpeg = getFFmpeg()
     const fileSize = node.data.type == 'file' ? node.data.fileSize : 0
     const inputIO = new InputIO(node.id, fileSize)
@@ -553,6 +828,11 @@ async function newVideoSourceReader(node: SourceInstance) {
     for (let i = 0; i < node.outStreams.length; i++) {
         const s = node.outStreams[i]
         const id = streamId(node.id, i)
+        // decoders owned by native pipeline
+        if (pipeline) {
+            pipeline.addDecoder(demuxer, s.index, id)
+            continue
+        }
         const info = streamMetadataToInfo(s)
         const useWebCodecs = await Decoder.isWebCodecsSupported(info)
         decoders[s.index] = new Decoder(demuxer, id, info, useWebCodecs)
@@ -565,6 +845,7 @@ class VideoSourceReader {
     node: SourceInstance
     demuxer: FF['Demuxer']
     decoders: { [streamIndex in number]?: Decoder }
+    remuxer?: FF['Remuxer'] | FF['SmartCutter']
     #inputIO?: InputIO
     #endOfPacket = false
 
@@ -600,6 +881,16 @@ class VideoSourceReader {
         return new Packet(ffPkt, ffPkt.getTimeInfo().dts, this.node.outStreams[ffPkt.streamIndex].mediaType)
     }
 
+    /* copy packets directly from demuxer to muxers (transmux) */
+    async remux(maxPackets: number, maxBytes: number) {
+        if (!this.remuxer) throw `VideoSourceReader: remuxer not built`
+        const status = await this.remuxer.process(maxPackets, maxBytes)
+        if (status.end)
+            this.#endOfPacket = true
+
+        return status
+    }
+
     async readFrames(): Promise<Frame[]> {
         const pkt = await this.readPacket()
         if (!pkt.FFPacket)
@@ -617,6 +908,7 @@ class VideoSourceReader {
     }
 
     close() {
+        this.remuxer?.delete()
         this.demuxer.delete()
         Object.values(this.decoders).forEach(d => d?.close())
     }
@@ -692,7 +984,12 @@ class FrameSourceReader {
 }
 
 
-async function newVideoTargetWriter(node: TargetInstance, muxFrom?: { from: SourceReader, index: number }[]) {
+async function newVideoTargetWriter(
+    node: TargetInstance,
+    muxFrom?: { from: SourceReader, index: number }[],
+    pipeline?: FF['Pipeline'],
+    flags?: Flags
+) {
     const ffmpeg = getFFmpeg()
     const outputIO = new OutputIO()
     const muxer = new ffmpeg.Muxer(node.format.container.formatName, outputIO)
@@ -707,11 +1004,27 @@ async function newVideoTargetWriter(node: TargetInstance, muxFrom?: { from: Sour
             const source = muxFrom[i]
             if (!source) throw `VideoTargetWriter: no mux source for ${from}`
             if ('demuxer' in source.from) {
-                muxer.newStreamWithDemuxer(source.from.demuxer, index)
+                muxer.newStreamWithDemuxer(source.from.demuxer, source.index)
             }
             else
                 throw `Transmux: unsupported source reader type ${source.from.constructor.name}`
         }
+        // encoders owned by native pipeline, WebCodecs encoder plugged as JS stage
+        else if (pipeline) {
+            const formatName = node.format.container.formatName
+            const useWebCodecs = flags?.webCodecs !== false && await Encoder.isWebCodecsSupported(info)
+            if (useWebCodecs) {
+                const encoder = new Encoder(info, true, formatName)
+                encoders[id] = encoder
+                const timeBase = s.mediaType == 'audio' ? { num: 1, den: s.sampleRate } : { num: 1, den: s.frameRate }
+                const { format } = encoder.toSupportedFormat(info)
+                pipeline.addExternalEncoder(id, muxer, { ...info, timeBase }, format, externalEncoder(encoder, id, info.frameRate))
+            }
+            else {
+                const inferred = ffmpeg.Muxer.inferFormatInfo(formatName, '')
+                pipeline.addEncoder(id, muxer, { ...info, ...inferred[s.mediaType] })
+            }
+        }
         else {
             const useWebCodecs = await Encoder.isWebCodecsSupported(info)
             const encoder = new Encoder(info, useWebCodecs ?? false, node.format.container.formatName)
@@ -730,6 +1043,20 @@ async function newVideoTargetWriter(node: TargetInstance, muxFrom?: { from: Sour
     return new VideoTargetWriter(node, muxer, encoders, outputIO, targetStreamIndexes)
 }
 
+/* WebCodecs encoder as a stage of native Pipeline, returned packets are owned by Pipeline */
+function externalEncoder(encoder: Encoder, name: string, frameRate: number) {
+    const toFF = (pkts: Packet[]) => pkts.map(p => p.toFF())
+    return {
+        encode: async (info: FrameInfo, pts: number, planes: Uint8Array[]) => {
+            const frame = new Frame(Frame.webFrameFromPlanes(planes, info, pts, frameRate), name)
+            const pkts = await encoder.encode(frame)
+            frame.close()
+            return toFF(pkts)
+        },
+        flush: async () => toFF(await encoder.flush())
+    }
+}
+
 class VideoTargetWriter {
     node: TargetInstance
     encoders: { [streamId: string]: Encoder }
@@ -753,12 +1080,16 @@ class VideoTargetWriter {
         this.targetStreamIndexes = targetStreamIndexes
     }
 
-    writePacket(pkt: Packet, streamId: string) {
-        // start writing
+    /* start writing */
+    writeHeader() {
         if (!this.firstWrite) {
             this.firstWrite = true
             this.muxer.writeHeader()
         }
+    }
+
+    writePacket(pkt: Packet, streamId: string) {
+        this.writeHeader()
         const ffPkt = pkt.toFF()
         if (ffPkt.size > 0) {
             // Write the packet to the muxer
@@ -772,17 +1103,18 @@ class VideoTargetWriter {
      * @param frames last writing when frames=undefined
      */
     async writeFrames(frames: Frame[]) {
-        // start writing
-        if (!this.firstWrite) {
-            this.firstWrite = true
-            this.muxer.writeHeader()
-        }
+        this.writeHeader()
         // convert if data format is different
         frames = await Promise.all(frames.map(f => this.dataFormatFilter(f)))
         // write frames
         for (const f of frames) {
             const streamId = f.name
             if (!this.encoders[streamId]) continue
+            const ring = await this.encoders[streamId].encodeToRing(f)
+            if (ring) {
+                this.#writeRing(ring, streamId)
+                continue
+            }
             const pkts = await this.encoders[streamId].encode(f)
             for (const pkt of pkts) {
                 this.writePacket(pkt, streamId)
@@ -790,6 +1122,12 @@ class VideoTargetWriter {
         }
     }
 
+    /* packets of FFmpeg encoders are written as a batch in wasm */
+    #writeRing(ring: FF['PacketRing'], streamId: string) {
+        this.muxer.writeRing(ring, this.targetStreamIndexes[streamId])
+        ring.clear()
+    }
+
     async dataFormatFilter(frame: Frame) {
         const streamId = frame.name
         if (!this.encoders[streamId]) return frame
@@ -824,6 +1162,11 @@ class VideoTargetWriter {
     /* end writing (encoders flush + writeTrailer) */
     async writeEnd() {
         for (const [streamId, encoder] of Object.entries(this.encoders)) {
+            const ring = await encoder.encodeToRing()
+            if (ring) {
+                this.#writeRing(ring, streamId)
+                continue
+            }
             const pkts = await encoder.flush()
             for (const p of pkts) {
                 this.muxer.writeFrame(p.toFF(), this.targetStreamIndexes[streamId])
@@ -868,6 +1211,17 @@ class FrameTargetWriter {
         }
     }
 
+    /* packet data of the whole batch read through ring views (OutputIO copies it), then ring cleared */
+    #ring2outputs(ring: FF['PacketRing']) {
+        const heap = getFFmpeg().HEAPU8
+        const data = ring.data()
+        const sizes = ring.sizes()
+        for (let i = 0; i < data.length; i++) {
+            if (sizes[i] > 0) this.#outputIO.write(heap.subarray(data[i], data[i] + sizes[i]))
+        }
+        ring.clear()
+    }
+
     async writeFrames(frames: Frame[]) {
         // use inStream ref
         const { from, index } = this.node.inStreams[0]
@@ -882,16 +1236,18 @@ class FrameTargetWriter {
                     throw `Output rawvideo (bitmap) not implemented`
             }
             else {
-                const pktVec = await this.encoder.encode(f)
-                this.#pktVec2outputs(pktVec)
+                const ring = await this.encoder.encodeToRing(f)
+                if (ring) this.#ring2outputs(ring)
+                else this.#pktVec2outputs(await this.encoder.encode(f))
             }
         }
     }
 
     /* flush at end of writing */
     async writeEnd() {
-        const pkts = await this.encoder.flush()
-        this.#pktVec2outputs(pkts)
+        const ring = await this.encoder.encodeToRing()
+        if (ring) this.#ring2outputs(ring)
+        else this.#pktVec2outputs(await this.encoder.flush())
     }
 
     pullOutputs() {
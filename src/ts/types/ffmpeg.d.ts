@@ -25,6 +25,62 @@ class CppClass {
     clone(): this
 }
 
+// counters of each stage (times in milliseconds, only measured when `enableStats(true)`)
+interface Stats {
+    packets: number
+    frames: number
+    bytes: number
+    calls: number
+    processTime: number
+    ioTime: number
+    allocs: number
+    latency: number // of last output: read/write call (Demuxer/Muxer), input to output of same timestamp (codecs, Filterer)
+    maxLatency: number
+}
+
+// components of slim builds (build_profiles/*.sh), `full` has all
+type BuildProfile = 'probe' | 'audio' | 'transmux' | 'full'
+
+// low-latency settings for objects created afterwards
+interface LiveProfile {
+    enabled: boolean
+    probesize: number // bytes probed by Demuxer
+    analyzeDuration: number // seconds
+    interleaveDelta: number // seconds Muxer waits for other streams
+}
+
+// adaptive speed of libx264/libvpx encoders, levels 0~8 (slowest to fastest preset / cpu-used)
+interface SpeedTarget {
+    speed: number // x realtime of encoding, 0 disables
+    headroom: number // slower level when faster than speed * (1 + headroom)
+    window: number // seconds of media between adjustments
+    level: number // initial, -1 for codec default
+}
+interface SpeedChange {
+    time: number // seconds
+    level: number
+    setting: string // e.g. "preset=veryfast"
+    speed: number // measured x realtime before the change, 0 for initial
+}
+
+// memory accounting (bytes)
+interface MemoryInfo {
+    current: number
+    highWater: number
+    allocs: number
+    heapSize: number // wasm memory size, only for global info
+}
+interface MemoryBudget {
+    heap: number // 0 is unlimited
+    ioBuffer: number
+    interleaveDelta: number // seconds, 0 is FFmpeg default
+}
+// size-class pools of frame/packet buffers
+interface BufferPoolInfo {
+    buffers: number
+    bytes: number
+}
+
 // demuxer
 interface ReaderForDemuxer {
     size: number
@@ -35,11 +91,15 @@ interface ReaderForDemuxer {
 class Demuxer extends CppClass {
     constructor()
     build(reader: ReaderForDemuxer): Promise<void>
+    /* host file path, read directly (only Node build: NODE=1 ./build_wasm.sh) */
+    buildFromFile(path: string): Promise<void>
     seek(t: number, streamIndex: number): Promise<void>
     read(): Promise<Packet>
     getTimeBase(streamIndex: number): AVRational
     getMetadata(): FormatInfo
     currentTime(streamIndex: number): number
+    getStats(): Stats
+    getMemory(): MemoryInfo
     dump(): void
 }
 interface FormatInfo {
@@ -50,6 +110,16 @@ interface FormatInfo {
 }
 
 // decode
+type SkipLevel = '' | 'nonref' | 'bidir' | 'nonintra' | 'nonkey' | 'all'
+interface DecodeMode {
+    lowres: number
+    skipLoopFilter: SkipLevel
+    skipIdct: SkipLevel
+    skipFrame: SkipLevel
+    fast: boolean
+    everyNth: number
+}
+
 class Decoder extends CppClass {
     constructor(dexmuer: Demuxer, streamIndex: number, name: string)
     constructor(streamInfo: StreamInfo, name: string)
@@ -58,6 +128,14 @@ class Decoder extends CppClass {
     get dataFormat(): DataFormat
     decode(packet: Packet): StdVector<Frame>
     flush(): StdVector<Frame>
+    decodeInto(packet: Packet, ring: FrameRing): number
+    flushInto(ring: FrameRing): number
+    setDecodeMode(mode: DecodeMode): void
+    getDecodeMode(): DecodeMode
+    /* after Demuxer.seek */
+    flushBuffers(): void
+    getStats(): Stats
+    getMemory(): MemoryInfo
 }
 
 // stream
@@ -119,22 +197,55 @@ interface FrameInfo {
     nbSamples: number;
 }
 
+// '' keeps frame format; or any FFmpeg pixel/sample format name
+type FrameCopyLayout = '' | 'I420' | 'NV12' | 'RGBA' | 'f32' | 's16' | string
 class Frame extends CppClass {
     constructor(info: FrameInfo, pts: number, name: string);
     getFrameInfo(): FrameInfo
     static inferChannelLayout(channels: number): string
     getPlanes(): StdVector<Uint8Array>
+    copySize(layout: FrameCopyLayout, stride: number): number
+    copyTo(dest: number, layout: FrameCopyLayout, stride: number): number
     key: boolean
     pts: number
     dump():void
     name: string
 }
 
+// struct-of-arrays outputs of Decoder/Encoder/Filterer (views are invalid after ring changes)
+class ResultRing<T> extends CppClass {
+    constructor(capacity: number)
+    get size(): number
+    take(i: number): T
+    clear(): void
+    setSink(sink: (ring: ResultRing<T>) => void): void
+    flushSink(): void
+    handles(): Uint32Array
+    pts(): Float64Array
+    dts(): Float64Array
+    durations(): Float64Array
+    sizes(): Int32Array
+    keys(): Int32Array
+    data(): Uint32Array
+}
+class FrameRing extends ResultRing<Frame> {}
+class PacketRing extends ResultRing<Packet> {}
+
 // filter
+// input changes (size/format) of a Filterer
+interface FilterGraphInfo {
+    reinits: number // handled in place (buffersrc -> scale)
+    converted: number // converted to the configured input parameters (scale/aresample before the graph)
+}
 class Filterer extends CppClass {
     constructor(inStreams: StdMap<string, string>, outStreams: StdMap<string, string>, mediaTypes: StdMap<string, string>, graphSpec: string)
     filter(frames: StdVector<Frame>): StdVector<Frame>
     flush(): StdVector<Frame>
+    filterInto(frame: Frame, ring: FrameRing): number
+    flushInto(ring: FrameRing): number
+    getStats(): Stats
+    getMemory(): MemoryInfo
+    getGraphInfo(): FilterGraphInfo
     delete(): void
 }
 // bitstream filter
@@ -151,6 +262,13 @@ class Encoder extends CppClass {
     get dataFormat(): DataFormat
     encode(f: Frame): StdVector<Packet>
     flush(): StdVector<Packet>
+    encodeInto(f: Frame, ring: PacketRing): number
+    flushInto(ring: PacketRing): number
+    getStats(): Stats
+    getMemory(): MemoryInfo
+    /* false if not supported by codec */
+    setSpeedTarget(target: SpeedTarget): boolean
+    getSpeedHistory(): StdVector<SpeedChange>
     delete(): void
 }
 
@@ -175,6 +293,8 @@ interface WriterForMuxer {
 class Muxer extends CppClass {
     constructor(formatName: string, writer: WriterForMuxer)
     static inferFormatInfo(format: string, filename: string): InferredFormatInfo
+    /* host file path, written directly (only Node build: NODE=1 ./build_wasm.sh) */
+    static toFile(formatName: string, path: string): Muxer
     dump(): void
     newStreamWithDemuxer(demuxer: Demuxer, streamIndex: number): void
     newStreamWithEncoder(encoder: Encoder): void
@@ -183,9 +303,182 @@ class Muxer extends CppClass {
     writeHeader(): void
     writeTrailer(): void
     writeFrame(packet: Packet, streamIndex: number): void
+    /* write all (not taken, non-empty) packets of a ring, which still owns them (clear it after) */
+    writeRing(ring: PacketRing, streamIndex: number): number
+    getStats(): Stats
+    getMemory(): MemoryInfo
+    delete(): void
+}
+
+// remuxer
+interface RemuxStatus {
+    packets: number
+    bytes: number
+    end: boolean
+    throttled: boolean
+}
+class Remuxer extends CppClass {
+    constructor(demuxer: Demuxer)
+    addStream(inStreamIndex: number, muxer: Muxer, outStreamIndex: number, bsfName: string): void
+    setTimeOffset(seconds: number): void
+    process(maxPackets: number, maxBytes: number): Promise<RemuxStatus>
+    delete(): void
+}
+/* trim [start, end) seconds, re-encoding only the GOPs at both cuts */
+class SmartCutter extends CppClass {
+    constructor(demuxer: Demuxer, start: number, end: number)
+    addStream(inStreamIndex: number, muxer: Muxer, outStreamIndex: number): void
+    process(maxPackets: number, maxBytes: number): Promise<RemuxStatus>
+    delete(): void
+}
+/* demuxers (segments) one after another, incompatible segment streams are re-encoded */
+class Concatenator extends CppClass {
+    constructor()
+    addSegment(demuxer: Demuxer): number
+    /* return false if this segment stream will be re-encoded */
+    addStream(segment: number, inStreamIndex: number, muxer: Muxer, outStreamIndex: number): boolean
+    process(maxPackets: number, maxBytes: number): Promise<RemuxStatus>
     delete(): void
 }
 
+// pipeline
+interface PipelineStatus {
+    steps: number
+    end: boolean
+    throttled: boolean
+}
+interface ExternalEncoder {
+    encode(info: FrameInfo, pts: number, planes: Uint8Array[]): Promise<Packet[]>
+    flush(): Promise<Packet[]>
+}
+class Pipeline extends CppClass {
+    constructor()
+    addDecoder(demuxer: Demuxer, streamIndex: number, name: string): void
+    setFilter(inTypes: StdMap<string, string>, outTypes: StdMap<string, string>, filterSpec: string): void
+    addEncoder(name: string, muxer: Muxer, info: StreamInfo): void
+    addExternalEncoder(name: string, muxer: Muxer, info: StreamInfo, format: string, encoder: ExternalEncoder): void
+    /* stages on threads, before first step (false without pthreads or with external encoders) */
+    setThreaded(enable: boolean): boolean
+    step(maxSteps: number): Promise<PipelineStatus>
+    delete(): void
+}
+
+// fanout (decode once, encode many)
+interface FanOutStatus {
+    packets: number
+    end: boolean
+    throttled: boolean
+    blocked: number // branch with full queue, -1 if none
+}
+class FanOut extends CppClass {
+    constructor(demuxer: Demuxer, streamIndex: number)
+    /* parent: -1 for decoded frames, or index of a previous branch (cascade) */
+    addBranch(parent: number, muxer: Muxer, info: StreamInfo): number
+    setPaused(branch: number, paused: boolean): void
+    setMaxQueue(frames: number): void
+    queueSize(branch: number): number
+    step(maxPackets: number): Promise<FanOutStatus>
+    delete(): void
+}
+
+// waveform peaks, [min, max, rms] per bucket (all channels, normalized to [-1, 1])
+class AudioPeaks extends CppClass {
+    /* level k has buckets of samplesPerBucket * 2^k samples */
+    constructor(samplesPerBucket: number, levels: number)
+    constructor(demuxer: Demuxer, streamIndex: number, samplesPerBucket: number, levels: number)
+    addFrame(frame: Frame): void
+    flush(): void
+    process(maxPackets: number): Promise<RemuxStatus>
+    nbLevels(): number
+    nbBuckets(level: number): number
+    samplesPerBucket(level: number): number
+    /* view valid until next call, copy it (slice) to keep */
+    peaks(level: number): Float32Array
+    delete(): void
+}
+
+// scene change detection
+interface SceneOptions {
+    threshold: number // 0~1, e.g. 0.3
+    minDuration: number // seconds between cuts
+    keyframesOnly: boolean
+    lowres: number
+}
+interface SceneCut {
+    time: number // seconds
+    score: number
+}
+class SceneDetector extends CppClass {
+    constructor(demuxer: Demuxer, streamIndex: number, options: SceneOptions)
+    process(maxPackets: number): Promise<RemuxStatus>
+    getCuts(): StdVector<SceneCut>
+    delete(): void
+}
+
+// full-reference quality (PSNR in dB, capped at 100 for identical, SSIM 0~1), Y:U:V weighted 4:1:1
+interface QualityOptions {
+    everyNth: number // measure every Nth aligned frame, 1 for all
+    ssim: boolean
+}
+interface FrameQuality {
+    time: number // seconds
+    psnrY: number
+    psnrU: number
+    psnrV: number
+    psnr: number
+    ssimY: number
+    ssim: number
+}
+interface QualitySummary {
+    frames: number
+    psnr: number // of mean squared error
+    psnrY: number
+    ssim: number // mean
+    ssimY: number
+    minPsnr: number
+    minSsim: number
+}
+class QualityMeter extends CppClass {
+    constructor(reference: Demuxer, refStreamIndex: number, distorted: Demuxer, distStreamIndex: number, options: QualityOptions)
+    process(maxPackets: number): Promise<RemuxStatus>
+    getFrames(): StdVector<FrameQuality>
+    getSummary(): QualitySummary
+    delete(): void
+}
+
+// decoded frames for scrubbing (LRU under budget), demuxer dedicated to the cache
+interface FrameCacheOptions {
+    budget: number // bytes
+    maxWidth: number // stored scaled down to fit, 0 for original size
+    maxHeight: number
+    prefetch: number // seconds around the last requested frame
+}
+interface FrameCacheInfo {
+    frames: number
+    bytes: number
+    hits: number
+    misses: number
+}
+class FrameCache extends CppClass {
+    constructor(demuxer: Demuxer, options: FrameCacheOptions)
+    /* frame shown at time (seconds), caller deletes it */
+    get(streamIndex: number, time: number): Promise<Frame | null>
+    has(streamIndex: number, time: number): boolean
+    /* on idle, until status.end */
+    prefetch(maxPackets: number): Promise<RemuxStatus>
+    clear(): void
+    getInfo(): FrameCacheInfo
+    delete(): void
+}
+
+// log
+interface LogEntry {
+    level: number // AV_LOG_*
+    category: string
+    message: string
+    repeats: number // same messages suppressed before this one
+}
+
 interface ModuleClass {
     Demuxer: typeof Demuxer
     Muxer: typeof Muxer
@@ -195,12 +488,42 @@ interface ModuleClass {
     Packet: typeof Packet
     Filterer: typeof Filterer
     BitstreamFilterer: typeof BitstreamFilterer
+    Remuxer: typeof Remuxer
+    SmartCutter: typeof SmartCutter
+    Concatenator: typeof Concatenator
+    Pipeline: typeof Pipeline
+    FanOut: typeof FanOut
+    AudioPeaks: typeof AudioPeaks
+    SceneDetector: typeof SceneDetector
+    QualityMeter: typeof QualityMeter
+    FrameCache: typeof FrameCache
+    FrameRing: typeof FrameRing
+    PacketRing: typeof PacketRing
 }
 
 type ModuleInstance = {[k in keyof ModuleClass]: InstanceType<ModuleClass[k]>}
 
 interface ModuleFunction {
     setConsoleLogger(verbose: boolean): void
+    setLogLevel(category: string, level: number): void
+    setLogRateLimit(perSecond: number): void
+    drainLogs(): StdVector<LogEntry>
+    enableStats(enable: boolean): void
+    getMemoryInfo(): MemoryInfo
+    buildProfile(): BuildProfile
+    hasDecoder(codecName: string): boolean
+    hasEncoder(codecName: string): boolean
+    hasDemuxer(formatName: string): boolean
+    hasMuxer(formatName: string): boolean
+    hasFilter(filterName: string): boolean
+    setLiveProfile(profile: LiveProfile): void
+    getLiveProfile(): LiveProfile
+    setDefaultSpeedTarget(target: SpeedTarget): void
+    getDefaultSpeedTarget(): SpeedTarget
+    setMemoryBudget(budget: MemoryBudget): void
+    getMemoryBudget(): MemoryBudget
+    getBufferPoolInfo(): BufferPoolInfo
+    trimBufferPools(): void
     createFrameVector(): StdVector<Frame>
     createStringStringMap(): StdMap<string, string>
 }
@@ -2,4 +2,16 @@
 export interface Flags {
     webCodecs?: boolean | {video?: boolean, audio?: boolean}
     hardware?: boolean
+    /* bytes of wasm allocations, above which the graph stops reading ahead (backpressure) */
+    memoryBudget?: number
+    /* trim by copying packets, re-encoding only GOPs at the cuts (when codecs are unchanged), default true */
+    smartCut?: boolean
+    /* concat sources by copying packets, re-encoding only segments not matching the first one, default true */
+    concatCopy?: boolean
+    /* low-latency profile (small probing, no B-frames/lookahead, packets flushed as written), for live inputs, default false */
+    live?: boolean
+    /* target encoding speed (x realtime) of libx264/libvpx encoders, adapting preset/cpu-used over time, default 0 (fixed) */
+    encoderSpeed?: number
+    /* run native pipeline stages (decode, filter, each encoder) on threads, only with a pthread build, default true */
+    threads?: boolean
 }
\ No newline at end of file